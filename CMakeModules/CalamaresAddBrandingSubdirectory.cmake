@@ -53,6 +53,10 @@ include( CMakeColors )
 #
 # If SUBDIRECTORIES are given, then those are copied (each one level deep)
 # to the installation location as well, preserving the subdirectory name.
+#
+# With WITH_QMLCACHE, each .qml file is also compiled with qmlcachegen,
+# and the .qmlc file is installed next to it; Qt loads that instead of
+# compiling the QML when Calamares starts.
 function( calamares_add_branding NAME )
     cmake_parse_arguments( _CABT "" "DIRECTORY" "SUBDIRECTORIES" ${ARGN} )
     if (NOT _CABT_DIRECTORY)
@@ -65,6 +69,7 @@ function( calamares_add_branding NAME )
     set( BRANDING_DIR share/calamares/branding )
     set( BRANDING_COMPONENT_DESTINATION ${BRANDING_DIR}/${NAME} )
 
+    set( _qmlc_files "" )
     foreach( _subdir "" ${_CABT_SUBDIRECTORIES} )
         file( GLOB BRANDING_COMPONENT_FILES RELATIVE ${CMAKE_CURRENT_SOURCE_DIR}/${_brand_dir} "${_brand_dir}/${_subdir}/*" )
         foreach( BRANDING_COMPONENT_FILE ${BRANDING_COMPONENT_FILES} )
@@ -74,9 +79,23 @@ function( calamares_add_branding NAME )
 
                 install( FILES ${CMAKE_CURRENT_BINARY_DIR}/${_subpath}
                             DESTINATION ${BRANDING_COMPONENT_DESTINATION}/${_subdir}/ )
+
+                if( WITH_QMLCACHE AND QMLCACHEGEN_EXECUTABLE AND _subpath MATCHES "\\.qml$" )
+                    add_custom_command(
+                        OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/${_subpath}c
+                        COMMAND ${QMLCACHEGEN_EXECUTABLE} -o ${CMAKE_CURRENT_BINARY_DIR}/${_subpath}c ${CMAKE_CURRENT_BINARY_DIR}/${_subpath}
+                        DEPENDS ${CMAKE_CURRENT_SOURCE_DIR}/${_subpath}
+                    )
+                    list( APPEND _qmlc_files ${CMAKE_CURRENT_BINARY_DIR}/${_subpath}c )
+                    install( FILES ${CMAKE_CURRENT_BINARY_DIR}/${_subpath}c
+                                DESTINATION ${BRANDING_COMPONENT_DESTINATION}/${_subdir}/ )
+                endif()
             endif()
         endforeach()
     endforeach()
+    if( _qmlc_files )
+        add_custom_target( branding-qmlcache-${NAME} ALL DEPENDS ${_qmlc_files} )
+    endif()
 
     message( "-- ${BoldYellow}Found ${CALAMARES_APPLICATION_NAME} branding component: ${BoldRed}${NAME}${ColorReset}" )
     message( "   ${Green}TYPE:${ColorReset} branding component" )
@@ -63,7 +63,11 @@ function(calamares_add_library)
 
     # add resources from current dir
     if(EXISTS "${CMAKE_CURRENT_LIST_DIR}/${LIBRARY_RESOURCES}")
-        qt5_add_resources(LIBRARY_RC_SOURCES "${LIBRARY_RESOURCES}")
+        if(WITH_QMLCACHE)
+            qtquick_compiler_add_resources(LIBRARY_RC_SOURCES "${LIBRARY_RESOURCES}")
+        else()
+            qt5_add_resources(LIBRARY_RC_SOURCES "${LIBRARY_RESOURCES}")
+        endif()
         list(APPEND LIBRARY_SOURCES ${LIBRARY_RC_SOURCES})
         unset(LIBRARY_RC_SOURCES)
     endif()
@@ -28,11 +28,13 @@
 #include "Settings.h"
 #include "ViewManager.h"
 #include "modulesystem/ModuleManager.h"
+#include "partition/DeviceInventory.h"
 #include "utils/CalamaresUtilsGui.h"
 #include "utils/CalamaresUtilsSystem.h"
 #include "utils/Dirs.h"
 #include "utils/Logger.h"
 #include "utils/Retranslator.h"
+#include "utils/Trace.h"
 #include "viewpages/ViewStep.h"
 
 #include <QDesktopWidget>
@@ -71,6 +73,7 @@ CalamaresApplication::CalamaresApplication( int& argc, char* argv[] )
 void
 CalamaresApplication::init()
 {
+    CalamaresUtils::Trace::Span span( "startup", __func__ );
     Logger::setupLogfile();
     cDebug() << "Calamares version:" << CALAMARES_VERSION;
     cDebug() << "        languages:" << QString( CALAMARES_TRANSLATION_LANGUAGES ).replace( ";", ", " );
@@ -80,6 +83,8 @@ CalamaresApplication::init()
         cError() << "Must create Calamares::Settings before the application.";
         ::exit( 1 );
     }
+    // Welcome and partition both want the list of disks; start reading it now.
+    CalamaresUtils::Partition::DeviceInventory::instance()->refresh();
     initQmlPath();
     initBranding();
 
@@ -98,6 +103,7 @@ CalamaresApplication::init()
 
 CalamaresApplication::~CalamaresApplication()
 {
+    CalamaresUtils::Trace::writeTrace();
     Logger::CDebug( Logger::LOGVERBOSE ) << "Shutting down Calamares...";
     Logger::CDebug( Logger::LOGVERBOSE ) << Logger::SubEntry << "Finished shutdown.";
 }
@@ -175,6 +181,7 @@ brandingFileCandidates( bool assumeBuilddir, const QString& brandingFilename )
 void
 CalamaresApplication::initQmlPath()
 {
+    CalamaresUtils::Trace::Span span( "startup", __func__ );
     QDir importPath;  // Right now, current-dir
     QStringList qmlDirCandidatesByPriority = qmlDirCandidates( isDebug() );
     bool found = false;
@@ -213,6 +220,7 @@ CalamaresApplication::initQmlPath()
 void
 CalamaresApplication::initBranding()
 {
+    CalamaresUtils::Trace::Span span( "startup", __func__ );
     QString brandingComponentName = Calamares::Settings::instance()->brandingComponentName();
     if ( brandingComponentName.simplified().isEmpty() )
     {
@@ -259,6 +267,7 @@ CalamaresApplication::initBranding()
 void
 CalamaresApplication::initModuleManager()
 {
+    CalamaresUtils::Trace::Span span( "startup", __func__ );
     m_moduleManager = new Calamares::ModuleManager( Calamares::Settings::instance()->modulesSearchPaths(), this );
     connect( m_moduleManager, &Calamares::ModuleManager::initDone, this, &CalamaresApplication::initView );
     m_moduleManager->init();
@@ -304,6 +313,7 @@ centerWindowOnScreen( QWidget* w )
 void
 CalamaresApplication::initView()
 {
+    CalamaresUtils::Trace::Span span( "startup", __func__ );
     cDebug() << "STARTUP: initModuleManager: all modules init done";
     initJobQueue();
     cDebug() << "STARTUP: initJobQueue done";
@@ -326,6 +336,7 @@ CalamaresApplication::initView()
 void
 CalamaresApplication::initViewSteps()
 {
+    CalamaresUtils::Trace::Span span( "startup", __func__ );
     cDebug() << "STARTUP: loadModules for all modules done";
     m_moduleManager->checkRequirements();
     if ( Calamares::Branding::instance()->windowMaximize() )
@@ -361,6 +372,7 @@ CalamaresApplication::initFailed( const QStringList& l )
 void
 CalamaresApplication::initJobQueue()
 {
+    CalamaresUtils::Trace::Span span( "startup", __func__ );
     Calamares::JobQueue* jobQueue = new Calamares::JobQueue( this );
     new CalamaresUtils::System( Calamares::Settings::instance()->doChroot(), this );
     Calamares::Branding::instance()->setGlobals( jobQueue->globalStorage() );
@@ -134,8 +134,7 @@ CalamaresWindow::getWidgetSidebar( int desiredWidth )
 QWidget*
 CalamaresWindow::getQmlSidebar( int desiredWidth )
 {
-    CalamaresUtils::registerCalamaresModels();
-    QQuickWidget* w = new QQuickWidget( this );
+    QQuickWidget* w = new QQuickWidget( CalamaresUtils::qmlEngine(), this );
     w->setFixedWidth( desiredWidth );
     w->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Expanding );
     w->setSource( QUrl(
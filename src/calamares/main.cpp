@@ -20,10 +20,12 @@
 
 #include "CalamaresApplication.h"
 
+#include "JobQueue.h"
 #include "Settings.h"
 #include "utils/Dirs.h"
 #include "utils/Logger.h"
 #include "utils/Retranslator.h"
+#include "utils/Trace.h"
 
 #include "3rdparty/kdsingleapplicationguard/kdsingleapplicationguard.h"
 
@@ -76,6 +78,10 @@ handle_args( CalamaresApplication& a )
     QCommandLineOption configOption(
         QStringList { "c", "config" }, "Configuration directory to use, for testing purposes.", "config" );
     QCommandLineOption xdgOption( QStringList { "X", "xdg-config" }, "Use XDG_{CONFIG,DATA}_DIRS as well." );
+    QCommandLineOption traceOption( QStringLiteral( "trace" ),
+                                    "Write a timing trace (Chrome trace JSON) next to the log file." );
+    QCommandLineOption resumeOption( QStringLiteral( "resume" ),
+                                     "Resume a failed installation after the last job that succeeded." );
 
     QCommandLineParser parser;
     parser.setApplicationDescription( "Distribution-independent installer framework" );
@@ -87,10 +93,16 @@ handle_args( CalamaresApplication& a )
     parser.addOption( configOption );
     parser.addOption( xdgOption );
     parser.addOption( debugTxOption );
+    parser.addOption( traceOption );
+    parser.addOption( resumeOption );
 
     parser.process( a );
 
     Logger::setupLogLevel( parser.isSet( debugOption ) ? Logger::LOGVERBOSE : debug_level( parser, debugLevelOption ) );
+    if ( parser.isSet( traceOption ) )
+    {
+        CalamaresUtils::Trace::setupTracing();
+    }
     if ( parser.isSet( configOption ) )
     {
         CalamaresUtils::setAppDataDir( QDir( parser.value( configOption ) ) );
@@ -102,6 +114,10 @@ handle_args( CalamaresApplication& a )
     CalamaresUtils::setAllowLocalTranslation( parser.isSet( debugOption ) || parser.isSet( debugTxOption ) );
     Calamares::Settings::init( parser.isSet( debugOption ) );
     a.init();
+    if ( Calamares::JobQueue::instance() )
+    {
+        Calamares::JobQueue::instance()->setResume( parser.isSet( resumeOption ) );
+    }
 }
 
 int
@@ -22,13 +22,81 @@
 #include "CalamaresConfig.h"
 #include "GlobalStorage.h"
 #include "Job.h"
+#include "Settings.h"
+#include "partition/Mount.h"
+#include "utils/Dirs.h"
+#include "utils/Initramfs.h"
 #include "utils/Logger.h"
-
+#include "utils/ResourceUsage.h"
+#include "utils/Trace.h"
+#include "utils/UMask.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
 #include <QThread>
 
+#include <algorithm>
+
+#include <stdio.h>
+
 namespace Calamares
 {
 
+static QString
+checkpointFile()
+{
+    return CalamaresUtils::appLogDir().filePath( QStringLiteral( "checkpoint.json" ) );
+}
+
+static QString
+checkpointStorageFile()
+{
+    return CalamaresUtils::appLogDir().filePath( QStringLiteral( "checkpoint-globalstorage.json" ) );
+}
+
+/// @brief Tells jobs apart well enough to see if the same jobs are queued again
+static QString
+jobIdentity( const job_ptr& job )
+{
+    return QStringLiteral( "%1 %2" ).arg( job->metaObject()->className(), job->prettyName() );
+}
+
+static QStringList
+jobIdentities( const JobList& jobs )
+{
+    QStringList l;
+    for ( const auto& job : jobs )
+    {
+        l.append( jobIdentity( job ) );
+    }
+    return l;
+}
+
+static void
+removeCheckpoint()
+{
+    QFile::remove( checkpointFile() );
+    QFile::remove( checkpointStorageFile() );
+}
+
+/// @brief The number of *exec* sections, or -1 if that is not known
+static int
+execSectionCount()
+{
+    const auto* settings = Settings::instance();
+    if ( !settings )
+    {
+        return -1;
+    }
+    const auto sequence = settings->modulesSequence();
+    return static_cast< int >( std::count_if( sequence.cbegin(), sequence.cend(), []( const auto& step ) {
+        return step.first == ModuleSystem::Action::Exec;
+    } ) );
+}
+
 class JobThread : public QThread
 {
 public:
@@ -41,9 +109,19 @@ public:
 
     virtual ~JobThread() override;
 
-    void setJobs( JobList&& jobs )
+    /** @brief Set the @p jobs to run, starting with the one at index @p first
+     *
+     * The jobs of earlier *exec* sections are @p completedSections
+     * (for the checkpoint); if @p lastSection is true, the checkpoint
+     * is removed when all the jobs succeed.
+     */
+    void setJobs( JobList&& jobs, int first, const QList< QStringList >& completedSections, bool lastSection )
     {
         m_jobs = jobs;
+        m_firstJob = first;
+        m_completedSections = completedSections;
+        m_lastSection = lastSection;
+        m_jobWeights.clear();
 
         qreal totalJobsWeight = 0.0;
         for ( auto job : m_jobs )
@@ -63,8 +141,10 @@ public:
         QString message;
         QString details;
 
-        m_jobIndex = 0;
-        for ( auto job : m_jobs )
+        QVariantList statistics;
+
+        m_jobIndex = m_firstJob;
+        for ( auto job : m_jobs.mid( m_firstJob ) )
         {
             if ( anyFailed && !job->isEmergency() )
             {
@@ -76,32 +156,134 @@ public:
             cDebug() << "Starting" << ( anyFailed ? "EMERGENCY JOB" : "job" ) << job->prettyName() << " (there are"
                      << m_jobs.count() << " left)";
             connect( job.data(), &Job::progress, this, &JobThread::emitProgress );
-            JobResult result = job->exec();
+            const auto before = CalamaresUtils::ResourceUsage::current();
+            JobResult result = execJob( job );
+            const auto usage = CalamaresUtils::ResourceUsage::current().since( before );
+
+            QVariantMap jobStatistics = usage.toMap();
+            jobStatistics.insert( QStringLiteral( "name" ), job->prettyName() );
+            jobStatistics.insert( QStringLiteral( "success" ), bool( result ) );
+            statistics.append( jobStatistics );
             if ( !anyFailed && !result )
             {
                 anyFailed = true;
                 message = result.message();
                 details = result.details();
+                // The job that would regenerate the initramfs won't run
+                CalamaresUtils::Initramfs::restoreHooks();
             }
             if ( !anyFailed )
             {
                 ++m_jobIndex;
+                checkpoint( m_jobIndex );
             }
         }
+        logStatistics( statistics );
+        // Each exec section runs its own queue; keep the jobs of earlier sections
+        QVariantList allStatistics = m_queue->globalStorage()->value( QStringLiteral( "jobStatistics" ) ).toList();
+        allStatistics.append( statistics );
+        m_queue->globalStorage()->insert( QStringLiteral( "jobStatistics" ), allStatistics );
+
         if ( anyFailed )
         {
             emitFailed( message, details );
         }
         else
         {
+            if ( m_lastSection )
+            {
+                removeCheckpoint();
+            }
+            else
+            {
+                m_completedSections.append( jobIdentities( m_jobs ) );
+                checkpoint( 0 );
+            }
             emitProgress();
         }
+        // Save what we have, in case Calamares is killed after installing
+        CalamaresUtils::Trace::writeTrace();
         emitFinished();
     }
 
 private:
     JobList m_jobs;
     QList< qreal > m_jobWeights;
+    int m_firstJob = 0;
+    QList< QStringList > m_completedSections;
+    bool m_lastSection = true;
+
+    /** @brief Saves GlobalStorage and the jobs done so far
+     *
+     * The checkpoint lists the jobs of each *exec* section that
+     * completed (*sections*), and the jobs done so far in the current
+     * one (*done*, the first @p done jobs).
+     *
+     * GlobalStorage is saved first, under a temporary name, and then
+     * renamed, so a checkpoint file always goes with the GlobalStorage
+     * it was written with. GlobalStorage holds (obscured) passwords,
+     * so the files are only readable by the user.
+     */
+    void checkpoint( int done )
+    {
+        CalamaresUtils::UMask m( CalamaresUtils::UMask::Safe );
+
+        const QString storage = checkpointStorageFile();
+        const QString newStorage = storage + QStringLiteral( ".new" );
+        if ( !m_queue->globalStorage()->save( newStorage )
+             || ::rename( QFile::encodeName( newStorage ).constData(), QFile::encodeName( storage ).constData() ) )
+        {
+            cWarning() << "Could not save checkpoint" << storage;
+            return;
+        }
+
+        QJsonArray sections;
+        for ( const auto& section : m_completedSections )
+        {
+            sections.append( QJsonArray::fromStringList( section ) );
+        }
+        const QJsonArray doneJobs = QJsonArray::fromStringList( jobIdentities( m_jobs.mid( 0, done ) ) );
+        QSaveFile f( checkpointFile() );
+        if ( !f.open( QIODevice::WriteOnly ) )
+        {
+            cWarning() << "Could not save checkpoint" << f.fileName();
+            return;
+        }
+        f.write( QJsonDocument(
+                     QJsonObject { { QStringLiteral( "sections" ), sections }, { QStringLiteral( "done" ), doneJobs } } )
+                     .toJson() );
+        if ( !f.commit() )
+        {
+            cWarning() << "Could not save checkpoint" << f.fileName();
+        }
+    }
+
+    /// @brief Logs a table of the resources used by each job
+    static void logStatistics( const QVariantList& statistics )
+    {
+        Logger::CDebug log;
+        log.noquote() << "Job resource usage (wall, user, system ms; process peak RSS KiB; read, written KiB):";
+        for ( const auto& v : statistics )
+        {
+            const QVariantMap m = v.toMap();
+            log << Logger::Continuation
+                << QStringLiteral( "%1 %2 %3 %4 %5 %6 %7" )
+                       .arg( m.value( "wallTime" ).toLongLong(), 8 )
+                       .arg( m.value( "userTime" ).toLongLong(), 8 )
+                       .arg( m.value( "systemTime" ).toLongLong(), 8 )
+                       .arg( m.value( "maxRss" ).toLongLong(), 8 )
+                       .arg( m.value( "readBytes" ).toLongLong() / 1024, 10 )
+                       .arg( m.value( "writeBytes" ).toLongLong() / 1024, 10 )
+                       .arg( m.value( "name" ).toString() );
+        }
+    }
+
+    static JobResult execJob( const job_ptr& job )
+    {
+        CalamaresUtils::Trace::Span span( "job", job->prettyName() );
+        return job->exec();
+    }
+
     JobQueue* m_queue;
     int m_jobIndex;
 
@@ -176,6 +358,7 @@ JobQueue::JobQueue( QObject* parent )
 
 JobQueue::~JobQueue()
 {
+    s_instance = nullptr;
     if ( m_thread->isRunning() )
     {
         m_thread->terminate();
@@ -194,12 +377,135 @@ void
 JobQueue::start()
 {
     Q_ASSERT( !m_thread->isRunning() );
-    m_thread->setJobs( std::move( m_jobs ) );
+    int first = 0;
+    if ( m_resume )
+    {
+        first = resumeIndex( m_jobs );
+    }
+    else if ( m_section == 0 )
+    {
+        removeCheckpoint();
+    }
+
+    const int sections = execSectionCount();
+    const QStringList identities = jobIdentities( m_jobs );
+    m_thread->setJobs( std::move( m_jobs ), first, m_completedSections, sections >= 0 && m_section + 1 >= sections );
     m_jobs.clear();
+    // The next start() only happens if all of these jobs succeed
+    m_completedSections.append( identities );
+    ++m_section;
     m_thread->start();
 }
 
 
+static QStringList
+toStringList( const QJsonValue& v )
+{
+    QStringList l;
+    for ( const auto& item : v.toArray() )
+    {
+        l.append( item.toString() );
+    }
+    return l;
+}
+
+int
+JobQueue::resumeIndex( const JobList& jobs )
+{
+    QFile f( checkpointFile() );
+    if ( !f.open( QIODevice::ReadOnly ) )
+    {
+        cDebug() << "There is no checkpoint to resume from.";
+        m_resume = false;
+        return 0;
+    }
+    const QJsonObject checkpoint = QJsonDocument::fromJson( f.readAll() ).object();
+    const QJsonArray sections = checkpoint.value( QStringLiteral( "sections" ) ).toArray();
+    const QStringList done = toStringList( checkpoint.value( QStringLiteral( "done" ) ) );
+    const QStringList identities = jobIdentities( jobs );
+
+    int first = 0;
+    if ( m_section < sections.count() )
+    {
+        // This whole section was done
+        const QStringList sectionDone = toStringList( sections.at( m_section ) );
+        if ( sectionDone != identities )
+        {
+            cWarning() << "The checkpoint does not match the jobs of section" << m_section << ", not resuming.";
+            m_resume = false;
+            return 0;
+        }
+        first = jobs.count();
+    }
+    else if ( m_section == sections.count() )
+    {
+        // This is the section that failed
+        if ( done.count() >= jobs.count() || done != identities.mid( 0, done.count() ) )
+        {
+            cWarning() << "The checkpoint does not match the jobs of section" << m_section << ", not resuming."
+                       << Logger::Continuation << "Done were" << done;
+            m_resume = false;
+            return 0;
+        }
+        first = done.count();
+        m_resume = false;  // Later sections run in full
+        if ( m_section == 0 && first == 0 )
+        {
+            cDebug() << "The checkpoint has nothing to resume.";
+            return 0;
+        }
+    }
+    else
+    {
+        cWarning() << "The checkpoint has no section" << m_section << ", not resuming.";
+        m_resume = false;
+        return 0;
+    }
+
+    if ( !m_resumed )
+    {
+        // The target system must still be there, mounted as before
+        GlobalStorage saved;
+        if ( !saved.load( checkpointStorageFile() ) )
+        {
+            cWarning() << "Could not read checkpoint" << checkpointStorageFile();
+            m_resume = false;
+            return 0;
+        }
+        const QString root = saved.value( "rootMountPoint" ).toString();
+        if ( !root.isEmpty() )
+        {
+            const QStringList mounted = CalamaresUtils::Partition::mountPointsUnder( root );
+            QStringList missing;
+            if ( !mounted.contains( root ) )
+            {
+                missing.append( root );
+            }
+            for ( const auto& p : saved.value( "partitions" ).toList() )
+            {
+                const QString mountPoint = p.toMap().value( "mountPoint" ).toString();
+                if ( mountPoint.startsWith( '/' ) && mountPoint != QStringLiteral( "/" )
+                     && !mounted.contains( root + mountPoint ) )
+                {
+                    missing.append( root + mountPoint );
+                }
+            }
+            if ( !missing.isEmpty() )
+            {
+                cWarning() << "The target system is no longer mounted, not resuming." << missing;
+                m_resume = false;
+                return 0;
+            }
+        }
+
+        m_storage->load( checkpointStorageFile() );
+        m_resumed = true;
+    }
+    cDebug() << "Resuming section" << m_section << "after" << first << "of" << jobs.count() << "jobs.";
+    return first;
+}
+
+
 void
 JobQueue::enqueue( const job_ptr& job )
 {
@@ -23,6 +23,7 @@
 #include "Job.h"
 
 #include <QObject>
+#include <QStringList>
 
 namespace Calamares
 {
@@ -30,6 +31,21 @@ namespace Calamares
 class GlobalStorage;
 class JobThread;
 
+/** @brief Runs jobs, in order, in a separate thread
+ *
+ * When the queue is done, GlobalStorage key *jobStatistics* holds
+ * a list with one map per job that was run, in this and earlier
+ * *exec* sections: the job's *name*, *success*, and the resources
+ * it used (see ResourceUsage::toMap()). The jobs of this section are
+ * also logged as a table.
+ *
+ * The queue is started once for each *exec* section. After each job
+ * that succeeds, the queue saves a checkpoint next to the log file:
+ * GlobalStorage, the jobs of the sections that completed, and the jobs
+ * done so far in the current one. The checkpoint is removed when all
+ * the jobs of the last section succeed; after a failure, a new session
+ * can resume from it (see setResume()).
+ */
 class DLLEXPORT JobQueue : public QObject
 {
     Q_OBJECT
@@ -45,6 +61,17 @@ public:
     void enqueue( const JobList& jobs );
     void start();
 
+    /** @brief Resume from the checkpoint of an earlier run, in start()
+     *
+     * The jobs the checkpoint lists as done are skipped: whole *exec*
+     * sections that completed, and the jobs that succeeded in the section
+     * that failed. GlobalStorage is restored from the checkpoint. That only
+     * happens if the same jobs were queued again (so the same choices must
+     * be made in the UI), and the target system is still mounted where it
+     * was; from the first section that does not match, all jobs are run.
+     */
+    void setResume( bool resume ) { m_resume = resume; }
+
 signals:
     void queueChanged( const JobList& jobs );
     void progress( qreal percent, const QString& prettyName );
@@ -57,6 +84,18 @@ private:
     JobList m_jobs;
     JobThread* m_thread;
     GlobalStorage* m_storage;
+    bool m_resume = false;
+    bool m_resumed = false;  ///< GlobalStorage was restored from the checkpoint
+    int m_section = 0;  ///< Index of the *exec* section that start() runs next
+    QList< QStringList > m_completedSections;  ///< Job identities of each section started so far
+
+    /** @brief How many of @p jobs the checkpoint says are done
+     *
+     * This is for the current section; GlobalStorage is restored
+     * from the checkpoint the first time something is skipped.
+     * Stops resuming if the checkpoint does not match.
+     */
+    int resumeIndex( const JobList& jobs );
 };
 
 }  // namespace Calamares
@@ -159,6 +159,23 @@ BOOST_PYTHON_MODULE( libcalamares )
              "Returns list of languages (most to least-specific) for gettext." );
 
     bp::def( "gettext_path", &CalamaresPython::gettext_path, "Returns path for gettext search." );
+
+    bp::def( "request_initramfs",
+             &CalamaresPython::request_initramfs,
+             bp::args( "reason" ),
+             "Asks for the initramfs of the target system to be regenerated,\n"
+             "by the module that does so later on." );
+    bp::def( "defer_initramfs_hooks",
+             &CalamaresPython::defer_initramfs_hooks,
+             "Masks the package manager's hooks that regenerate the initramfs,\n"
+             "if a later module regenerates it anyway. Returns true if masked." );
+    bp::def( "initramfs_needed",
+             &CalamaresPython::initramfs_needed,
+             "Returns true unless the initramfs was regenerated already\n"
+             "and nothing asked for it again since." );
+    bp::def( "initramfs_regenerated",
+             &CalamaresPython::initramfs_regenerated,
+             "Records that the initramfs was regenerated, and unmasks the hooks." );
 }
 
 
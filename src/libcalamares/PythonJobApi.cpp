@@ -24,6 +24,7 @@
 #include "PythonHelper.h"
 #include "partition/Mount.h"
 #include "utils/CalamaresUtilsSystem.h"
+#include "utils/Initramfs.h"
 #include "utils/Logger.h"
 #include "utils/String.h"
 
@@ -184,6 +185,30 @@ obscure( const std::string& string )
     return CalamaresUtils::obscure( QString::fromStdString( string ) ).toStdString();
 }
 
+void
+request_initramfs( const std::string& reason )
+{
+    CalamaresUtils::Initramfs::requestRegeneration( QString::fromStdString( reason ) );
+}
+
+bool
+defer_initramfs_hooks()
+{
+    return CalamaresUtils::Initramfs::deferHooks();
+}
+
+bool
+initramfs_needed()
+{
+    return CalamaresUtils::Initramfs::isRegenerationNeeded();
+}
+
+void
+initramfs_regenerated()
+{
+    CalamaresUtils::Initramfs::regenerated();
+}
+
 static QStringList
 _gettext_languages()
 {
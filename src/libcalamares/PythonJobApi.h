@@ -57,6 +57,11 @@ boost::python::object gettext_path();
 
 boost::python::list gettext_languages();
 
+void request_initramfs( const std::string& reason );
+bool defer_initramfs_hooks();
+bool initramfs_needed();
+void initramfs_regenerated();
+
 void debug( const std::string& s );
 void warning( const std::string& s );
 
@@ -209,6 +209,7 @@ Settings::Settings( const QString& settingsFilePath, bool debugMode )
     , m_promptInstall( false )
     , m_disableCancel( false )
     , m_disableCancelDuringExec( false )
+    , m_lazyLoading( false )
 {
     cDebug() << "Using Calamares settings file at" << settingsFilePath;
     QFile file( settingsFilePath );
@@ -232,6 +233,8 @@ Settings::Settings( const QString& settingsFilePath, bool debugMode )
             m_isSetupMode = requireBool( config, "oem-setup", !m_doChroot );
             m_disableCancel = requireBool( config, "disable-cancel", false );
             m_disableCancelDuringExec = requireBool( config, "disable-cancel-during-exec", false );
+            // Optional, so don't complain if it is missing
+            m_lazyLoading = hasValue( config[ "lazy-loading" ] ) ? config[ "lazy-loading" ].as< bool >() : false;
         }
         catch ( YAML::Exception& e )
         {
@@ -101,6 +101,13 @@ public:
     /** @brief Temporary setting of disable-cancel: can't cancel during exec. */
     bool disableCancelDuringExec() const { return m_disableCancelDuringExec; }
 
+    /** @brief Global setting of lazy-loading.
+     *
+     * When true, the plugins for job modules in *exec* sections
+     * are only loaded when the job queue for that section is built.
+     */
+    bool lazyLoading() const { return m_lazyLoading; }
+
 private:
     static Settings* s_instance;
 
@@ -117,6 +124,7 @@ private:
     bool m_promptInstall;
     bool m_disableCancel;
     bool m_disableCancelDuringExec;
+    bool m_lazyLoading;
 };
 
 }  // namespace Calamares
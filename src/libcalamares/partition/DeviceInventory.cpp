@@ -0,0 +1,327 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DeviceInventory.h"
+
+#include "utils/Logger.h"
+#include "utils/Trace.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <linux/netlink.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace CalamaresUtils
+{
+namespace Partition
+{
+
+static QByteArray
+readAttribute( const QString& path )
+{
+    QFile f( path );
+    if ( f.open( QIODevice::ReadOnly ) )
+    {
+        return f.readAll().trimmed();
+    }
+    return QByteArray();
+}
+
+static QStringList
+partitionsOf( const QDir& deviceDir )
+{
+    // Partitions are subdirectories with a "partition" attribute
+    // holding the partition number; sort by that number, like
+    // /proc/partitions does, so sda2 comes before sda10.
+    QList< QPair< int, QString > > numbered;
+    for ( const QString& sub : deviceDir.entryList( QDir::Dirs | QDir::NoDotAndDotDot ) )
+    {
+        QByteArray number = readAttribute( deviceDir.filePath( sub + QStringLiteral( "/partition" ) ) );
+        if ( !number.isEmpty() )
+        {
+            numbered.append( qMakePair( number.toInt(), sub ) );
+        }
+    }
+    std::sort( numbered.begin(), numbered.end() );
+
+    QStringList partitions;
+    for ( const auto& p : numbered )
+    {
+        partitions.append( p.second );
+    }
+    return partitions;
+}
+
+static QString
+kernelName( const QString& name )
+{
+    return name.startsWith( QStringLiteral( "/dev/" ) ) ? name.mid( 5 ) : name;
+}
+
+BlockDevice
+diskFor( const BlockDeviceList& devices, const QString& name )
+{
+    const QString kernel = kernelName( name );
+    for ( const auto& d : devices )
+    {
+        if ( d.name == kernel || d.partitions.contains( kernel ) )
+        {
+            return d;
+        }
+    }
+    return BlockDevice();
+}
+
+bool
+DeviceInventory::isSupported()
+{
+    return QFileInfo( QStringLiteral( "/sys/block" ) ).isDir();
+}
+
+BlockDeviceList
+DeviceInventory::scan( const QString& sysBlockPath )
+{
+    QDir sysBlock( sysBlockPath.isEmpty() ? QStringLiteral( "/sys/block" ) : sysBlockPath );
+
+    BlockDeviceList devices;
+    for ( const QString& name : sysBlock.entryList( QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name ) )
+    {
+        QDir deviceDir( sysBlock.filePath( name ) );
+
+        BlockDevice d;
+        d.name = name;
+        // The size attribute is always in 512-byte sectors, whatever the logical block size.
+        d.size = readAttribute( deviceDir.filePath( QStringLiteral( "size" ) ) ).toLongLong() * 512;
+        d.readOnly = readAttribute( deviceDir.filePath( QStringLiteral( "ro" ) ) ) == "1";
+        d.removable = readAttribute( deviceDir.filePath( QStringLiteral( "removable" ) ) ) == "1";
+        // Software RAID arrays have no device link, but have an md/ directory
+        d.isDisk = ( QFileInfo::exists( deviceDir.filePath( QStringLiteral( "device" ) ) )
+                     && !name.startsWith( QStringLiteral( "fd" ) ) )
+            || QFileInfo( deviceDir.filePath( QStringLiteral( "md" ) ) ).isDir();
+        // SCSI peripheral type 5 is CD/DVD
+        d.isCdrom = name.startsWith( QStringLiteral( "sr" ) )
+            || readAttribute( deviceDir.filePath( QStringLiteral( "device/type" ) ) ) == "5";
+        d.rotational = readAttribute( deviceDir.filePath( QStringLiteral( "queue/rotational" ) ) ) != "0";
+        d.discardGranularity
+            = readAttribute( deviceDir.filePath( QStringLiteral( "queue/discard_granularity" ) ) ).toLongLong();
+        d.dax = readAttribute( deviceDir.filePath( QStringLiteral( "queue/dax" ) ) ) == "1";
+        d.partitions = partitionsOf( deviceDir );
+        devices.append( d );
+    }
+    return devices;
+}
+
+DeviceInventory*
+DeviceInventory::instance()
+{
+    static auto* s_inventory = new DeviceInventory();
+    return s_inventory;
+}
+
+DeviceInventory::DeviceInventory( QObject* parent )
+    : QObject( parent )
+{
+#ifdef Q_OS_LINUX
+    int fd = ::socket( AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT );
+    if ( fd >= 0 )
+    {
+        struct sockaddr_nl address;
+        memset( &address, 0, sizeof( address ) );
+        address.nl_family = AF_NETLINK;
+        address.nl_groups = 1;  // Kernel uevents (udev re-broadcasts on group 2)
+        if ( ::bind( fd, reinterpret_cast< struct sockaddr* >( &address ), sizeof( address ) ) == 0 )
+        {
+            m_ueventSocket = fd;
+        }
+        else
+        {
+            cWarning() << "Could not listen for device events," << strerror( errno );
+            ::close( fd );
+        }
+    }
+#endif
+
+    // The socket is drained by every query anyway; the notifier
+    // only serves to emit changed() promptly, so it lives in the GUI thread.
+    if ( QCoreApplication::instance() )
+    {
+        moveToThread( QCoreApplication::instance()->thread() );
+        QMetaObject::invokeMethod( this, "startMonitor", Qt::QueuedConnection );
+    }
+}
+
+DeviceInventory::~DeviceInventory()
+{
+#ifdef Q_OS_LINUX
+    if ( m_ueventSocket >= 0 )
+    {
+        ::close( m_ueventSocket );
+    }
+#endif
+}
+
+void
+DeviceInventory::startMonitor()
+{
+    if ( m_ueventSocket >= 0 && !m_notifier )
+    {
+        m_notifier = new QSocketNotifier( m_ueventSocket, QSocketNotifier::Read, this );
+        connect( m_notifier, &QSocketNotifier::activated, this, &DeviceInventory::onUevent );
+    }
+}
+
+void
+DeviceInventory::onUevent()
+{
+    bool changes = false;
+    {
+        QMutexLocker lock( &m_mutex );
+        changes = drainEvents();
+    }
+    if ( changes )
+    {
+        emit changed();
+    }
+}
+
+bool
+DeviceInventory::drainEvents()
+{
+    bool changes = false;
+#ifdef Q_OS_LINUX
+    if ( m_ueventSocket < 0 )
+    {
+        return false;
+    }
+
+    char buffer[ 8192 ];
+    while ( true )
+    {
+        struct sockaddr_nl sender;
+        socklen_t senderLength = sizeof( sender );
+        ssize_t r = ::recvfrom(
+            m_ueventSocket, buffer, sizeof( buffer ), 0, reinterpret_cast< struct sockaddr* >( &sender ), &senderLength );
+        if ( r < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            if ( errno == ENOBUFS )
+            {
+                // Events were dropped because nobody read them; assume the worst.
+                changes = true;
+                continue;
+            }
+            break;  // EAGAIN, nothing left to read
+        }
+        if ( r == 0 )
+        {
+            break;
+        }
+        if ( sender.nl_pid != 0 )
+        {
+            continue;  // Not from the kernel
+        }
+
+        // A uevent is "action@devpath" followed by NUL-separated KEY=VALUE lines
+        const auto fields = QByteArray::fromRawData( buffer, static_cast< int >( r ) ).split( '\0' );
+        if ( fields.contains( QByteArrayLiteral( "SUBSYSTEM=block" ) ) )
+        {
+            changes = true;
+        }
+    }
+    if ( changes )
+    {
+        m_stale = true;
+    }
+#endif
+    return changes;
+}
+
+void
+DeviceInventory::ensureCurrent()
+{
+    drainEvents();
+    if ( m_stale )
+    {
+        CalamaresUtils::Trace::Span span( "storage", "DeviceInventory::scan" );
+        m_devices = scan();
+        m_stale = false;
+    }
+}
+
+void
+DeviceInventory::refresh()
+{
+    QtConcurrent::run( [this]() {
+        QMutexLocker lock( &m_mutex );
+        m_stale = true;
+        ensureCurrent();
+        cDebug() << "Device inventory has" << m_devices.count() << "block devices.";
+    } );
+}
+
+BlockDeviceList
+DeviceInventory::devices()
+{
+    QMutexLocker lock( &m_mutex );
+    ensureCurrent();
+    return m_devices;
+}
+
+BlockDeviceList
+DeviceInventory::installableDevices( qint64 minimumSize )
+{
+    BlockDeviceList l;
+    for ( const auto& d : devices() )
+    {
+        if ( d.isInstallable() && ( minimumSize < 0 || d.size >= minimumSize ) )
+        {
+            l.append( d );
+        }
+    }
+    return l;
+}
+
+BlockDevice
+DeviceInventory::device( const QString& name )
+{
+    const QString kernel = kernelName( name );
+    for ( const auto& d : devices() )
+    {
+        if ( d.name == kernel )
+        {
+            return d;
+        }
+    }
+    return BlockDevice();
+}
+
+}  // namespace Partition
+}  // namespace CalamaresUtils
@@ -0,0 +1,142 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARTITION_DEVICEINVENTORY_H
+#define PARTITION_DEVICEINVENTORY_H
+
+#include "DllMacro.h"
+
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QSocketNotifier;
+
+namespace CalamaresUtils
+{
+namespace Partition
+{
+
+/** @brief Description of one block device, as the kernel sees it
+ *
+ * This is filled from sysfs (/sys/block), which is cheap to read:
+ * no device is opened or probed.
+ */
+struct BlockDevice
+{
+    QString name;  ///< Kernel name, e.g. "sda" or "nvme0n1"
+    qint64 size = 0;  ///< Size in bytes
+    bool readOnly = false;
+    bool removable = false;
+    /// Backed by real hardware or software RAID (so not loop, ram, zram, device-mapper, floppy)
+    bool isDisk = false;
+    bool isCdrom = false;
+    bool rotational = true;  ///< Spinning disk; false for SSDs, NVMe and the like
+    qint64 discardGranularity = 0;  ///< Smallest discard (TRIM) in bytes; 0 if discard is not supported
+    bool dax = false;  ///< Supports direct access (persistent memory)
+    QStringList partitions;  ///< Kernel names of partitions, e.g. "sda1"
+
+    bool isValid() const { return !name.isEmpty(); }
+    QString devicePath() const { return QStringLiteral( "/dev/" ) + name; }
+    /// @brief Could this device be installed to? (disk, writable, not a CD)
+    bool isInstallable() const { return isDisk && !readOnly && !isCdrom && size > 0; }
+    bool supportsDiscard() const { return discardGranularity > 0; }
+};
+
+using BlockDeviceList = QList< BlockDevice >;
+
+/** @brief Find the device that holds @p name in @p devices
+ *
+ * The @p name may be a kernel name ("sda2") or a device path ("/dev/sda2").
+ * If it names a partition, the disk holding that partition is returned.
+ * Returns an invalid BlockDevice if there is no such device or partition.
+ */
+DLLEXPORT BlockDevice diskFor( const BlockDeviceList& devices, const QString& name );
+
+/** @brief Shared, cached list of block devices in the live system
+ *
+ * Several places in Calamares want to know what disks there are:
+ * the welcome module (is there a disk big enough?), the partition
+ * module (which disks should KPMcore look at?) and the jobs that
+ * tidy up before partitioning (which partitions does a disk have?).
+ * Rather than each of them probing all of the storage, they ask
+ * the inventory.
+ *
+ * The inventory is filled in the background by refresh(), which the
+ * application calls at startup. It listens to kernel uevents
+ * for the block subsystem; after a change, the next query re-reads
+ * sysfs before answering. Queries are thread-safe, and block only
+ * when a (re)scan is in progress.
+ */
+class DLLEXPORT DeviceInventory : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// @brief The inventory (created on first use)
+    static DeviceInventory* instance();
+
+    /// @brief Is there a sysfs to read devices from?
+    static bool isSupported();
+
+    /** @brief Read all block devices from @p sysBlockPath
+     *
+     * This does not touch the inventory; an empty @p sysBlockPath
+     * means /sys/block. The list is sorted by name.
+     */
+    static BlockDeviceList scan( const QString& sysBlockPath = QString() );
+
+    /// @brief Re-read the devices in a background thread
+    void refresh();
+
+    /// @brief All block devices
+    BlockDeviceList devices();
+    /// @brief Devices that are installable and larger than @p minimumSize (if not negative)
+    BlockDeviceList installableDevices( qint64 minimumSize = -1 );
+    /** @brief Look up a single device
+     *
+     * The @p name may be a kernel name ("sda") or a device path ("/dev/sda").
+     * Returns an invalid BlockDevice if there is no such device.
+     */
+    BlockDevice device( const QString& name );
+
+signals:
+    /// @brief Emitted (in the GUI thread) when a block device is added, removed or changed
+    void changed();
+
+private:
+    explicit DeviceInventory( QObject* parent = nullptr );
+    ~DeviceInventory() override;
+
+    Q_INVOKABLE void startMonitor();
+    void onUevent();
+
+    bool drainEvents();  // Call with m_mutex held
+    void ensureCurrent();  // Call with m_mutex held
+
+    QMutex m_mutex;
+    BlockDeviceList m_devices;
+    bool m_stale = true;
+    int m_ueventSocket = -1;
+    QSocketNotifier* m_notifier = nullptr;
+};
+
+}  // namespace Partition
+}  // namespace CalamaresUtils
+
+#endif  // PARTITION_DEVICEINVENTORY_H
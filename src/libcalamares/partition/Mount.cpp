@@ -24,7 +24,22 @@
 #include "utils/Logger.h"
 
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QTemporaryDir>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <map>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <sys/mount.h>
+#endif
 
 namespace CalamaresUtils
 {
@@ -92,6 +107,357 @@ unmount( const QString& path, const QStringList& options )
     return r.getExitCode();
 }
 
+#ifdef Q_OS_LINUX
+struct MountFlag
+{
+    const char* name;
+    unsigned long set;
+    unsigned long clear;
+};
+
+static const MountFlag s_mountFlags[] = {
+    { "ro", MS_RDONLY, 0 },
+    { "rw", 0, MS_RDONLY },
+    { "nosuid", MS_NOSUID, 0 },
+    { "suid", 0, MS_NOSUID },
+    { "nodev", MS_NODEV, 0 },
+    { "dev", 0, MS_NODEV },
+    { "noexec", MS_NOEXEC, 0 },
+    { "exec", 0, MS_NOEXEC },
+    { "sync", MS_SYNCHRONOUS, 0 },
+    { "async", 0, MS_SYNCHRONOUS },
+    { "dirsync", MS_DIRSYNC, 0 },
+    { "mand", MS_MANDLOCK, 0 },
+    { "nomand", 0, MS_MANDLOCK },
+    { "noatime", MS_NOATIME, 0 },
+    { "atime", 0, MS_NOATIME },
+    { "nodiratime", MS_NODIRATIME, 0 },
+    { "diratime", 0, MS_NODIRATIME },
+    { "relatime", MS_RELATIME, 0 },
+    { "norelatime", 0, MS_RELATIME },
+    { "strictatime", MS_STRICTATIME, 0 },
+#ifdef MS_LAZYTIME
+    { "lazytime", MS_LAZYTIME, 0 },
+    { "nolazytime", 0, MS_LAZYTIME },
+#endif
+    { "silent", MS_SILENT, 0 },
+    { "loud", 0, MS_SILENT },
+    { "bind", MS_BIND, 0 },
+    { "rbind", MS_BIND | MS_REC, 0 },
+    { "remount", MS_REMOUNT, 0 },
+};
+#endif
+
+/// Options that are for mount(8) or fstab, not for the kernel
+static bool
+isUserspaceOption( const QString& option )
+{
+    static const QStringList userspace { "defaults", "auto", "noauto", "user",   "nouser",
+                                         "users",    "owner", "group", "nofail", "_netdev" };
+    return userspace.contains( option ) || option.startsWith( QStringLiteral( "x-" ) )
+        || option.startsWith( QStringLiteral( "comment=" ) );
+}
+
+QString
+mountFlags( const QString& options, unsigned long& flags )
+{
+    QStringList data;
+    for ( const QString& option : options.split( ',', QString::SkipEmptyParts ) )
+    {
+        const QString o = option.trimmed();
+        if ( o.isEmpty() || isUserspaceOption( o ) )
+        {
+            continue;
+        }
+#ifdef Q_OS_LINUX
+        const MountFlag* f = std::find_if( std::begin( s_mountFlags ),
+                                           std::end( s_mountFlags ),
+                                           [&o]( const MountFlag& m ) { return o == QLatin1String( m.name ); } );
+        if ( f != std::end( s_mountFlags ) )
+        {
+            flags = ( flags & ~f->clear ) | f->set;
+            continue;
+        }
+#endif
+        data.append( o );
+    }
+    return data.join( ',' );
+}
+
+int
+mountPointDepth( const QString& path )
+{
+    return path.split( '/', QString::SkipEmptyParts ).count();
+}
+
+#ifdef Q_OS_LINUX
+/// Does mount(8) run a helper program (e.g. mount.ntfs) for @p filesystemName?
+static bool
+hasMountHelper( const QString& filesystemName )
+{
+    for ( const char* dir : { "/sbin/mount.", "/usr/sbin/mount.", "/usr/bin/mount." } )
+    {
+        if ( QFileInfo::exists( QLatin1String( dir ) + filesystemName ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Filesystems the kernel can mount from a block device, in the order mount(8) tries them
+static QStringList
+blockFilesystems()
+{
+    QStringList names;
+    QFile f( QStringLiteral( "/proc/filesystems" ) );
+    if ( f.open( QIODevice::ReadOnly ) )
+    {
+        for ( const QByteArray& line : f.readAll().split( '\n' ) )
+        {
+            // Lines are "nodev<TAB>proc" or "<TAB>ext4"
+            if ( !line.isEmpty() && !line.startsWith( "nodev" ) )
+            {
+                names.append( QString::fromLatin1( line.trimmed() ) );
+            }
+        }
+    }
+    return names;
+}
+#endif
+
+int
+mountNative( const QString& devicePath,
+             const QString& mountPoint,
+             const QString& filesystemName,
+             const QString& options )
+{
+#ifdef Q_OS_LINUX
+    if ( devicePath.isEmpty() || mountPoint.isEmpty() )
+    {
+        cWarning() << "Can't mount" << devicePath << "on" << mountPoint;
+        return EINVAL;
+    }
+
+    unsigned long flags = 0;
+    QString data;
+    if ( options == QStringLiteral( "--bind" ) || options == QStringLiteral( "--rbind" ) )
+    {
+        flags = options == QStringLiteral( "--bind" ) ? MS_BIND : ( MS_BIND | MS_REC );
+    }
+    else if ( options.startsWith( '-' ) || ( devicePath.contains( '=' ) && !devicePath.startsWith( '/' ) )
+              || ( !filesystemName.isEmpty() && hasMountHelper( filesystemName ) ) )
+    {
+        // Leave the hard cases to mount(8)
+        return mount( devicePath, mountPoint, filesystemName, options ) ? EIO : 0;
+    }
+    else
+    {
+        data = mountFlags( options, flags );
+    }
+
+    if ( !QDir( mountPoint ).exists() && !QDir().mkpath( mountPoint ) )
+    {
+        cWarning() << "Could not create mountpoint" << mountPoint;
+        return ENOENT;
+    }
+
+    const QByteArray device = QFile::encodeName( devicePath );
+    const QByteArray target = QFile::encodeName( mountPoint );
+    const QByteArray dataBytes = data.toUtf8();
+
+    QStringList types;
+    if ( flags & ( MS_BIND | MS_REMOUNT ) )
+    {
+        types.append( QString() );  // The kernel ignores the type
+    }
+    else if ( !filesystemName.isEmpty() )
+    {
+        types.append( filesystemName );
+    }
+    else
+    {
+        types = blockFilesystems();
+    }
+
+    int error = ENODEV;
+    for ( const QString& type : types )
+    {
+        const QByteArray typeBytes = type.toLatin1();
+        if ( ::mount( device.constData(),
+                      target.constData(),
+                      type.isEmpty() ? nullptr : typeBytes.constData(),
+                      flags,
+                      dataBytes.isEmpty() ? nullptr : dataBytes.constData() )
+             == 0 )
+        {
+            error = 0;
+            break;
+        }
+        error = errno;
+        if ( error != EINVAL && error != ENODEV )
+        {
+            break;  // Wrong type gives EINVAL or ENODEV; anything else is a real problem
+        }
+    }
+
+    // Read-only bind mounts need a remount to become read-only
+    if ( !error && ( flags & MS_BIND ) && ( flags & MS_RDONLY )
+         && ::mount( nullptr, target.constData(), nullptr, MS_REMOUNT | MS_BIND | MS_RDONLY, nullptr ) != 0 )
+    {
+        error = errno;
+    }
+
+    if ( error )
+    {
+        cWarning() << "Could not mount" << devicePath << "on" << mountPoint << "type" << filesystemName << "options"
+                   << options << ':' << qt_error_string( error );
+    }
+    return error;
+#else
+    return mount( devicePath, mountPoint, filesystemName, options ) ? EIO : 0;
+#endif
+}
+
+int
+unmountNative( const QString& mountPoint, bool lazy )
+{
+#ifdef Q_OS_LINUX
+    const QByteArray target = QFile::encodeName( mountPoint );
+    if ( ::umount2( target.constData(), 0 ) == 0 )
+    {
+        return 0;
+    }
+    int error = errno;
+    if ( error == EBUSY && lazy )
+    {
+        if ( ::umount2( target.constData(), MNT_DETACH ) == 0 )
+        {
+            cWarning() << "Filesystem on" << mountPoint << "is busy, detached it lazily.";
+            return 0;
+        }
+        error = errno;
+    }
+    cWarning() << "Could not unmount" << mountPoint << ':' << qt_error_string( error );
+    return error;
+#else
+    return unmount( mountPoint, lazy ? QStringList { "-l" } : QStringList() ) ? EIO : 0;
+#endif
+}
+
+QString
+unescapeMountPath( const QByteArray& field )
+{
+    QByteArray path;
+    path.reserve( field.size() );
+    for ( int i = 0; i < field.size(); ++i )
+    {
+        if ( field[ i ] == '\\' && i + 3 < field.size() )
+        {
+            bool ok = false;
+            const int c = field.mid( i + 1, 3 ).toInt( &ok, 8 );
+            if ( ok )
+            {
+                path.append( char( c ) );
+                i += 3;
+                continue;
+            }
+        }
+        path.append( field[ i ] );
+    }
+    return QFile::decodeName( path );
+}
+
+QStringList
+mountPointsUnder( const QString& root, const QString& mountsFile )
+{
+    QStringList points;
+    if ( root.isEmpty() )
+    {
+        return points;
+    }
+    const QString base = root.endsWith( '/' ) && root.length() > 1 ? root.left( root.length() - 1 ) : root;
+    if ( base == QStringLiteral( "/" ) )
+    {
+        // Everything is below /; that is never what the caller means
+        cWarning() << "Will not list the mounts of the whole system.";
+        return points;
+    }
+    const QString prefix = base + '/';
+
+    QFile f( mountsFile.isEmpty() ? QStringLiteral( "/proc/self/mounts" ) : mountsFile );
+    if ( !f.open( QIODevice::ReadOnly ) )
+    {
+        cWarning() << "Could not read mount table" << f.fileName();
+        return points;
+    }
+    for ( const QByteArray& line : f.readAll().split( '\n' ) )
+    {
+        const auto fields = line.split( ' ' );
+        if ( fields.count() < 2 )
+        {
+            continue;
+        }
+        const QString mountPoint = unescapeMountPath( fields.at( 1 ) );
+        if ( mountPoint == base || mountPoint.startsWith( prefix ) )
+        {
+            points.append( mountPoint );
+        }
+    }
+    return points;
+}
+
+QStringList
+unmountAll( const QStringList& mountPoints, const std::function< int( const QString& ) >& unmount )
+{
+    struct Unmount
+    {
+        QString path;
+        int count;  // Number of mounts stacked on path
+    };
+
+    // Deepest first; the same path (stacked mounts) is one task
+    std::map< int, std::map< QString, int >, std::greater< int > > levels;
+    for ( const QString& p : mountPoints )
+    {
+        levels[ mountPointDepth( p ) ][ p ]++;
+    }
+
+    QMutex failuresMutex;
+    QStringList failures;
+    for ( const auto& level : levels )
+    {
+        QList< QFuture< void > > running;
+        for ( const auto& path : level.second )
+        {
+            const Unmount u { path.first, path.second };
+            running.append( QtConcurrent::run( [u, &unmount, &failures, &failuresMutex]() {
+                for ( int i = 0; i < u.count; ++i )
+                {
+                    int r = unmount( u.path );
+                    if ( r )
+                    {
+                        QMutexLocker lock( &failuresMutex );
+                        failures.append( QStringLiteral( "%1: %2" ).arg( u.path, qt_error_string( r ) ) );
+                        break;
+                    }
+                }
+            } ) );
+        }
+        for ( auto& f : running )
+        {
+            f.waitForFinished();
+        }
+    }
+    return failures;
+}
+
+QStringList
+unmountTree( const QString& root, bool lazy )
+{
+    return unmountAll( mountPointsUnder( root ), [lazy]( const QString& path ) { return unmountNative( path, lazy ); } );
+}
+
 struct TemporaryMount::Private
 {
     QString m_devicePath;
@@ -25,6 +25,8 @@
 #include <QString>
 #include <QStringList>
 
+#include <functional>
+
 namespace CalamaresUtils
 {
 namespace Partition
@@ -56,6 +58,86 @@ DLLEXPORT int mount( const QString& devicePath,
  */
 DLLEXPORT int unmount( const QString& path, const QStringList& options = QStringList() );
 
+/** @brief Split mount(8)-style @p options into mount(2) flags and data
+ *
+ * Options that the kernel knows as flags (e.g. ro, nosuid, noatime,
+ * bind) are OR-ed into @p flags. Options that only mean something
+ * to mount(8) (e.g. defaults, noauto, nofail) are dropped. All
+ * other options (e.g. subvol=@) are filesystem-specific; they are
+ * returned comma-separated, to be passed as the data argument.
+ */
+DLLEXPORT QString mountFlags( const QString& options, unsigned long& flags );
+
+/** @brief Mount with the mount(2) system call
+ *
+ * The parameters are as for mount(), and the mount point is created
+ * if needed, but no mount(8) process is started. A missing
+ * @p filesystemName is guessed from the filesystems the kernel
+ * supports. Calamares still uses mount(8) when
+ * it is needed: for filesystems that have a mount helper (such as
+ * ntfs-3g) and for devices given as LABEL= or UUID=.
+ *
+ * @returns 0 on success, otherwise an errno value (e.g. EBUSY);
+ *          use strerror() to describe it.
+ */
+DLLEXPORT int mountNative( const QString& devicePath,
+                           const QString& mountPoint,
+                           const QString& filesystemName = QString(),
+                           const QString& options = QString() );
+
+/** @brief Unmount @p mountPoint with the umount2(2) system call
+ *
+ * If the filesystem is busy and @p lazy is true, it is detached
+ * lazily instead (the kernel finishes the unmount once it is no
+ * longer in use, like umount -l).
+ *
+ * @returns 0 on success, otherwise an errno value.
+ */
+DLLEXPORT int unmountNative( const QString& mountPoint, bool lazy = true );
+
+/** @brief Mount points at or below @p root
+ *
+ * Reads @p mountsFile (default /proc/self/mounts), which lists
+ * mounts in the order in which they were mounted. A path that has
+ * more than one mount stacked on it is listed more than once.
+ * For "/" (every mount of the system), the list is empty.
+ */
+DLLEXPORT QStringList mountPointsUnder( const QString& root, const QString& mountsFile = QString() );
+
+/** @brief Unmount each of @p mountPoints with @p unmount
+ *
+ * Deeper mount points are unmounted first. Mount points at the same
+ * depth cannot be inside one another, so they are unmounted in
+ * parallel. A path listed more than once (stacked mounts) is
+ * unmounted that many times, by one task.
+ *
+ * @p unmount returns 0 on success, otherwise an errno value; it is
+ * called from several threads at once.
+ *
+ * @returns a description of each unmount that failed, so an empty
+ *          list means success.
+ */
+DLLEXPORT QStringList unmountAll( const QStringList& mountPoints,
+                                  const std::function< int( const QString& ) >& unmount );
+
+/** @brief Unmount everything at or below @p root
+ *
+ * The mount table is read once, and the mount points are unmounted
+ * with unmountNative(), as unmountAll() describes. If @p lazy is true,
+ * busy filesystems are detached lazily; otherwise they count as
+ * failures.
+ *
+ * @returns a description of each unmount that failed, so an empty
+ *          list means success.
+ */
+DLLEXPORT QStringList unmountTree( const QString& root, bool lazy = true );
+
+/// @brief Depth of @p path, the number of its directory components ("/" is 0)
+DLLEXPORT int mountPointDepth( const QString& path );
+
+/// @brief Undo the octal escapes (e.g. \040 for space) in a path from /proc/self/mounts or mountinfo
+DLLEXPORT QString unescapeMountPath( const QByteArray& field );
+
 class DLLEXPORT TemporaryMount
 {
 public:
@@ -18,10 +18,13 @@
 
 #include "Tests.h"
 
+#include "DeviceInventory.h"
+#include "Mount.h"
 #include "PartitionSize.h"
 
 using SizeUnit = CalamaresUtils::Partition::SizeUnit;
 using PartitionSize = CalamaresUtils::Partition::PartitionSize;
+using DeviceInventory = CalamaresUtils::Partition::DeviceInventory;
 
 Q_DECLARE_METATYPE( SizeUnit )
 
@@ -29,6 +32,18 @@ Q_DECLARE_METATYPE( SizeUnit )
 
 #include <QtTest/QtTest>
 
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QThreadPool>
+
+#include <errno.h>
+#ifdef Q_OS_LINUX
+#include <sys/mount.h>
+#endif
+
 QTEST_GUILESS_MAIN( PartitionSizeTests )
 
 PartitionSizeTests::PartitionSizeTests() {}
@@ -140,3 +155,199 @@ PartitionSizeTests::testUnitNormalisation()
 
     QCOMPARE( PartitionSize( v, u1 ).toBytes(), static_cast< qint64 >( bytes ) );
 }
+
+static void
+writeAttribute( const QDir& d, const QString& path, const QByteArray& value )
+{
+    QFileInfo fi( d.filePath( path ) );
+    QVERIFY( d.mkpath( fi.path() ) );
+    QFile f( fi.filePath() );
+    QVERIFY( f.open( QIODevice::WriteOnly ) );
+    f.write( value + '\n' );
+}
+
+void
+PartitionSizeTests::testDeviceInventoryScan()
+{
+    QTemporaryDir tempRoot;
+    QVERIFY( tempRoot.isValid() );
+    QDir sys( tempRoot.path() );
+
+    // A disk with three partitions, an NVMe disk, a RAID array, a CD, a loop device and zram
+    writeAttribute( sys, "sda/size", "2048" );
+    writeAttribute( sys, "sda/ro", "0" );
+    writeAttribute( sys, "sda/removable", "0" );
+    writeAttribute( sys, "sda/device/type", "0" );
+    writeAttribute( sys, "sda/sda1/partition", "1" );
+    writeAttribute( sys, "sda/sda2/partition", "2" );
+    writeAttribute( sys, "sda/sda10/partition", "10" );
+    writeAttribute( sys, "sda/queue/rotational", "1" );
+    writeAttribute( sys, "nvme0n1/size", "4096" );
+    writeAttribute( sys, "nvme0n1/device/type", "0" );
+    writeAttribute( sys, "nvme0n1/queue/rotational", "0" );
+    writeAttribute( sys, "nvme0n1/queue/discard_granularity", "512" );
+    writeAttribute( sys, "nvme0n1/queue/dax", "0" );
+    writeAttribute( sys, "nvme0n1/nvme0n1p1/partition", "1" );
+    writeAttribute( sys, "sr0/size", "1024" );
+    writeAttribute( sys, "sr0/ro", "0" );
+    writeAttribute( sys, "sr0/removable", "1" );
+    writeAttribute( sys, "sr0/device/type", "5" );
+    writeAttribute( sys, "loop0/size", "4096" );
+    writeAttribute( sys, "loop0/ro", "1" );
+    writeAttribute( sys, "zram0/size", "4096" );
+    writeAttribute( sys, "md127/size", "8192" );
+    writeAttribute( sys, "md127/md/level", "raid1" );
+    writeAttribute( sys, "md127/md127p1/partition", "1" );
+
+    const auto devices = DeviceInventory::scan( sys.path() );
+    QCOMPARE( devices.count(), 6 );
+    QCOMPARE( devices.at( 0 ).name, QStringLiteral( "loop0" ) );
+    QCOMPARE( devices.at( 1 ).name, QStringLiteral( "md127" ) );
+    QCOMPARE( devices.at( 2 ).name, QStringLiteral( "nvme0n1" ) );
+    QCOMPARE( devices.at( 3 ).name, QStringLiteral( "sda" ) );
+    QCOMPARE( devices.at( 4 ).name, QStringLiteral( "sr0" ) );
+    QCOMPARE( devices.at( 5 ).name, QStringLiteral( "zram0" ) );
+
+    const auto& sda = devices.at( 3 );
+    QCOMPARE( sda.size, 2048 * 512LL );
+    QCOMPARE( sda.devicePath(), QStringLiteral( "/dev/sda" ) );
+    QCOMPARE( sda.partitions, QStringList( { "sda1", "sda2", "sda10" } ) );
+    QVERIFY( sda.isInstallable() );
+    QVERIFY( sda.rotational );
+    QVERIFY( !sda.supportsDiscard() );
+
+    const auto& nvme = devices.at( 2 );
+    QVERIFY( !nvme.rotational );
+    QVERIFY( nvme.supportsDiscard() );
+    QCOMPARE( nvme.discardGranularity, 512LL );
+    QVERIFY( !nvme.dax );
+
+    // Software RAID has no device link, but can be installed to
+    const auto& md = devices.at( 1 );
+    QVERIFY( md.isDisk );
+    QVERIFY( md.isInstallable() );
+    QCOMPARE( md.partitions, QStringList( { "md127p1" } ) );
+
+    QVERIFY( devices.at( 0 ).readOnly );
+    QVERIFY( !devices.at( 0 ).isInstallable() );
+    QVERIFY( devices.at( 4 ).isCdrom );
+    QVERIFY( devices.at( 4 ).removable );
+    QVERIFY( !devices.at( 4 ).isInstallable() );
+    QVERIFY( !devices.at( 5 ).isDisk );
+    QVERIFY( !devices.at( 5 ).isInstallable() );
+
+    using CalamaresUtils::Partition::diskFor;
+    QCOMPARE( diskFor( devices, QStringLiteral( "/dev/sda10" ) ).name, QStringLiteral( "sda" ) );
+    QCOMPARE( diskFor( devices, QStringLiteral( "nvme0n1p1" ) ).name, QStringLiteral( "nvme0n1" ) );
+    QCOMPARE( diskFor( devices, QStringLiteral( "/dev/nvme0n1" ) ).name, QStringLiteral( "nvme0n1" ) );
+    QVERIFY( !diskFor( devices, QStringLiteral( "/dev/mapper/luks-home" ) ).isValid() );
+}
+
+void
+PartitionSizeTests::testMountFlags()
+{
+    using CalamaresUtils::Partition::mountFlags;
+
+    unsigned long flags = 0;
+    QCOMPARE( mountFlags( QString(), flags ), QString() );
+    QCOMPARE( flags, 0UL );
+    QCOMPARE( mountFlags( QStringLiteral( "defaults,noauto,x-systemd.automount" ), flags ), QString() );
+    QCOMPARE( flags, 0UL );
+
+    // Filesystem-specific options are passed on, in order
+    QCOMPARE( mountFlags( QStringLiteral( "subvol=@,compress=zstd" ), flags ),
+              QStringLiteral( "subvol=@,compress=zstd" ) );
+
+#ifdef Q_OS_LINUX
+    flags = 0;
+    QCOMPARE( mountFlags( QStringLiteral( "noatime,subvol=@home,ro" ), flags ), QStringLiteral( "subvol=@home" ) );
+    QCOMPARE( flags, static_cast< unsigned long >( MS_NOATIME | MS_RDONLY ) );
+
+    // Later options win
+    flags = 0;
+    QCOMPARE( mountFlags( QStringLiteral( "ro,nosuid,rw" ), flags ), QString() );
+    QCOMPARE( flags, static_cast< unsigned long >( MS_NOSUID ) );
+
+    flags = 0;
+    QCOMPARE( mountFlags( QStringLiteral( "bind" ), flags ), QString() );
+    QCOMPARE( flags, static_cast< unsigned long >( MS_BIND ) );
+#endif
+}
+
+void
+PartitionSizeTests::testMountPointsUnder()
+{
+    using CalamaresUtils::Partition::mountPointDepth;
+    using CalamaresUtils::Partition::mountPointsUnder;
+
+    QCOMPARE( mountPointDepth( QStringLiteral( "/" ) ), 0 );
+    QCOMPARE( mountPointDepth( QStringLiteral( "/boot/efi" ) ), 2 );
+    QCOMPARE( mountPointDepth( QStringLiteral( "/tmp/calamares-root-x/" ) ), 2 );
+
+    QTemporaryFile mounts;
+    QVERIFY( mounts.open() );
+    mounts.write( "/dev/sda2 / ext4 rw,relatime 0 0\n"
+                  "proc /proc proc rw,nosuid,nodev,noexec,relatime 0 0\n"
+                  "/dev/sdb1 /tmp/calamares-root-x ext4 rw 0 0\n"
+                  "/dev/sdb2 /tmp/calamares-root-x/home ext4 rw 0 0\n"
+                  "/dev/sdc1 /tmp/calamares-root-xy ext4 rw 0 0\n"
+                  "/dev/sdb3 /tmp/calamares-root-x/my\\040data vfat rw 0 0\n"
+                  "tmpfs /tmp/calamares-root-x/run tmpfs rw 0 0\n"
+                  "tmpfs /tmp/calamares-root-x/run tmpfs rw 0 0\n" );
+    mounts.close();
+
+    const QStringList expected { "/tmp/calamares-root-x",
+                                 "/tmp/calamares-root-x/home",
+                                 "/tmp/calamares-root-x/my data",
+                                 "/tmp/calamares-root-x/run",
+                                 "/tmp/calamares-root-x/run" };
+    QCOMPARE( mountPointsUnder( QStringLiteral( "/tmp/calamares-root-x" ), mounts.fileName() ), expected );
+    QCOMPARE( mountPointsUnder( QStringLiteral( "/tmp/calamares-root-x/" ), mounts.fileName() ), expected );
+    QCOMPARE( mountPointsUnder( QStringLiteral( "/tmp/calamares-root-z" ), mounts.fileName() ), QStringList() );
+    QCOMPARE( mountPointsUnder( QString(), mounts.fileName() ), QStringList() );
+    // The whole system is never meant
+    QCOMPARE( mountPointsUnder( QStringLiteral( "/" ), mounts.fileName() ), QStringList() );
+}
+
+void
+PartitionSizeTests::testUnmountAll()
+{
+    using CalamaresUtils::Partition::unmountAll;
+
+    const QStringList mountPoints { "/r", "/r/boot", "/r/boot/efi", "/r/home", "/r/run", "/r/run" };
+
+    // The three mount points at depth 2 should be unmounted at the same time
+    const int parallel = qMin( 3, QThreadPool::globalInstance()->maxThreadCount() );
+    QAtomicInt started;
+    QMutex mutex;
+    QStringList unmounted;
+    bool overlapped = true;
+    const auto failures = unmountAll( mountPoints, [&]( const QString& path ) {
+        if ( CalamaresUtils::Partition::mountPointDepth( path ) == 2 )
+        {
+            started.ref();
+            QElapsedTimer timer;
+            timer.start();
+            while ( started.load() < parallel && timer.elapsed() < 5000 )
+            {
+                QThread::msleep( 10 );
+            }
+            if ( started.load() < parallel )
+            {
+                QMutexLocker lock( &mutex );
+                overlapped = false;
+            }
+        }
+        QMutexLocker lock( &mutex );
+        unmounted.append( path );
+        return path == QStringLiteral( "/r/run" ) ? EBUSY : 0;
+    } );
+
+    QVERIFY( overlapped );
+    // Deeper first; a failing path is not retried, but the others go on
+    QCOMPARE( unmounted.count(), 5 );
+    QCOMPARE( unmounted.first(), QStringLiteral( "/r/boot/efi" ) );
+    QCOMPARE( unmounted.last(), QStringLiteral( "/r" ) );
+    QCOMPARE( unmounted.count( QStringLiteral( "/r/run" ) ), 1 );
+    QCOMPARE( failures, QStringList { QStringLiteral( "/r/run: " ) + qt_error_string( EBUSY ) } );
+}
@@ -36,6 +36,12 @@ private Q_SLOTS:
 
     void testUnitNormalisation_data();
     void testUnitNormalisation();
+
+    void testDeviceInventoryScan();
+
+    void testMountFlags();
+    void testMountPointsUnder();
+    void testUnmountAll();
 };
 
 #endif
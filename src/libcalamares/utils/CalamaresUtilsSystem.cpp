@@ -22,6 +22,7 @@
 #include "GlobalStorage.h"
 #include "JobQueue.h"
 #include "Settings.h"
+#include "utils/Files.h"
 #include "utils/Logger.h"
 
 #include <QCoreApplication>
@@ -29,6 +30,9 @@
 #include <QProcess>
 #include <QRegularExpression>
 
+#include <errno.h>
+#include <string.h>
+
 #ifdef Q_OS_LINUX
 #include <sys/sysinfo.h>
 #endif
@@ -255,33 +259,18 @@ System::createTargetFile( const QString& path, const QByteArray& contents, Write
         return CreationResult( CreationResult::Code::Invalid );
     }
 
-    QFile f( completePath );
-    if ( ( mode == WriteMode::KeepExisting ) && f.exists() )
+    int r = writeFile( completePath, contents, mode == WriteMode::KeepExisting );
+    if ( r == EEXIST && mode == WriteMode::KeepExisting )
     {
         return CreationResult( CreationResult::Code::AlreadyExists );
     }
-
-    QIODevice::OpenMode m =
-#if QT_VERSION >= QT_VERSION_CHECK( 5, 11, 0 )
-        // New flag from Qt 5.11, implies WriteOnly
-        ( mode == WriteMode::KeepExisting ? QIODevice::NewOnly : QIODevice::WriteOnly ) |
-#endif
-        QIODevice::WriteOnly | QIODevice::Truncate;
-
-    if ( !f.open( m ) )
-    {
-        return CreationResult( CreationResult::Code::Failed );
-    }
-
-    if ( f.write( contents ) != contents.size() )
+    if ( r )
     {
-        f.close();
-        f.remove();
+        cWarning() << "Could not write" << completePath << strerror( r );
         return CreationResult( CreationResult::Code::Failed );
     }
 
-    f.close();
-    return CreationResult( QFileInfo( f ).canonicalFilePath() );
+    return CreationResult( QFileInfo( completePath ).canonicalFilePath() );
 }
 
 void
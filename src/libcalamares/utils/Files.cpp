@@ -0,0 +1,246 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Files.h"
+
+#include "Logger.h"
+
+#include <QFile>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
+
+namespace CalamaresUtils
+{
+
+/// @brief Bytes per call of the kernel copy functions, which may copy less anyway
+static constexpr size_t copyChunk = 64 * 1024 * 1024;
+
+/// @brief Write all of @p length bytes from @p buffer; returns 0 or an errno value
+static int
+writeAll( int fd, const char* buffer, size_t length )
+{
+    while ( length > 0 )
+    {
+        ssize_t r = ::write( fd, buffer, length );
+        if ( r < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            return errno;
+        }
+        buffer += r;
+        length -= static_cast< size_t >( r );
+    }
+    return 0;
+}
+
+/** @brief Copy from @p in to @p out with the kernel copy function @p f
+ *
+ * Returns 0 on success, -1 if @p f is not supported for these
+ * files or copied nothing at all (and so the caller should try
+ * another way), otherwise an errno value. Files in procfs and sysfs
+ * have size 0, and the kernel functions copy nothing from them.
+ */
+template < typename F >
+static int
+kernelCopy( F f )
+{
+    bool started = false;
+    while ( true )
+    {
+        ssize_t r = f();
+        if ( r < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            if ( !started
+                 && ( errno == ENOSYS || errno == EINVAL || errno == EXDEV || errno == EOPNOTSUPP
+                      || errno == ENOTSUP ) )
+            {
+                return -1;
+            }
+            return errno;
+        }
+        if ( r == 0 )
+        {
+            // An empty file also comes out right with the fallback
+            return started ? 0 : -1;
+        }
+        started = true;
+    }
+}
+
+static int
+bufferCopy( int in, int out )
+{
+    QByteArray buffer( 1024 * 1024, '\0' );
+    while ( true )
+    {
+        ssize_t r = ::read( in, buffer.data(), static_cast< size_t >( buffer.size() ) );
+        if ( r < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            return errno;
+        }
+        if ( r == 0 )
+        {
+            return 0;
+        }
+        int error = writeAll( out, buffer.constData(), static_cast< size_t >( r ) );
+        if ( error )
+        {
+            return error;
+        }
+    }
+}
+
+CopyMethod
+copyFile( const QString& source, const QString& destination, int permissions )
+{
+    int in = ::open( QFile::encodeName( source ).constData(), O_RDONLY | O_CLOEXEC );
+    if ( in < 0 )
+    {
+        cWarning() << "Could not read" << source << strerror( errno );
+        return CopyMethod::Failed;
+    }
+    struct stat st;
+    if ( ::fstat( in, &st ) != 0 )
+    {
+        st.st_mode = 0600;
+    }
+    const mode_t mode = permissions >= 0 ? static_cast< mode_t >( permissions ) : ( st.st_mode & 07777 );
+
+    int out = ::open( QFile::encodeName( destination ).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600 );
+    if ( out < 0 )
+    {
+        cWarning() << "Could not open" << destination << "for writing; could not copy" << source << strerror( errno );
+        ::close( in );
+        return CopyMethod::Failed;
+    }
+    // Set the mode before there is any data, so the data is never readable to others
+    if ( ::fchmod( out, mode ) != 0 )
+    {
+        cWarning() << "Could not set permissions of" << destination << strerror( errno );
+    }
+
+    CopyMethod method = CopyMethod::Failed;
+    int error = -1;
+#ifdef Q_OS_LINUX
+#ifdef FICLONE
+    if ( ::ioctl( out, FICLONE, in ) == 0 )
+    {
+        method = CopyMethod::Reflink;
+        error = 0;
+    }
+#endif
+#ifdef SYS_copy_file_range
+    if ( error < 0 )
+    {
+        // Through syscall(), since older C libraries have no wrapper
+        error = kernelCopy( [in, out]() {
+            return static_cast< ssize_t >( ::syscall( SYS_copy_file_range, in, nullptr, out, nullptr, copyChunk, 0 ) );
+        } );
+        method = CopyMethod::CopyFileRange;
+    }
+#endif
+    if ( error < 0 )
+    {
+        error = kernelCopy( [in, out]() { return ::sendfile( out, in, nullptr, copyChunk ); } );
+        method = CopyMethod::SendFile;
+    }
+#endif
+    if ( error < 0 )
+    {
+        error = bufferCopy( in, out );
+        method = CopyMethod::ReadWrite;
+    }
+
+    ::close( in );
+    if ( ::close( out ) != 0 && !error )
+    {
+        error = errno;
+    }
+    if ( error )
+    {
+        cWarning() << "Could not copy" << source << "to" << destination << strerror( error );
+        return CopyMethod::Failed;
+    }
+    return method;
+}
+
+int
+writeFile( const QString& path, const QByteArray& contents, bool exclusive, int permissions )
+{
+    const int flags = O_WRONLY | O_CREAT | O_CLOEXEC | ( exclusive ? O_EXCL : O_TRUNC );
+    int fd = ::open( QFile::encodeName( path ).constData(), flags, permissions >= 0 ? 0600 : 0666 );
+    if ( fd < 0 )
+    {
+        return errno;
+    }
+    if ( permissions >= 0 && ::fchmod( fd, static_cast< mode_t >( permissions ) ) != 0 )
+    {
+        cWarning() << "Could not set permissions of" << path << strerror( errno );
+    }
+    int error = writeAll( fd, contents.constData(), static_cast< size_t >( contents.size() ) );
+    if ( ::close( fd ) != 0 && !error )
+    {
+        error = errno;
+    }
+    if ( error )
+    {
+        // Don't leave a partial file behind
+        ::unlink( QFile::encodeName( path ).constData() );
+    }
+    return error;
+}
+
+bool
+syncFilesystem( const QString& path )
+{
+    int fd = ::open( QFile::encodeName( path ).constData(), O_RDONLY | O_CLOEXEC );
+    if ( fd < 0 )
+    {
+        return false;
+    }
+#ifdef Q_OS_LINUX
+    bool ok = ::syncfs( fd ) == 0;
+#else
+    ::sync();
+    bool ok = true;
+#endif
+    ::close( fd );
+    return ok;
+}
+
+}  // namespace CalamaresUtils
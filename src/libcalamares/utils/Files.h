@@ -0,0 +1,73 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILS_FILES_H
+#define UTILS_FILES_H
+
+#include "DllMacro.h"
+
+#include <QByteArray>
+#include <QString>
+
+namespace CalamaresUtils
+{
+/// @brief How copyFile() moved the data
+enum class CopyMethod
+{
+    Failed,  ///< Nothing was copied (or not all of it)
+    Reflink,  ///< The destination shares the source's blocks (FICLONE)
+    CopyFileRange,  ///< Copied in the kernel, by copy_file_range(2)
+    SendFile,  ///< Copied in the kernel, by sendfile(2)
+    ReadWrite  ///< Copied through a buffer, by read(2) and write(2)
+};
+
+/** @brief Copy file @p source to @p destination, replacing it
+ *
+ * The data does not pass through Calamares if the kernel can avoid
+ * it: on filesystems that support it the copy is a reflink, otherwise
+ * the kernel copies with copy_file_range(2) or sendfile(2). Reading
+ * and writing through a buffer is the last resort.
+ *
+ * The destination gets mode @p permissions (e.g. 0400) when it is
+ * created, regardless of the umask; with -1, it gets the mode of
+ * the source. The data is not synced to disk; see syncFilesystem().
+ *
+ * @returns how the file was copied, or CopyMethod::Failed.
+ */
+DLLEXPORT CopyMethod copyFile( const QString& source, const QString& destination, int permissions = -1 );
+
+/** @brief Write @p contents to the file at @p path, replacing it
+ *
+ * If @p exclusive is true, the file must not exist yet. The file is
+ * created with mode @p permissions, regardless of the umask; with
+ * -1, it gets the usual mode for new files (0666 minus the umask).
+ * If writing fails, the partial file is removed.
+ *
+ * @returns 0 on success, otherwise an errno value (EEXIST if
+ *          @p exclusive and the file exists).
+ */
+DLLEXPORT int writeFile( const QString& path, const QByteArray& contents, bool exclusive = false, int permissions = -1 );
+
+/** @brief Flush everything written to the filesystem holding @p path
+ *
+ * One syncfs(2) after copying or writing a batch of files is much
+ * cheaper than an fsync(2) for each of them.
+ */
+DLLEXPORT bool syncFilesystem( const QString& path );
+
+}  // namespace CalamaresUtils
+
+#endif
@@ -0,0 +1,327 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Initramfs.h"
+
+#include "GlobalStorage.h"
+#include "JobQueue.h"
+#include "Settings.h"
+#include "modulesystem/InstanceKey.h"
+#include "utils/Files.h"
+#include "utils/Logger.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+static const char requestsKey[] = "initramfsRequests";
+static const char regeneratedKey[] = "initramfsRegenerated";
+static const char maskedKey[] = "initramfsMaskedHooks";
+
+/// Suffix for the original of a file that maskHooks() rewrote
+static const char originalSuffix[] = ".calamares-orig";
+
+/** A hook that is masked by a symlink to /dev/null in its place in /etc
+ *
+ * The pacman hooks for mkinitcpio and dracut also copy the kernel
+ * image to /boot; installKernelImages() does that when they are
+ * unmasked.
+ */
+struct Hook
+{
+    const char* shipped;
+    const char* mask;
+};
+
+static const Hook hooks[] = {
+    { "/usr/share/libalpm/hooks/90-mkinitcpio-install.hook", "/etc/pacman.d/hooks/90-mkinitcpio-install.hook" },
+    { "/usr/share/libalpm/hooks/90-dracut-install.hook", "/etc/pacman.d/hooks/90-dracut-install.hook" },
+    { "/usr/lib/kernel/install.d/50-dracut.install", "/etc/kernel/install.d/50-dracut.install" },
+};
+
+/// Where the masks of pacman hooks go
+static const char pacmanHookDir[] = "/etc/pacman.d/hooks/";
+
+/// initramfs-tools sources this; the last assignment wins
+static const char initramfsToolsConf[] = "/etc/initramfs-tools/update-initramfs.conf";
+
+/** The kernel's postinst script calls this (through run-parts) with
+ * `update-initramfs -c`, which ignores update-initramfs.conf. It is
+ * masked by renaming it: run-parts skips names with a dot in them.
+ */
+static const char initramfsToolsPostinst[] = "/etc/kernel/postinst.d/initramfs-tools";
+
+static Calamares::GlobalStorage*
+globalStorage()
+{
+    auto* jq = Calamares::JobQueue::instance();
+    return jq ? jq->globalStorage() : nullptr;
+}
+
+static bool
+existsOrDangles( const QString& path )
+{
+    QFileInfo fi( path );
+    return fi.exists() || fi.isSymLink();
+}
+
+/** @brief Copies the kernel images below @p root to /boot
+ *
+ * Does what the pacman hooks for mkinitcpio and dracut do besides
+ * generating the initramfs: each kernel package's vmlinuz in
+ * /usr/lib/modules/<version>/ becomes /boot/vmlinuz-<pkgbase>.
+ */
+static void
+installKernelImages( const QString& root )
+{
+    const QDir modules( root + QStringLiteral( "/usr/lib/modules" ) );
+    for ( const auto& fi : modules.entryInfoList( QDir::Dirs | QDir::NoDotAndDotDot ) )
+    {
+        const QDir dir( fi.absoluteFilePath() );
+        QFile pkgbase( dir.filePath( QStringLiteral( "pkgbase" ) ) );
+        if ( !QFileInfo::exists( dir.filePath( QStringLiteral( "vmlinuz" ) ) )
+             || !pkgbase.open( QIODevice::ReadOnly ) )
+        {
+            continue;
+        }
+        const QString name = QString::fromUtf8( pkgbase.readAll() ).trimmed();
+        if ( name.isEmpty() || name.contains( '/' ) )
+        {
+            continue;
+        }
+
+        const QString image = root + QStringLiteral( "/boot/vmlinuz-" ) + name;
+        if ( !QDir().mkpath( root + QStringLiteral( "/boot" ) )
+             || CalamaresUtils::copyFile( dir.filePath( QStringLiteral( "vmlinuz" ) ), image, 0644 )
+                 == CalamaresUtils::CopyMethod::Failed )
+        {
+            cWarning() << "Could not install kernel image" << image;
+        }
+        else
+        {
+            cDebug() << "Installed kernel image" << image;
+        }
+    }
+}
+
+namespace CalamaresUtils
+{
+namespace Initramfs
+{
+
+QStringList
+regeneratingModules()
+{
+    return { QStringLiteral( "initcpio" ), QStringLiteral( "initramfs" ), QStringLiteral( "dracut" ) };
+}
+
+bool
+isRegenerationScheduled()
+{
+    auto* gs = globalStorage();
+    auto* settings = Calamares::Settings::instance();
+    if ( !gs || !settings || gs->value( regeneratedKey ).toBool() )
+    {
+        return false;
+    }
+
+    const QStringList modules = regeneratingModules();
+    for ( const auto& step : settings->modulesSequence() )
+    {
+        if ( step.first != Calamares::ModuleSystem::Action::Exec )
+        {
+            continue;
+        }
+        for ( const QString& instance : step.second )
+        {
+            if ( modules.contains( Calamares::ModuleSystem::InstanceKey::fromString( instance ).module() ) )
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void
+requestRegeneration( const QString& reason )
+{
+    auto* gs = globalStorage();
+    if ( !gs )
+    {
+        return;
+    }
+    QStringList requests = gs->value( requestsKey ).toStringList();
+    if ( !requests.contains( reason ) )
+    {
+        requests.append( reason );
+        gs->insert( requestsKey, requests );
+    }
+    cDebug() << "Initramfs regeneration requested for" << reason;
+}
+
+QStringList
+regenerationRequests()
+{
+    auto* gs = globalStorage();
+    return gs ? gs->value( requestsKey ).toStringList() : QStringList();
+}
+
+bool
+isRegenerationNeeded()
+{
+    auto* gs = globalStorage();
+    return !gs || !gs->value( regeneratedKey ).toBool() || !gs->value( requestsKey ).toStringList().isEmpty();
+}
+
+bool
+deferHooks()
+{
+    auto* gs = globalStorage();
+    if ( !isRegenerationScheduled() )
+    {
+        return false;
+    }
+    if ( gs->contains( maskedKey ) )
+    {
+        return true;
+    }
+
+    const QString root = gs->value( "rootMountPoint" ).toString();
+    if ( root.isEmpty() )
+    {
+        return false;
+    }
+    const QStringList masks = maskHooks( root );
+    cDebug() << "Deferred initramfs hooks" << masks;
+    gs->insert( maskedKey, masks );
+    return true;
+}
+
+void
+restoreHooks()
+{
+    auto* gs = globalStorage();
+    if ( !gs || !gs->contains( maskedKey ) )
+    {
+        return;
+    }
+    unmaskHooks( gs->value( "rootMountPoint" ).toString(), gs->value( maskedKey ).toStringList() );
+    gs->remove( maskedKey );
+}
+
+void
+regenerated()
+{
+    restoreHooks();
+    auto* gs = globalStorage();
+    if ( gs )
+    {
+        gs->remove( requestsKey );
+        gs->insert( regeneratedKey, true );
+    }
+}
+
+QStringList
+maskHooks( const QString& root )
+{
+    QStringList masks;
+    for ( const auto& hook : hooks )
+    {
+        const QString shipped = root + hook.shipped;
+        const QString mask = root + hook.mask;
+        if ( !QFileInfo::exists( shipped ) || existsOrDangles( mask ) )
+        {
+            continue;
+        }
+        if ( QDir().mkpath( QFileInfo( mask ).path() ) && QFile::link( QStringLiteral( "/dev/null" ), mask ) )
+        {
+            masks.append( hook.mask );
+        }
+        else
+        {
+            cWarning() << "Could not mask" << mask;
+        }
+    }
+
+    const QString postinst = root + initramfsToolsPostinst;
+    if ( QFileInfo::exists( postinst ) && !existsOrDangles( postinst + originalSuffix ) )
+    {
+        if ( QFile::rename( postinst, postinst + originalSuffix ) )
+        {
+            masks.append( initramfsToolsPostinst );
+        }
+        else
+        {
+            cWarning() << "Could not mask" << postinst;
+        }
+    }
+
+    const QString conf = root + initramfsToolsConf;
+    QFile f( conf );
+    if ( f.exists() && !existsOrDangles( conf + originalSuffix ) && f.open( QIODevice::ReadOnly ) )
+    {
+        const QByteArray contents = f.readAll();
+        f.close();
+        if ( !f.rename( conf + originalSuffix ) )
+        {
+            cWarning() << "Could not mask" << conf;
+        }
+        else if ( CalamaresUtils::writeFile( conf, contents + "\nupdate_initramfs=no\n", false, 0644 ) )
+        {
+            cWarning() << "Could not mask" << conf;
+            QFile::rename( conf + originalSuffix, conf );
+        }
+        else
+        {
+            masks.append( initramfsToolsConf );
+        }
+    }
+    return masks;
+}
+
+void
+unmaskHooks( const QString& root, const QStringList& masks )
+{
+    // Only remove what is still a mask, so that unmasking twice
+    // does no harm, and whatever replaced a mask is left alone.
+    bool pacmanHooks = false;
+    for ( const QString& m : masks )
+    {
+        const QString path = root + m;
+        if ( existsOrDangles( path + originalSuffix ) )
+        {
+            QFile::remove( path );
+            if ( !QFile::rename( path + originalSuffix, path ) )
+            {
+                cWarning() << "Could not restore" << path;
+            }
+        }
+        else if ( QFileInfo( path ).symLinkTarget() == QStringLiteral( "/dev/null" ) )
+        {
+            QFile::remove( path );
+            pacmanHooks = pacmanHooks || m.startsWith( pacmanHookDir );
+        }
+    }
+    // The kernels installed while the hooks were masked are not in /boot yet
+    if ( pacmanHooks )
+    {
+        installKernelImages( root );
+    }
+}
+
+}  // namespace Initramfs
+}  // namespace CalamaresUtils
@@ -0,0 +1,110 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILS_INITRAMFS_H
+#define UTILS_INITRAMFS_H
+
+#include "DllMacro.h"
+
+#include <QString>
+#include <QStringList>
+
+namespace CalamaresUtils
+{
+/** @brief Coordinates regenerating the initramfs of the target system
+ *
+ * Several things during an installation make the initramfs stale:
+ * installing a kernel or firmware, adding a LUKS keyfile, changing
+ * the Plymouth theme. Regenerating it takes a long time, so it should
+ * happen once, by the module that does it (*initcpio*, *initramfs*
+ * or *dracut*), after everything else that affects it.
+ *
+ * Modules that make the initramfs stale call requestRegeneration(),
+ * and the package manager's hooks that would regenerate it are
+ * masked in the meantime (see deferHooks() and maskHooks()). The
+ * regenerating module calls regenerated() when it is done. The state is kept in
+ * GlobalStorage, so that C++ and Python modules share it.
+ */
+namespace Initramfs
+{
+/// @brief The names of the modules that regenerate the initramfs
+DLLEXPORT QStringList regeneratingModules();
+
+/** @brief Will the initramfs be regenerated later on?
+ *
+ * True if one of the regeneratingModules() is in the *exec* sequence,
+ * and the initramfs has not been regenerated yet.
+ */
+DLLEXPORT bool isRegenerationScheduled();
+
+/// @brief Ask for the initramfs to be regenerated, because of @p reason
+DLLEXPORT void requestRegeneration( const QString& reason );
+
+/// @brief The reasons given to requestRegeneration() since the last regeneration
+DLLEXPORT QStringList regenerationRequests();
+
+/** @brief Does the initramfs need regenerating?
+ *
+ * True unless it was regenerated already, and nothing requested
+ * another regeneration since. A second regenerating module in the
+ * *exec* sequence can skip its work if this is false.
+ */
+DLLEXPORT bool isRegenerationNeeded();
+
+/** @brief Mask the package manager's initramfs hooks in the target system
+ *
+ * Only does so if isRegenerationScheduled(); the hooks are unmasked
+ * again by restoreHooks() or regenerated().
+ *
+ * @returns true if the hooks are masked.
+ */
+DLLEXPORT bool deferHooks();
+
+/** @brief Unmask whatever deferHooks() masked
+ *
+ * The job queue calls this when a job fails, so that the target
+ * system is not left with masked hooks.
+ */
+DLLEXPORT void restoreHooks();
+
+/// @brief The initramfs was regenerated; restores the hooks and clears the requests
+DLLEXPORT void regenerated();
+
+/** @brief Mask the initramfs hooks of the system at @p root
+ *
+ * The pacman hooks for mkinitcpio and dracut, and the kernel-install
+ * plugin that runs dracut, are masked by a symlink to /dev/null in /etc.
+ * initramfs-tools is configured not to update the initramfs, and its
+ * script in /etc/kernel/postinst.d is renamed so that it does not
+ * create one. Hooks that the system already masks or overrides are
+ * left alone.
+ *
+ * @returns the paths (relative to @p root) that were masked
+ */
+DLLEXPORT QStringList maskHooks( const QString& root );
+
+/** @brief Undo maskHooks() at @p root, for the @p masks it returned
+ *
+ * Paths that are no longer masked are left alone. The pacman hooks
+ * also install the kernel image in /boot, so if they were masked,
+ * the kernel images in /usr/lib/modules are copied there.
+ */
+DLLEXPORT void unmaskHooks( const QString& root, const QStringList& masks );
+
+}  // namespace Initramfs
+}  // namespace CalamaresUtils
+
+#endif
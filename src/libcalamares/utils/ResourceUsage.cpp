@@ -0,0 +1,113 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResourceUsage.h"
+
+#include <QFile>
+
+#include <sys/resource.h>
+#include <time.h>
+
+namespace CalamaresUtils
+{
+
+static inline qint64
+toMSecs( const struct timeval& tv )
+{
+    return qint64( tv.tv_sec ) * 1000 + tv.tv_usec / 1000;
+}
+
+/** @brief Reads read_bytes and write_bytes from /proc/self/io
+ *
+ * Leaves the values untouched if the file can't be read
+ * (e.g. on FreeBSD, or without CONFIG_TASK_IO_ACCOUNTING).
+ */
+static void
+readProcIO( ResourceUsage& u )
+{
+    QFile f( QStringLiteral( "/proc/self/io" ) );
+    if ( !f.open( QIODevice::ReadOnly ) )
+    {
+        return;
+    }
+
+    // Not a "real" file, so readLine() until empty instead of atEnd()
+    for ( QByteArray line = f.readLine(); !line.isEmpty(); line = f.readLine() )
+    {
+        const int colon = line.indexOf( ':' );
+        if ( colon < 0 )
+        {
+            continue;
+        }
+        const QByteArray key = line.left( colon );
+        if ( key == "read_bytes" )
+        {
+            u.readBytes = line.mid( colon + 1 ).trimmed().toLongLong();
+        }
+        else if ( key == "write_bytes" )
+        {
+            u.writeBytes = line.mid( colon + 1 ).trimmed().toLongLong();
+        }
+    }
+}
+
+ResourceUsage
+ResourceUsage::current()
+{
+    ResourceUsage u;
+
+    struct timespec ts;
+    if ( clock_gettime( CLOCK_MONOTONIC, &ts ) == 0 )
+    {
+        u.wallTime = qint64( ts.tv_sec ) * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    struct rusage self;
+    struct rusage children;
+    if ( getrusage( RUSAGE_SELF, &self ) == 0 && getrusage( RUSAGE_CHILDREN, &children ) == 0 )
+    {
+        u.userTime = toMSecs( self.ru_utime ) + toMSecs( children.ru_utime );
+        u.systemTime = toMSecs( self.ru_stime ) + toMSecs( children.ru_stime );
+        // On Linux, ru_maxrss is in KiB
+        u.maxRss = qMax( self.ru_maxrss, children.ru_maxrss );
+    }
+
+    readProcIO( u );
+    return u;
+}
+
+ResourceUsage
+ResourceUsage::since( const ResourceUsage& earlier ) const
+{
+    ResourceUsage u;
+    u.wallTime = wallTime - earlier.wallTime;
+    u.userTime = userTime - earlier.userTime;
+    u.systemTime = systemTime - earlier.systemTime;
+    u.maxRss = maxRss;
+    u.readBytes = readBytes - earlier.readBytes;
+    u.writeBytes = writeBytes - earlier.writeBytes;
+    return u;
+}
+
+QVariantMap
+ResourceUsage::toMap() const
+{
+    return QVariantMap { { QStringLiteral( "wallTime" ), wallTime },     { QStringLiteral( "userTime" ), userTime },
+                         { QStringLiteral( "systemTime" ), systemTime }, { QStringLiteral( "maxRss" ), maxRss },
+                         { QStringLiteral( "readBytes" ), readBytes },   { QStringLiteral( "writeBytes" ), writeBytes } };
+}
+
+}  // namespace CalamaresUtils
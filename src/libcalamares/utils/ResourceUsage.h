@@ -0,0 +1,60 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILS_RESOURCEUSAGE_H
+#define UTILS_RESOURCEUSAGE_H
+
+#include "DllMacro.h"
+
+#include <QVariantMap>
+
+namespace CalamaresUtils
+{
+/** @brief Resources used by Calamares (and its child processes)
+ *
+ * Take a snapshot with current() before and after some work; the
+ * difference is what that work used. CPU times include child
+ * processes that have been waited for (e.g. every command run
+ * through System::runCommand()), and so do the I/O counters,
+ * which come from /proc/self/io.
+ */
+struct DLLEXPORT ResourceUsage
+{
+    qint64 wallTime = 0;  ///< milliseconds (monotonic clock)
+    qint64 userTime = 0;  ///< milliseconds of user CPU, self and children
+    qint64 systemTime = 0;  ///< milliseconds of system CPU, self and children
+    qint64 maxRss = 0;  ///< KiB, peak resident set of the process (or its largest child) so far
+    qint64 readBytes = 0;  ///< bytes actually read from storage
+    qint64 writeBytes = 0;  ///< bytes actually written to storage
+
+    /// @brief Snapshot of the resources used so far
+    static ResourceUsage current();
+
+    /** @brief Usage between snapshot @p earlier and this one
+     *
+     * The peak RSS is not a counter, so the result keeps the
+     * peak RSS of this (later) snapshot. It is the peak of the
+     * whole process so far, not of the work in between.
+     */
+    ResourceUsage since( const ResourceUsage& earlier ) const;
+
+    /// @brief Map with the fields above, e.g. for GlobalStorage
+    QVariantMap toMap() const;
+};
+
+}  // namespace CalamaresUtils
+
+#endif
@@ -20,17 +20,33 @@
 
 #include "CalamaresUtilsSystem.h"
 #include "Entropy.h"
+#include "Files.h"
+#include "Dirs.h"
+#include "Initramfs.h"
 #include "Logger.h"
+#include "ResourceUsage.h"
+#include "Trace.h"
 #include "UMask.h"
 #include "Yaml.h"
 
 #include "GlobalStorage.h"
 #include "JobQueue.h"
 
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
 
 #include <QtTest/QtTest>
 
+#include <thread>
+
+#include <errno.h>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -44,6 +60,8 @@ LibCalamaresTests::~LibCalamaresTests() {}
 void
 LibCalamaresTests::initTestCase()
 {
+    // Keep checkpoints out of the real log directory
+    QStandardPaths::setTestModeEnabled( true );
 }
 
 void
@@ -251,3 +269,398 @@ LibCalamaresTests::testOddSizedPrintable()
         }
     }
 }
+
+void
+LibCalamaresTests::testTrace()
+{
+    QTemporaryFile f( "trace-XXXXXX.json" );
+    QVERIFY( f.open() );
+
+    // Before tracing starts, spans are dropped and nothing is written
+    {
+        CalamaresUtils::Trace::Span s( "test", "dropped" );
+    }
+    QVERIFY( !CalamaresUtils::Trace::isEnabled() );
+    QVERIFY( !CalamaresUtils::Trace::writeTrace( f.fileName() ) );
+
+    CalamaresUtils::Trace::setupTracing();
+    QVERIFY( CalamaresUtils::Trace::isEnabled() );
+    {
+        CalamaresUtils::Trace::Span s( "test", "outer" );
+        {
+            CalamaresUtils::Trace::Span inner( "test", QStringLiteral( "inner" ) );
+        }
+        std::thread t( [] { CalamaresUtils::Trace::Span s( "test", "thread" ); } );
+        t.join();
+    }
+    QVERIFY( CalamaresUtils::Trace::writeTrace( f.fileName() ) );
+
+    QFile trace( f.fileName() );
+    QVERIFY( trace.open( QIODevice::ReadOnly ) );
+    QJsonParseError err;
+    QJsonDocument doc = QJsonDocument::fromJson( trace.readAll(), &err );
+    QCOMPARE( err.error, QJsonParseError::NoError );
+
+    QMap< QString, QJsonObject > spans;
+    for ( const auto& v : doc.object().value( "traceEvents" ).toArray() )
+    {
+        QJsonObject o = v.toObject();
+        if ( o.value( "ph" ).toString() == "X" )
+        {
+            spans.insert( o.value( "name" ).toString(), o );
+        }
+    }
+    QCOMPARE( spans.count(), 3 );
+    QVERIFY( !spans.contains( "dropped" ) );
+    QCOMPARE( spans[ "outer" ].value( "cat" ).toString(), QStringLiteral( "test" ) );
+    QCOMPARE( spans[ "outer" ].value( "tid" ).toInt(), spans[ "inner" ].value( "tid" ).toInt() );
+    QVERIFY( spans[ "outer" ].value( "tid" ).toInt() != spans[ "thread" ].value( "tid" ).toInt() );
+    // inner is nested in outer
+    QVERIFY( spans[ "outer" ].value( "ts" ).toDouble() <= spans[ "inner" ].value( "ts" ).toDouble() );
+    QVERIFY( spans[ "outer" ].value( "dur" ).toDouble() >= spans[ "inner" ].value( "dur" ).toDouble() );
+
+    // The later tests must not record spans
+    CalamaresUtils::Trace::stopTracing();
+    QVERIFY( !CalamaresUtils::Trace::isEnabled() );
+    QVERIFY( !CalamaresUtils::Trace::writeTrace( f.fileName() ) );
+}
+
+void
+LibCalamaresTests::testResourceUsage()
+{
+    const auto before = CalamaresUtils::ResourceUsage::current();
+    QVERIFY( before.wallTime > 0 );
+    QVERIFY( before.maxRss > 0 );
+
+    // Burn some CPU, and run a child process
+    volatile quint64 sum = 0;
+    for ( quint64 i = 0; i < 50000000; ++i )
+    {
+        sum += i;
+    }
+    QVERIFY( sum > 0 );
+    QCOMPARE( QProcess::execute( "true" ), 0 );
+
+    const auto usage = CalamaresUtils::ResourceUsage::current().since( before );
+    QVERIFY( usage.wallTime >= 0 );
+    QVERIFY( usage.userTime >= 0 );
+    QVERIFY( usage.systemTime >= 0 );
+    QVERIFY( usage.userTime + usage.systemTime > 0 );
+    QVERIFY( usage.maxRss >= before.maxRss );
+    QVERIFY( usage.readBytes >= 0 );
+    QVERIFY( usage.writeBytes >= 0 );
+
+    const auto m = usage.toMap();
+    QCOMPARE( m.count(), 6 );
+    QCOMPARE( m.value( "userTime" ).toLongLong(), usage.userTime );
+}
+
+void
+LibCalamaresTests::testCopyFile()
+{
+    QTemporaryDir dir;
+    const QString source = dir.filePath( "source.log" );
+    const QString destination = dir.filePath( "destination.log" );
+
+    QByteArray contents;
+    for ( int i = 0; i < 100000; ++i )
+    {
+        contents.append( QStringLiteral( "line %1 of the log\n" ).arg( i ).toUtf8() );
+    }
+    QCOMPARE( CalamaresUtils::writeFile( source, contents, false, 0644 ), 0 );
+
+    // An existing destination is replaced, and gets the requested mode whatever the umask
+    QCOMPARE( CalamaresUtils::writeFile( destination, QByteArray( 10000000, 'x' ) ), 0 );
+    auto method = CalamaresUtils::copyFile( source, destination, 0400 );
+    QVERIFY( method != CalamaresUtils::CopyMethod::Failed );
+    QFile f( destination );
+    QVERIFY( f.open( QIODevice::ReadOnly ) );
+    QCOMPARE( f.readAll(), contents );
+    f.close();
+    QCOMPARE( QFileInfo( destination ).permissions(), QFile::ReadOwner | QFile::ReadUser );
+
+    // Without a mode, the source's is used
+    const QString second = dir.filePath( "second.log" );
+    QVERIFY( CalamaresUtils::copyFile( source, second ) != CalamaresUtils::CopyMethod::Failed );
+    QCOMPARE( QFileInfo( second ).permissions(), QFileInfo( source ).permissions() );
+    QCOMPARE( QFileInfo( second ).size(), qint64( contents.size() ) );
+
+    QCOMPARE( CalamaresUtils::copyFile( dir.filePath( "missing.log" ), second ), CalamaresUtils::CopyMethod::Failed );
+
+    // Files in procfs have size 0, but they are not empty
+    const QString status = dir.filePath( "status" );
+    QVERIFY( CalamaresUtils::copyFile( QStringLiteral( "/proc/self/status" ), status )
+             != CalamaresUtils::CopyMethod::Failed );
+    QVERIFY( QFileInfo( status ).size() > 0 );
+
+    // An empty file stays empty
+    const QString empty = dir.filePath( "empty.log" );
+    QCOMPARE( CalamaresUtils::writeFile( empty, QByteArray() ), 0 );
+    QVERIFY( CalamaresUtils::copyFile( empty, second ) != CalamaresUtils::CopyMethod::Failed );
+    QCOMPARE( QFileInfo( second ).size(), qint64( 0 ) );
+    QVERIFY( CalamaresUtils::syncFilesystem( dir.path() ) );
+}
+
+void
+LibCalamaresTests::testWriteFile()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath( "file" );
+
+    QCOMPARE( CalamaresUtils::writeFile( path, "first" ), 0 );
+    QCOMPARE( CalamaresUtils::writeFile( path, "second", true ), EEXIST );
+    QCOMPARE( CalamaresUtils::writeFile( path, "third" ), 0 );
+    QFile f( path );
+    QVERIFY( f.open( QIODevice::ReadOnly ) );
+    QCOMPARE( f.readAll(), QByteArray( "third" ) );
+
+    QCOMPARE( CalamaresUtils::writeFile( dir.filePath( "missing/file" ), "fourth" ), ENOENT );
+}
+
+void
+LibCalamaresTests::testInitramfsHooks()
+{
+    using namespace CalamaresUtils::Initramfs;
+
+    QTemporaryDir root;
+    const QString r = root.path();
+
+    // Nothing to mask
+    QVERIFY( maskHooks( r ).isEmpty() );
+
+    // The pacman hooks (one of them overridden by the system already),
+    // the dracut kernel-install plugin and initramfs-tools
+    QVERIFY( QDir().mkpath( r + "/usr/share/libalpm/hooks" ) );
+    QVERIFY( QDir().mkpath( r + "/etc/pacman.d/hooks" ) );
+    QVERIFY( QDir().mkpath( r + "/usr/lib/kernel/install.d" ) );
+    QVERIFY( QDir().mkpath( r + "/usr/lib/modules/5.8.1-arch1-1" ) );
+    QVERIFY( QDir().mkpath( r + "/etc/kernel/install.d" ) );
+    QVERIFY( QDir().mkpath( r + "/etc/kernel/postinst.d" ) );
+    QVERIFY( QDir().mkpath( r + "/etc/initramfs-tools" ) );
+    QCOMPARE( CalamaresUtils::writeFile( r + "/usr/share/libalpm/hooks/90-mkinitcpio-install.hook", "[Trigger]\n" ), 0 );
+    QCOMPARE( CalamaresUtils::writeFile( r + "/usr/share/libalpm/hooks/90-dracut-install.hook", "[Trigger]\n" ), 0 );
+    QCOMPARE( CalamaresUtils::writeFile( r + "/etc/pacman.d/hooks/90-dracut-install.hook", "[Trigger]\n" ), 0 );
+    QCOMPARE( CalamaresUtils::writeFile( r + "/usr/lib/kernel/install.d/50-dracut.install", "#!/bin/sh\n" ), 0 );
+    QCOMPARE( CalamaresUtils::writeFile( r + "/usr/lib/modules/5.8.1-arch1-1/pkgbase", "linux\n" ), 0 );
+    QCOMPARE( CalamaresUtils::writeFile( r + "/usr/lib/modules/5.8.1-arch1-1/vmlinuz", "kernel" ), 0 );
+    QCOMPARE( CalamaresUtils::writeFile( r + "/etc/kernel/postinst.d/initramfs-tools", "#!/bin/sh\n" ), 0 );
+    QCOMPARE( CalamaresUtils::writeFile( r + "/etc/initramfs-tools/update-initramfs.conf", "update_initramfs=yes\n" ),
+              0 );
+
+    const QStringList masks = maskHooks( r );
+    QCOMPARE( masks,
+              QStringList( { "/etc/pacman.d/hooks/90-mkinitcpio-install.hook",
+                             "/etc/kernel/install.d/50-dracut.install",
+                             "/etc/kernel/postinst.d/initramfs-tools",
+                             "/etc/initramfs-tools/update-initramfs.conf" } ) );
+    QCOMPARE( QFileInfo( r + "/etc/pacman.d/hooks/90-mkinitcpio-install.hook" ).symLinkTarget(),
+              QStringLiteral( "/dev/null" ) );
+    QVERIFY( !QFileInfo( r + "/etc/pacman.d/hooks/90-dracut-install.hook" ).isSymLink() );
+    QCOMPARE( QFileInfo( r + "/etc/kernel/install.d/50-dracut.install" ).symLinkTarget(), QStringLiteral( "/dev/null" ) );
+    QVERIFY( !QFileInfo::exists( r + "/etc/kernel/postinst.d/initramfs-tools" ) );
+    {
+        QFile f( r + "/etc/initramfs-tools/update-initramfs.conf" );
+        QVERIFY( f.open( QIODevice::ReadOnly ) );
+        QVERIFY( f.readAll().endsWith( "update_initramfs=no\n" ) );
+    }
+    // Already masked, so nothing more to do
+    QVERIFY( maskHooks( r ).isEmpty() );
+
+    unmaskHooks( r, masks );
+    QVERIFY( !QFileInfo::exists( r + "/etc/pacman.d/hooks/90-mkinitcpio-install.hook" ) );
+    QVERIFY( QFileInfo::exists( r + "/etc/pacman.d/hooks/90-dracut-install.hook" ) );
+    QVERIFY( !QFileInfo( r + "/etc/kernel/install.d/50-dracut.install" ).isSymLink() );
+    QVERIFY( QFileInfo::exists( r + "/etc/kernel/postinst.d/initramfs-tools" ) );
+    QVERIFY( !QFileInfo::exists( r + "/etc/initramfs-tools/update-initramfs.conf.calamares-orig" ) );
+    {
+        // The pacman hook would have installed the kernel
+        QFile f( r + "/boot/vmlinuz-linux" );
+        QVERIFY( f.open( QIODevice::ReadOnly ) );
+        QCOMPARE( f.readAll(), QByteArray( "kernel" ) );
+    }
+    {
+        QFile f( r + "/etc/initramfs-tools/update-initramfs.conf" );
+        QVERIFY( f.open( QIODevice::ReadOnly ) );
+        QCOMPARE( f.readAll(), QByteArray( "update_initramfs=yes\n" ) );
+    }
+
+    // Unmasking again leaves things alone
+    unmaskHooks( r, masks );
+    QVERIFY( !QFileInfo( r + "/etc/kernel/install.d/50-dracut.install" ).isSymLink() );
+    QVERIFY( QFileInfo::exists( r + "/etc/kernel/postinst.d/initramfs-tools" ) );
+    QFile f( r + "/etc/initramfs-tools/update-initramfs.conf" );
+    QVERIFY( f.open( QIODevice::ReadOnly ) );
+    QCOMPARE( f.readAll(), QByteArray( "update_initramfs=yes\n" ) );
+}
+
+/// @brief Job that logs its name when it runs, sets a GlobalStorage key, and can fail
+class CheckpointJob : public Calamares::Job
+{
+public:
+    CheckpointJob( const QString& name, QStringList& log, bool fail = false, const QVariant& root = QVariant() )
+        : m_name( name )
+        , m_log( log )
+        , m_fail( fail )
+        , m_root( root )
+    {
+    }
+
+    QString prettyName() const override { return m_name; }
+
+    Calamares::JobResult exec() override
+    {
+        m_log.append( m_name );
+        auto* gs = Calamares::JobQueue::instance()->globalStorage();
+        gs->insert( m_name, true );
+        if ( m_root.isValid() )
+        {
+            gs->insert( "rootMountPoint", m_root );
+        }
+        return m_fail ? Calamares::JobResult::error( m_name ) : Calamares::JobResult::ok();
+    }
+
+private:
+    QString m_name;
+    QStringList& m_log;
+    bool m_fail;
+    QVariant m_root;
+};
+
+/// @brief Run @p jobs as one section of @p queue; returns true if they all succeed
+static bool
+runSection( Calamares::JobQueue& queue, const Calamares::JobList& jobs )
+{
+    QSignalSpy finished( &queue, &Calamares::JobQueue::finished );
+    QSignalSpy failed( &queue, &Calamares::JobQueue::failed );
+    queue.enqueue( jobs );
+    queue.start();
+    if ( !finished.wait( 5000 ) )
+    {
+        return false;
+    }
+    queue.findChild< QThread* >()->wait();
+    return failed.isEmpty();
+}
+
+static void
+removeCheckpoint()
+{
+    const QDir logDir = CalamaresUtils::appLogDir();
+    QFile::remove( logDir.filePath( "checkpoint.json" ) );
+    QFile::remove( logDir.filePath( "checkpoint-globalstorage.json" ) );
+}
+
+static Calamares::job_ptr
+checkpointJob( const QString& name, QStringList& log, bool fail = false, const QVariant& root = QVariant() )
+{
+    return Calamares::job_ptr( new CheckpointJob( name, log, fail, root ) );
+}
+
+void
+LibCalamaresTests::testResumeMatching()
+{
+    removeCheckpoint();
+    QStringList log;
+    {
+        Calamares::JobQueue q;
+        const Calamares::JobList jobs {
+            checkpointJob( "a", log ),
+            checkpointJob( "b", log, true ),
+            checkpointJob( "c", log )
+        };
+        QVERIFY( !runSection( q, jobs ) );
+        QCOMPARE( log, QStringList( { "a", "b" } ) );
+    }
+
+    log.clear();
+    {
+        Calamares::JobQueue q;
+        q.setResume( true );
+        const Calamares::JobList jobs {
+            checkpointJob( "a", log ),
+            checkpointJob( "b", log ),
+            checkpointJob( "c", log )
+        };
+        QVERIFY( runSection( q, jobs ) );
+        QCOMPARE( log, QStringList( { "b", "c" } ) );
+        // Restored from the checkpoint, since a did not run this time
+        QVERIFY( q.globalStorage()->value( "a" ).toBool() );
+    }
+}
+
+void
+LibCalamaresTests::testResumeMismatch()
+{
+    removeCheckpoint();
+    QStringList log;
+    {
+        Calamares::JobQueue q;
+        const Calamares::JobList jobs { checkpointJob( "a", log ), checkpointJob( "b", log, true ) };
+        QVERIFY( !runSection( q, jobs ) );
+    }
+
+    log.clear();
+    {
+        Calamares::JobQueue q;
+        q.setResume( true );
+        const Calamares::JobList jobs { checkpointJob( "x", log ), checkpointJob( "b", log ) };
+        QVERIFY( runSection( q, jobs ) );
+        QCOMPARE( log, QStringList( { "x", "b" } ) );
+        QVERIFY( !q.globalStorage()->contains( "a" ) );
+    }
+}
+
+void
+LibCalamaresTests::testResumeUnmounted()
+{
+    removeCheckpoint();
+    QTemporaryDir root;  // Exists, but nothing is mounted there
+    QStringList log;
+    {
+        Calamares::JobQueue q;
+        const Calamares::JobList jobs {
+            checkpointJob( "a", log, false, root.path() ),
+            checkpointJob( "b", log, true )
+        };
+        QVERIFY( !runSection( q, jobs ) );
+    }
+
+    log.clear();
+    {
+        Calamares::JobQueue q;
+        q.setResume( true );
+        const Calamares::JobList jobs { checkpointJob( "a", log, false, root.path() ), checkpointJob( "b", log ) };
+        QVERIFY( runSection( q, jobs ) );
+        QCOMPARE( log, QStringList( { "a", "b" } ) );
+    }
+}
+
+void
+LibCalamaresTests::testResumeSections()
+{
+    removeCheckpoint();
+    QStringList log;
+    {
+        // Two exec sections, the second one fails
+        Calamares::JobQueue q;
+        const Calamares::JobList sectionA { checkpointJob( "a1", log ), checkpointJob( "a2", log ) };
+        QVERIFY( runSection( q, sectionA ) );
+        const Calamares::JobList sectionB { checkpointJob( "b1", log ), checkpointJob( "b2", log, true ) };
+        QVERIFY( !runSection( q, sectionB ) );
+        QCOMPARE( log, QStringList( { "a1", "a2", "b1", "b2" } ) );
+    }
+
+    log.clear();
+    {
+        Calamares::JobQueue q;
+        q.setResume( true );
+        const Calamares::JobList sectionA { checkpointJob( "a1", log ), checkpointJob( "a2", log ) };
+        QVERIFY( runSection( q, sectionA ) );
+        QVERIFY( log.isEmpty() );
+        QVERIFY( q.globalStorage()->value( "a2" ).toBool() );
+        const Calamares::JobList sectionB { checkpointJob( "b1", log ), checkpointJob( "b2", log ) };
+        QVERIFY( runSection( q, sectionB ) );
+        QCOMPARE( log, QStringList( { "b2" } ) );
+    }
+    removeCheckpoint();
+}
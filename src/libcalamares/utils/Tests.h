@@ -44,6 +44,25 @@ private Q_SLOTS:
     void testEntropy();
     void testPrintableEntropy();
     void testOddSizedPrintable();
+
+    /** @brief Tests recording and writing trace spans. */
+    void testTrace();
+
+    /** @brief Tests resource-usage snapshots. */
+    void testResourceUsage();
+
+    /** @brief Tests copying and writing files. */
+    void testCopyFile();
+    void testWriteFile();
+
+    /** @brief Tests masking the initramfs hooks. */
+    void testInitramfsHooks();
+
+    /** @brief Tests resuming the job queue from a checkpoint. */
+    void testResumeMatching();
+    void testResumeMismatch();
+    void testResumeUnmounted();
+    void testResumeSections();
 };
 
 #endif
@@ -0,0 +1,212 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Trace.h"
+
+#include "utils/Dirs.h"
+#include "utils/Logger.h"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+
+namespace
+{
+struct Event
+{
+    QString name;
+    const char* category;
+    int thread;
+    qint64 start;
+    qint64 duration;
+};
+
+QAtomicInt s_enabled( 0 );
+QAtomicInt s_nextThread( 1 );
+QElapsedTimer s_clock;
+QMutex s_mutex;
+QVector< Event > s_events;
+QMap< int, QString > s_threadNames;
+
+/** @brief Small, stable per-thread id
+ *
+ * Chrome's trace viewer wants an integer per thread; hand them out
+ * in order of first use, and remember a name for each.
+ */
+int
+threadId()
+{
+    static thread_local int id = 0;
+    if ( !id )
+    {
+        id = s_nextThread.fetchAndAddRelaxed( 1 );
+
+        QThread* t = QThread::currentThread();
+        QString name;
+        if ( QCoreApplication::instance() && t == QCoreApplication::instance()->thread() )
+        {
+            name = QStringLiteral( "main" );
+        }
+        else if ( t && !t->objectName().isEmpty() )
+        {
+            name = t->objectName();
+        }
+        else
+        {
+            name = QStringLiteral( "thread %1" ).arg( id );
+        }
+
+        QMutexLocker lock( &s_mutex );
+        s_threadNames.insert( id, name );
+    }
+    return id;
+}
+
+inline qint64
+now()
+{
+    return s_clock.nsecsElapsed() / 1000;
+}
+
+}  // namespace
+
+namespace CalamaresUtils
+{
+namespace Trace
+{
+
+QString
+traceFile()
+{
+    return CalamaresUtils::appLogDir().filePath( QStringLiteral( "session.trace.json" ) );
+}
+
+void
+setupTracing()
+{
+    if ( s_enabled.loadAcquire() )
+    {
+        return;
+    }
+    s_clock.start();
+    s_enabled.storeRelease( 1 );
+    cDebug() << "Tracing enabled, trace will be written to" << traceFile();
+}
+
+void
+stopTracing()
+{
+    s_enabled.storeRelease( 0 );
+    QMutexLocker lock( &s_mutex );
+    s_events.clear();
+}
+
+bool
+isEnabled()
+{
+    return s_enabled.loadAcquire();
+}
+
+bool
+writeTrace( const QString& path )
+{
+    if ( !isEnabled() )
+    {
+        return false;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    {
+        QMutexLocker lock( &s_mutex );
+        for ( auto it = s_threadNames.constBegin(); it != s_threadNames.constEnd(); ++it )
+        {
+            events.append( QJsonObject { { "name", "thread_name" },
+                                         { "ph", "M" },
+                                         { "pid", pid },
+                                         { "tid", it.key() },
+                                         { "args", QJsonObject { { "name", it.value() } } } } );
+        }
+        for ( const auto& e : s_events )
+        {
+            events.append( QJsonObject { { "name", e.name },
+                                         { "cat", QString::fromLatin1( e.category ) },
+                                         { "ph", "X" },
+                                         { "pid", pid },
+                                         { "tid", e.thread },
+                                         { "ts", e.start },
+                                         { "dur", e.duration } } );
+        }
+    }
+
+    QSaveFile f( path.isEmpty() ? traceFile() : path );
+    if ( !f.open( QIODevice::WriteOnly ) )
+    {
+        cWarning() << "Could not open trace file" << f.fileName();
+        return false;
+    }
+    QJsonObject trace { { "traceEvents", events }, { "displayTimeUnit", "ms" } };
+    f.write( QJsonDocument( trace ).toJson( QJsonDocument::Compact ) );
+    if ( !f.commit() )
+    {
+        cWarning() << "Could not write trace file" << f.fileName();
+        return false;
+    }
+    return true;
+}
+
+Span::Span( const char* category, const char* name )
+    : m_category( category )
+    , m_staticName( name )
+    , m_start( isEnabled() ? now() : -1 )
+{
+}
+
+Span::Span( const char* category, const QString& name )
+    : m_category( category )
+    , m_staticName( nullptr )
+    , m_start( isEnabled() ? now() : -1 )
+{
+    if ( m_start >= 0 )
+    {
+        m_name = name;
+    }
+}
+
+Span::~Span()
+{
+    if ( m_start < 0 || !isEnabled() )
+    {
+        return;
+    }
+
+    const qint64 end = now();
+    Event e { m_staticName ? QString::fromUtf8( m_staticName ) : m_name, m_category, threadId(), m_start, end - m_start };
+
+    QMutexLocker lock( &s_mutex );
+    s_events.append( e );
+}
+
+}  // namespace Trace
+}  // namespace CalamaresUtils
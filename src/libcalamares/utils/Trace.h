@@ -0,0 +1,94 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILS_TRACE_H
+#define UTILS_TRACE_H
+
+#include "DllMacro.h"
+
+#include <QString>
+
+namespace CalamaresUtils
+{
+/** @brief Timing of startup phases, module loading and jobs
+ *
+ * Tracing records *spans* -- named intervals of time, on a given
+ * thread -- and writes them out as a Chrome trace (JSON), which
+ * can be loaded in chrome://tracing or https://ui.perfetto.dev .
+ *
+ * Tracing is off unless setupTracing() is called (e.g. from the
+ * `--trace` command-line flag); when off, creating a Span costs
+ * one atomic load.
+ */
+namespace Trace
+{
+/** @brief The full path of the trace file.
+ *
+ * This is next to the log file, so usually
+ * ~/.cache/calamares/session.trace.json .
+ */
+DLLEXPORT QString traceFile();
+
+/// @brief Start recording spans (from now on).
+DLLEXPORT void setupTracing();
+
+/** @brief Stop recording spans, and drop the ones recorded so far
+ *
+ * Spans that are still open are dropped when they close. This is
+ * mostly for tests, which must not leave tracing on.
+ */
+DLLEXPORT void stopTracing();
+
+/// @brief Are spans being recorded?
+DLLEXPORT bool isEnabled();
+
+/** @brief Writes all the spans recorded so far to @p path
+ *
+ * If @p path is empty, writes to traceFile(). Spans that are still
+ * open are not included. Returns true on success (and false if
+ * tracing is not enabled).
+ */
+DLLEXPORT bool writeTrace( const QString& path = QString() );
+
+/** @brief RAII for recording a span
+ *
+ * Create a Span at the start of a scope; the span is recorded
+ * (from construction to destruction) when it goes out of scope.
+ * The @p category groups spans, e.g. "startup", "module", "job".
+ */
+class DLLEXPORT Span
+{
+public:
+    /// @brief Span with a fixed @p name (e.g. from __func__), cheap when disabled
+    Span( const char* category, const char* name );
+    /// @brief Span with a computed @p name (e.g. a module instance key)
+    Span( const char* category, const QString& name );
+    ~Span();
+
+    Span( const Span& ) = delete;
+    Span& operator=( const Span& ) = delete;
+
+private:
+    const char* m_category;
+    const char* m_staticName;
+    QString m_name;
+    qint64 m_start;  // microseconds since setupTracing(), or -1 if disabled
+};
+
+}  // namespace Trace
+}  // namespace CalamaresUtils
+
+#endif
@@ -37,6 +37,7 @@
 #include <QFile>
 #include <QMessageBox>
 #include <QMetaObject>
+#include <QProgressDialog>
 
 namespace Calamares
 {
@@ -235,18 +236,30 @@ ViewManager::onInstallationFailed( const QString& message, const QString& detail
         if ( msgBox->buttonRole( button ) == QMessageBox::ButtonRole::YesRole )
         {
             // TODO: host and port should be configurable
-            QString pasteUrlMsg = CalamaresUtils::sendLogToPastebin( msgBox, QStringLiteral( "termbin.com" ), 9999 );
-
-            QString pasteUrlTitle = tr( "Install Log Paste URL" );
-            if ( pasteUrlMsg.isEmpty() )
-            {
-                pasteUrlMsg = tr( "The upload was unsuccessful. No web-paste was done." );
-            }
-
-            // TODO: make the URL clickable, or copy it to the clipboard automatically
-            QMessageBox::critical( nullptr, pasteUrlTitle, pasteUrlMsg );
+            auto* paster = new CalamaresUtils::LogPaster( QStringLiteral( "termbin.com" ), 9999, msgBox );
+            auto* progress = new QProgressDialog( tr( "Uploading the install log…" ), QString(), 0, 100 );
+            progress->setCancelButton( nullptr );
+            progress->setMinimumDuration( 0 );
+            connect( paster, &CalamaresUtils::LogPaster::progress, progress, [progress]( qint64 sent, qint64 total ) {
+                progress->setValue( total > 0 ? static_cast< int >( sent * 100 / total ) : 0 );
+            } );
+            connect( paster, &CalamaresUtils::LogPaster::finished, [progress]( const QString& url ) {
+                progress->deleteLater();
+
+                QString pasteUrlTitle = tr( "Install Log Paste URL" );
+                QString pasteUrlMsg = url.isEmpty() ? tr( "The upload was unsuccessful. No web-paste was done." )
+                                                    : tr( "Install log posted to:\n%1" ).arg( url );
+
+                // TODO: make the URL clickable, or copy it to the clipboard automatically
+                QMessageBox::critical( nullptr, pasteUrlTitle, pasteUrlMsg );
+                QApplication::quit();
+            } );
+            paster->start();
+        }
+        else
+        {
+            QApplication::quit();
         }
-        QApplication::quit();
     } );
 }
 
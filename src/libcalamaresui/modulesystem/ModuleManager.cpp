@@ -25,6 +25,7 @@
 #include "ViewManager.h"
 
 #include "utils/Logger.h"
+#include "utils/Trace.h"
 #include "utils/Yaml.h"
 #include "viewpages/ExecutionViewStep.h"
 
@@ -72,6 +73,7 @@ ModuleManager::init()
 void
 ModuleManager::doInit()
 {
+    CalamaresUtils::Trace::Span span( "startup", "ModuleManager::doInit" );
     // We start from a list of paths in m_paths. Each of those is a directory that
     // might (should) contain Calamares modules of any type/interface.
     // For each modules search path (directory), it is expected that each module
@@ -211,9 +213,22 @@ getConfigFileName( const Settings::InstanceDescriptionList& customInstances,
     }
 }
 
+/** @brief Should loading of @p module wait until its jobs are needed?
+ *
+ * With lazy-loading, job modules in an *exec* section are only
+ * loaded when the ExecutionViewStep builds the job queue.
+ */
+static bool
+isDeferredLoad( const Module* module, ModuleSystem::Action action )
+{
+    return Settings::instance()->lazyLoading() && ( action == ModuleSystem::Action::Exec )
+        && ( module->type() == Module::Type::Job );
+}
+
 void
 ModuleManager::loadModules()
 {
+    CalamaresUtils::Trace::Span span( "startup", "ModuleManager::loadModules" );
     if ( checkDependencies() )
     {
         cWarning() << "Some installed modules have unmet dependencies.";
@@ -268,7 +283,7 @@ ModuleManager::loadModules()
             Module* thisModule = m_loadedModulesByInstanceKey.value( instanceKey, nullptr );
             if ( thisModule )
             {
-                if ( thisModule->isLoaded() )
+                if ( thisModule->isLoaded() || isDeferredLoad( thisModule, currentAction ) )
                 {
                     // It's been listed before, don't bother loading again.
                     // This can happen for a module listed twice (e.g. with custom instances)
@@ -304,10 +319,18 @@ ModuleManager::loadModules()
                     continue;
                 }
 
-                // If it's a ViewModule, it also appends the ViewStep to the ViewManager.
-                thisModule->loadSelf();
                 m_loadedModulesByInstanceKey.insert( instanceKey, thisModule );
-                if ( !thisModule->isLoaded() )
+                if ( isDeferredLoad( thisModule, currentAction ) )
+                {
+                    cDebug() << "Module" << instanceKey.toString() << "will be loaded when needed.";
+                }
+                else
+                {
+                    CalamaresUtils::Trace::Span moduleSpan( "module", instanceKey.toString() );
+                    // If it's a ViewModule, it also appends the ViewStep to the ViewManager.
+                    thisModule->loadSelf();
+                }
+                if ( !thisModule->isLoaded() && !isDeferredLoad( thisModule, currentAction ) )
                 {
                     cError() << "Module" << instanceKey.toString() << "loading FAILED.";
                     failedModules.append( instanceKey.toString() );
@@ -22,6 +22,7 @@
 #include "Requirement.h"
 
 #include "utils/Logger.h"
+#include "utils/Trace.h"
 
 #include <algorithm>
 
@@ -56,6 +57,7 @@ registerMetatypes()
 static void
 check( Module* const& m, RequirementsChecker* c )
 {
+    CalamaresUtils::Trace::Span span( "requirements", m->instanceKey().toString() );
     RequirementsList l = m->checkRequirements();
     if ( l.count() > 0 )
     {
@@ -24,76 +24,269 @@
 #include <QRegularExpression>
 #include <QTcpSocket>
 #include <QUrl>
+#include <QtConcurrent/QtConcurrentRun>
+
+#ifdef WITH_ZLIB
+#include <string.h>
+#include <zlib.h>
+#endif
 
 namespace CalamaresUtils
 {
 
-QString
-sendLogToPastebin( QObject* parent, const QString& ficheHost, quint16 fichePort )
+/// Pastebins don't take arbitrarily large pastes; termbin's limit is a few MiB
+static constexpr qint64 DEFAULT_MAXIMUM_SIZE = 1024 * 1024;
+/// Bytes handed to the socket at a time, so progress is meaningful
+static constexpr qint64 CHUNK_SIZE = 64 * 1024;
+/// Give up if the connection is silent for this long
+static constexpr int TIMEOUT_MS = 30000;
+
+LogPaster::LogPaster( const QString& ficheHost, quint16 fichePort, QObject* parent )
+    : QObject( parent )
+    , m_ficheHost( ficheHost )
+    , m_fichePort( fichePort )
+    , m_maximumSize( DEFAULT_MAXIMUM_SIZE )
+{
+    m_timeout.setSingleShot( true );
+    m_timeout.setInterval( TIMEOUT_MS );
+    connect( &m_timeout, &QTimer::timeout, this, [this]() { fail( QStringLiteral( "Paste server timed out" ) ); } );
+    connect( &m_reader, &QFutureWatcher< QByteArray >::finished, this, &LogPaster::dataReady );
+}
+
+LogPaster::~LogPaster()
+{
+    m_reader.waitForFinished();
+}
+
+bool
+LogPaster::isCompressionSupported( Compression c )
+{
+    switch ( c )
+    {
+    case Compression::None:
+        return true;
+    case Compression::Gzip:
+#ifdef WITH_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+QByteArray
+LogPaster::readTruncated( const QString& fileName, qint64 maximumSize )
 {
-    QString pasteUrlFmt = parent->tr( "Install log posted to:\n%1" );
-    QFile pasteSourceFile( Logger::logFile() );
-    if ( !pasteSourceFile.open( QIODevice::ReadOnly | QIODevice::Text ) )
+    QFile f( fileName );
+    if ( !f.open( QIODevice::ReadOnly ) )
     {
-        cError() << "Could not open log file";
-        return QString();
+        return QByteArray();
     }
 
-    QByteArray pasteData;
-    while ( !pasteSourceFile.atEnd() )
+    const qint64 size = f.size();
+    if ( maximumSize <= 0 || size <= maximumSize )
     {
-        pasteData += pasteSourceFile.readLine();
+        return f.readAll();
     }
 
-    QTcpSocket* socket = new QTcpSocket( parent );
-    socket->connectToHost( ficheHost, fichePort );
+    const qint64 half = maximumSize / 2;
+    QByteArray head = f.read( half );
+    int cut = head.lastIndexOf( '\n' );
+    if ( cut >= 0 )
+    {
+        head.truncate( cut + 1 );
+    }
 
-    if ( !socket->waitForConnected() )
+    f.seek( size - half );
+    QByteArray tail = f.read( half );
+    cut = tail.indexOf( '\n' );
+    if ( cut >= 0 )
     {
-        cError() << "Could not connect to paste server";
-        socket->close();
-        return QString();
+        tail.remove( 0, cut + 1 );
     }
 
-    cDebug() << "Connected to paste server";
+    const qint64 omitted = size - head.size() - tail.size();
+    return head + QStringLiteral( "\n[... %1 bytes omitted ...]\n\n" ).arg( omitted ).toUtf8() + tail;
+}
+
+QByteArray
+LogPaster::compress( const QByteArray& data, Compression c )
+{
+    switch ( c )
+    {
+    case Compression::None:
+        return data;
+    case Compression::Gzip:
+#ifdef WITH_ZLIB
+    {
+        z_stream zs;
+        memset( &zs, 0, sizeof( zs ) );
+        // 15 + 16 is the maximum window, with a gzip header rather than a zlib one
+        if ( deflateInit2( &zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+        {
+            return QByteArray();
+        }
+
+        QByteArray out;
+        out.resize( static_cast< int >( deflateBound( &zs, static_cast< uLong >( data.size() ) ) ) );
+        zs.next_in = reinterpret_cast< Bytef* >( const_cast< char* >( data.constData() ) );
+        zs.avail_in = static_cast< uInt >( data.size() );
+        zs.next_out = reinterpret_cast< Bytef* >( out.data() );
+        zs.avail_out = static_cast< uInt >( out.size() );
+
+        int r = deflate( &zs, Z_FINISH );
+        out.resize( static_cast< int >( zs.total_out ) );
+        deflateEnd( &zs );
+        return r == Z_STREAM_END ? out : QByteArray();
+    }
+#else
+        return QByteArray();
+#endif
+    }
+    return QByteArray();
+}
+
+void
+LogPaster::start( const QString& fileName )
+{
+    const QString source = fileName.isEmpty() ? Logger::logFile() : fileName;
+    const qint64 maximumSize = m_maximumSize;
+    const Compression compression = m_compression;
 
-    socket->write( pasteData );
+    if ( m_socket )
+    {
+        m_socket->abort();
+        m_socket->deleteLater();
+        m_socket = nullptr;
+    }
+    m_done = false;
+    m_written = 0;
+    m_response.clear();
+    m_reader.setFuture( QtConcurrent::run( [=]() {
+        QByteArray data = readTruncated( source, maximumSize );
+        if ( compression != Compression::None && !data.isEmpty() )
+        {
+            data = compress( data, compression );
+        }
+        return data;
+    } ) );
+}
 
-    if ( !socket->waitForBytesWritten() )
+void
+LogPaster::dataReady()
+{
+    m_data = m_reader.result();
+    if ( m_data.isEmpty() )
     {
-        cError() << "Could not write to paste server";
-        socket->close();
-        return QString();
+        fail( QStringLiteral( "Could not read log file" ) );
+        return;
     }
 
-    cDebug() << "Paste data written to paste server";
+    m_socket = new QTcpSocket( this );
+    connect( m_socket, &QTcpSocket::connected, this, [this]() {
+        cDebug() << "Connected to paste server";
+        writeChunk();
+    } );
+    connect( m_socket, &QTcpSocket::bytesWritten, this, &LogPaster::writeChunk );
+    connect( m_socket, &QTcpSocket::readyRead, this, &LogPaster::readResponse );
+    connect( m_socket, &QTcpSocket::disconnected, this, &LogPaster::readResponse );
+    connect( m_socket, QOverload< QAbstractSocket::SocketError >::of( &QAbstractSocket::error ), this, [this]() {
+        // The server hangs up after answering; that's fine if there is an answer.
+        if ( m_socket->error() == QAbstractSocket::RemoteHostClosedError && !m_response.isEmpty() )
+        {
+            readResponse();
+        }
+        else
+        {
+            fail( QStringLiteral( "Paste server error: " ) + m_socket->errorString() );
+        }
+    } );
+
+    m_timeout.start();
+    m_socket->connectToHost( m_ficheHost, m_fichePort );
+}
 
-    if ( !socket->waitForReadyRead() )
+void
+LogPaster::writeChunk()
+{
+    if ( m_done )
+    {
+        return;
+    }
+    m_timeout.start();
+
+    // Keep at most one chunk waiting in the socket's buffer
+    if ( m_written < m_data.size() && m_socket->bytesToWrite() < CHUNK_SIZE )
     {
-        cError() << "No data from paste server";
-        socket->close();
-        return QString();
+        const qint64 n = qMin( CHUNK_SIZE, m_data.size() - m_written );
+        const qint64 w = m_socket->write( m_data.constData() + m_written, n );
+        if ( w < 0 )
+        {
+            fail( QStringLiteral( "Could not write to paste server" ) );
+            return;
+        }
+        m_written += w;
     }
 
-    cDebug() << "Reading response from paste server";
+    emit progress( m_written - m_socket->bytesToWrite(), m_data.size() );
+}
+
+void
+LogPaster::readResponse()
+{
+    if ( m_done )
+    {
+        return;
+    }
+    m_timeout.start();
 
-    char resp[ 1024 ];
-    resp[ 0 ] = '\0';
-    qint64 nBytesRead = socket->readLine( resp, 1024 );
-    socket->close();
+    m_response.append( m_socket->readAll() );
+    // fiche answers with one line; accept a missing newline if the server hangs up.
+    const bool complete = m_response.contains( '\n' ) || m_socket->state() != QAbstractSocket::ConnectedState;
+    if ( !complete || m_response.size() > 1024 )
+    {
+        if ( m_response.size() > 1024 )
+        {
+            fail( QStringLiteral( "Paste server response is too long" ) );
+        }
+        return;
+    }
 
-    QUrl pasteUrl = QUrl( QString( resp ).trimmed(), QUrl::StrictMode );
+    const int newline = m_response.indexOf( '\n' );
+    const QByteArray line = newline < 0 ? m_response : m_response.left( newline );
+    QUrl pasteUrl = QUrl( QString::fromUtf8( line ).trimmed(), QUrl::StrictMode );
     QString pasteUrlStr = pasteUrl.toString();
-    QRegularExpression pasteUrlRegex( "^http[s]?://" + ficheHost );
-    QString pasteUrlMsg = QString( pasteUrlFmt ).arg( pasteUrlStr );
+    QRegularExpression pasteUrlRegex( "^http[s]?://" + m_ficheHost );
 
-    if ( nBytesRead < 8 || !pasteUrl.isValid() || !pasteUrlRegex.match( pasteUrlStr ).hasMatch() )
+    if ( m_response.size() < 8 || !pasteUrl.isValid() || !pasteUrlRegex.match( pasteUrlStr ).hasMatch() )
     {
-        cError() << "No data from paste server";
-        return QString();
+        fail( QStringLiteral( "No data from paste server" ) );
+        return;
     }
 
-    cDebug() << "Paste server results:" << pasteUrlMsg;
-    return pasteUrlMsg;
+    m_done = true;
+    m_timeout.stop();
+    m_socket->close();
+    cDebug() << "Paste server results:" << pasteUrlStr;
+    emit finished( pasteUrlStr );
 }
+
+void
+LogPaster::fail( const QString& reason )
+{
+    if ( m_done )
+    {
+        return;
+    }
+    m_done = true;
+    m_timeout.stop();
+    if ( m_socket )
+    {
+        m_socket->abort();
+    }
+    cError() << reason;
+    emit finished( QString() );
+}
+
 }  // namespace CalamaresUtils
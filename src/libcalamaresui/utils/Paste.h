@@ -19,19 +19,94 @@
 #ifndef UTILS_PASTE_H
 #define UTILS_PASTE_H
 
-#include <qglobal.h>  // for quint16
+#include "UiDllMacro.h"
 
-class QObject;
-class QString;
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+class QTcpSocket;
 
 namespace CalamaresUtils
 {
 
-/** @brief Send the current log file to a pastebin
+/** @brief Send a log file to a fiche-compatible pastebin (e.g. termbin.com)
+ *
+ * The upload runs asynchronously: start() returns immediately, and
+ * finished() is emitted once the pastebin has answered (or failed).
+ * The log is read (and optionally compressed) in a background thread,
+ * and written to the socket in chunks so that progress() can be reported.
  *
- * Returns the (string) URL that the pastebin gives us.
+ * Logs larger than the maximum size are truncated in the middle:
+ * the head (how the installation started) and the tail (how it failed)
+ * are kept, with a marker line in between.
  */
-QString sendLogToPastebin( QObject* parent, const QString& ficheHost, quint16 fichePort );
+class UIDLLEXPORT LogPaster : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Compression
+    {
+        None,
+        Gzip  ///< Only if Calamares was built with zlib
+    };
+
+    LogPaster( const QString& ficheHost, quint16 fichePort, QObject* parent = nullptr );
+    ~LogPaster() override;
+
+    /// @brief Maximum size (in bytes, before compression) of the upload; 0 for no limit
+    void setMaximumSize( qint64 bytes ) { m_maximumSize = bytes; }
+    qint64 maximumSize() const { return m_maximumSize; }
+
+    void setCompression( Compression c ) { m_compression = c; }
+    Compression compression() const { return m_compression; }
+
+    static bool isCompressionSupported( Compression c );
+
+    /** @brief Start uploading @p fileName
+     *
+     * With an empty @p fileName, the current Calamares log is sent.
+     */
+    void start( const QString& fileName = QString() );
+
+    /** @brief Reads @p fileName, keeping at most @p maximumSize bytes
+     *
+     * If the file is too large, about half of @p maximumSize is taken from
+     * the start and half from the end, both cut at line boundaries.
+     * With @p maximumSize 0, the whole file is read.
+     */
+    static QByteArray readTruncated( const QString& fileName, qint64 maximumSize );
+
+    /// @brief Compress @p data (returns an empty array on failure)
+    static QByteArray compress( const QByteArray& data, Compression c );
+
+signals:
+    /// @brief @p sent bytes (after compression) out of @p total have been written
+    void progress( qint64 sent, qint64 total );
+    /// @brief The upload is done; @p url is empty if it failed
+    void finished( const QString& url );
+
+private:
+    void dataReady();
+    void writeChunk();
+    void readResponse();
+    void fail( const QString& reason );
+
+    QString m_ficheHost;
+    quint16 m_fichePort;
+    qint64 m_maximumSize;
+    Compression m_compression = Compression::None;
+
+    QFutureWatcher< QByteArray > m_reader;
+    QTcpSocket* m_socket = nullptr;
+    QByteArray m_data;  ///< What is being sent
+    qint64 m_written = 0;  ///< How much of m_data is handed to the socket
+    QByteArray m_response;
+    QTimer m_timeout;
+    bool m_done = false;
+};
 
 }  // namespace CalamaresUtils
 
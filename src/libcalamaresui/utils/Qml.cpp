@@ -20,10 +20,13 @@
 
 #include "Branding.h"
 #include "ViewManager.h"
+#include "utils/Dirs.h"
 #include "utils/Logger.h"
 
 #include <QByteArray>
+#include <QCoreApplication>
 #include <QObject>
+#include <QQmlEngine>
 #include <QQuickItem>
 #include <QString>
 #include <QVariant>
@@ -167,4 +170,18 @@ registerCalamaresModels()
     }
 }
 
+QQmlEngine*
+qmlEngine()
+{
+    static QQmlEngine* engine = nullptr;
+    if ( !engine )
+    {
+        registerCalamaresModels();
+        engine = new QQmlEngine( QCoreApplication::instance() );
+        engine->addImportPath( CalamaresUtils::qmlModulesDir().absolutePath() );
+        cDebug() << "QML import paths:" << Logger::DebugList( engine->importPathList() );
+    }
+    return engine;
+}
+
 }  // namespace CalamaresUtils
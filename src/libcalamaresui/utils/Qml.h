@@ -24,6 +24,7 @@
 #include "modulesystem/InstanceKey.h"
 #include "utils/NamedEnum.h"
 
+class QQmlEngine;
 class QQuickItem;
 
 namespace CalamaresUtils
@@ -41,6 +42,18 @@ namespace CalamaresUtils
  */
 UIDLLEXPORT void registerCalamaresModels();
 
+/** @brief The QML engine shared by all the QML in Calamares
+ *
+ * The branding slideshow, the QML sidebar and QML view steps all use
+ * this engine (instead of one each), so QML types, imports and compiled
+ * files are loaded once. The Calamares models are registered and the
+ * Calamares QML modules directory is in the import path.
+ *
+ * Each user should create its objects in a QQmlContext of its own,
+ * so that context properties do not leak from one to the other.
+ */
+UIDLLEXPORT QQmlEngine* qmlEngine();
+
 /** @brief Calls the QML method @p method on @p qmlObject
  *
  * Pass in only the name of the method (e.g. onActivate). This function
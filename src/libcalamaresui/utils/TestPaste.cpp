@@ -0,0 +1,214 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Paste.h"
+
+#include "utils/Logger.h"
+
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryFile>
+#include <QTimer>
+#include <QtTest/QtTest>
+
+using CalamaresUtils::LogPaster;
+
+/** @brief Minimal stand-in for fiche
+ *
+ * Collects whatever a client sends until it has been quiet for a
+ * moment, then answers with a URL and hangs up -- like termbin.com.
+ */
+class FicheServer : public QObject
+{
+    Q_OBJECT
+public:
+    FicheServer()
+    {
+        m_quiet.setSingleShot( true );
+        m_quiet.setInterval( 200 );
+        connect( &m_server, &QTcpServer::newConnection, this, &FicheServer::accept );
+        connect( &m_quiet, &QTimer::timeout, this, &FicheServer::answer );
+        m_server.listen( QHostAddress::LocalHost );
+    }
+
+    quint16 port() const { return m_server.serverPort(); }
+    QByteArray received() const { return m_received; }
+
+private:
+    void accept()
+    {
+        m_client = m_server.nextPendingConnection();
+        connect( m_client, &QTcpSocket::readyRead, this, [this]() {
+            m_received.append( m_client->readAll() );
+            m_quiet.start();
+        } );
+    }
+
+    void answer()
+    {
+        m_client->write( "http://127.0.0.1/calamares\n" );
+        m_client->flush();
+        m_client->disconnectFromHost();
+    }
+
+    QTcpServer m_server;
+    QTcpSocket* m_client = nullptr;
+    QTimer m_quiet;
+    QByteArray m_received;
+};
+
+class TestPaste : public QObject
+{
+    Q_OBJECT
+public:
+    TestPaste() {}
+    ~TestPaste() override {}
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testTruncate();
+    void testUpload();
+    void testUploadCompressed();
+    void testNoServer();
+
+private:
+    /// @brief Fills @p f with @p lines numbered lines of log-like text
+    void writeLog( QTemporaryFile& f, int lines );
+};
+
+void
+TestPaste::initTestCase()
+{
+    Logger::setupLogLevel( Logger::LOGDEBUG );
+}
+
+void
+TestPaste::writeLog( QTemporaryFile& f, int lines )
+{
+    QVERIFY( f.open() );
+    for ( int i = 0; i < lines; ++i )
+    {
+        f.write( QStringLiteral( "%1 [6]: line %2 of the log\n" ).arg( i, 6 ).arg( i ).toUtf8() );
+    }
+    f.close();
+}
+
+void
+TestPaste::testTruncate()
+{
+    QTemporaryFile f;
+    writeLog( f, 1000 );
+    const qint64 size = QFileInfo( f.fileName() ).size();
+
+    // Small enough: unchanged
+    QCOMPARE( LogPaster::readTruncated( f.fileName(), 0 ).size(), size );
+    QCOMPARE( LogPaster::readTruncated( f.fileName(), size ).size(), size );
+
+    // Too big: head and tail, cut at lines
+    QByteArray data = LogPaster::readTruncated( f.fileName(), 4000 );
+    QVERIFY( data.size() < 4100 );
+    QVERIFY( data.startsWith( "     0 [6]: line 0 of the log\n" ) );
+    QVERIFY( data.endsWith( "   999 [6]: line 999 of the log\n" ) );
+    QVERIFY( data.contains( "bytes omitted" ) );
+    for ( const auto& line : data.split( '\n' ) )
+    {
+        QVERIFY( line.isEmpty() || line.endsWith( "of the log" ) || line.contains( "omitted" ) );
+    }
+
+    QVERIFY( LogPaster::readTruncated( QStringLiteral( "/nonexistent/session.log" ), 0 ).isEmpty() );
+}
+
+void
+TestPaste::testUpload()
+{
+    QTemporaryFile f;
+    writeLog( f, 20000 );  // Several chunks
+    QFile source( f.fileName() );
+    QVERIFY( source.open( QIODevice::ReadOnly ) );
+    const QByteArray contents = source.readAll();
+
+    FicheServer server;
+    QVERIFY( server.port() );
+
+    LogPaster paster( QStringLiteral( "127.0.0.1" ), server.port() );
+    paster.setMaximumSize( 0 );
+    QSignalSpy progress( &paster, &LogPaster::progress );
+    QSignalSpy finished( &paster, &LogPaster::finished );
+    paster.start( f.fileName() );
+
+    QVERIFY( finished.wait( 10000 ) );
+    QCOMPARE( finished.count(), 1 );
+    QCOMPARE( finished.first().first().toString(), QStringLiteral( "http://127.0.0.1/calamares" ) );
+    QCOMPARE( server.received(), contents );
+
+    QVERIFY( progress.count() > 1 );
+    QCOMPARE( progress.last().at( 0 ).toLongLong(), qint64( contents.size() ) );
+    QCOMPARE( progress.last().at( 1 ).toLongLong(), qint64( contents.size() ) );
+}
+
+void
+TestPaste::testUploadCompressed()
+{
+    if ( !LogPaster::isCompressionSupported( LogPaster::Compression::Gzip ) )
+    {
+        QSKIP( "Built without zlib" );
+    }
+
+    QTemporaryFile f;
+    writeLog( f, 20000 );
+
+    FicheServer server;
+    LogPaster paster( QStringLiteral( "127.0.0.1" ), server.port() );
+    paster.setCompression( LogPaster::Compression::Gzip );
+    QSignalSpy finished( &paster, &LogPaster::finished );
+    paster.start( f.fileName() );
+
+    QVERIFY( finished.wait( 10000 ) );
+    QVERIFY( !finished.first().first().toString().isEmpty() );
+    // gzip magic, and log lines compress very well
+    QVERIFY( server.received().startsWith( "\x1f\x8b" ) );
+    QVERIFY( server.received().size() < QFileInfo( f.fileName() ).size() / 4 );
+}
+
+void
+TestPaste::testNoServer()
+{
+    QTemporaryFile f;
+    writeLog( f, 10 );
+
+    quint16 port = 0;
+    {
+        // Find a port nobody listens on
+        FicheServer server;
+        port = server.port();
+    }
+
+    LogPaster paster( QStringLiteral( "127.0.0.1" ), port );
+    QSignalSpy finished( &paster, &LogPaster::finished );
+    paster.start( f.fileName() );
+
+    QVERIFY( finished.wait( 10000 ) );
+    QCOMPARE( finished.count(), 1 );
+    QVERIFY( finished.first().first().toString().isEmpty() );
+}
+
+QTEST_GUILESS_MAIN( TestPaste )
+
+#include "utils/moc-warnings.h"
+
+#include "TestPaste.moc"
@@ -33,6 +33,7 @@
 #include "utils/Logger.h"
 #include "utils/Qml.h"
 #include "utils/Retranslator.h"
+#include "utils/Trace.h"
 
 #include <QDir>
 #include <QLabel>
@@ -51,7 +52,7 @@ ExecutionViewStep::ExecutionViewStep( QObject* parent )
     , m_widget( new QWidget )
     , m_progressBar( new QProgressBar )
     , m_label( new QLabel )
-    , m_qmlShow( new QQuickWidget )
+    , m_qmlShow( new QQuickWidget( CalamaresUtils::qmlEngine(), nullptr ) )
     , m_qmlComponent( nullptr )
     , m_qmlObject( nullptr )
 {
@@ -62,7 +63,6 @@ ExecutionViewStep::ExecutionViewStep( QObject* parent )
 
     m_qmlShow->setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Expanding );
     m_qmlShow->setResizeMode( QQuickWidget::SizeRootObjectToView );
-    m_qmlShow->engine()->addImportPath( CalamaresUtils::qmlModulesDir().absolutePath() );
 
     layout->addWidget( m_qmlShow );
     CalamaresUtils::unmarginLayout( layout );
@@ -72,7 +72,6 @@ ExecutionViewStep::ExecutionViewStep( QObject* parent )
     innerLayout->addWidget( m_progressBar );
     innerLayout->addWidget( m_label );
 
-    cDebug() << "QML import paths:" << Logger::DebugList( m_qmlShow->engine()->importPathList() );
     if ( Branding::instance()->slideshowAPI() == 2 )
     {
         cDebug() << "QML load on startup, API 2.";
@@ -243,9 +242,22 @@ ExecutionViewStep::onActivate()
     changeSlideShowState( Slideshow::Start, m_qmlObject, m_qmlShow );
 
     JobQueue* queue = JobQueue::instance();
+    QStringList failedModules;
     foreach ( const QString& instanceKey, m_jobInstanceKeys )
     {
         Calamares::Module* module = Calamares::ModuleManager::instance()->moduleInstance( instanceKey );
+        if ( module && !module->isLoaded() )
+        {
+            // Loading was deferred (see the *lazy-loading* setting)
+            CalamaresUtils::Trace::Span span( "module", instanceKey );
+            module->loadSelf();
+            if ( !module->isLoaded() )
+            {
+                cError() << "Module" << instanceKey << "loading FAILED.";
+                failedModules.append( instanceKey );
+                continue;
+            }
+        }
         if ( module )
         {
             auto jl = module->jobs();
@@ -260,6 +272,14 @@ ExecutionViewStep::onActivate()
         }
     }
 
+    if ( !failedModules.isEmpty() )
+    {
+        // Nothing has happened to the system yet, so don't start at all.
+        emit queue->failed( tr( "Calamares was unable to load all of the configured modules." ),
+                            failedModules.join( QStringLiteral( ", " ) ) );
+        return;
+    }
+
     queue->start();
 }
 
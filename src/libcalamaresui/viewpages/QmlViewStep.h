@@ -23,6 +23,7 @@
 #include "viewpages/ViewStep.h"
 
 class QQmlComponent;
+class QQmlContext;
 class QQuickItem;
 class QQuickWidget;
 class WaitingWidget;
@@ -109,6 +110,7 @@ private:
     QWidget* m_widget = nullptr;
     WaitingWidget* m_spinner = nullptr;
     QQuickWidget* m_qmlWidget = nullptr;
+    QQmlContext* m_qmlContext = nullptr;  ///< In the shared engine, for this step's context properties
     QQmlComponent* m_qmlComponent = nullptr;
     QQuickItem* m_qmlObject = nullptr;
 };
@@ -52,8 +52,14 @@ def run():
 
     :return:
     """
+    if not libcalamares.utils.initramfs_needed():
+        libcalamares.utils.debug("The initramfs is up-to-date already.")
+        return None
+
     return_code = run_dracut()
 
     if return_code != 0:
         return ( _("Failed to run dracut on the target"),
                  _("The exit code was {}").format(return_code) )
+
+    libcalamares.utils.initramfs_regenerated()
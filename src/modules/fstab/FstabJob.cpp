@@ -0,0 +1,383 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FstabJob.h"
+
+#include "GlobalStorage.h"
+#include "JobQueue.h"
+#include "utils/Logger.h"
+#include "utils/Variant.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+using CalamaresUtils::Partition::BlockDevice;
+using CalamaresUtils::Partition::BlockDeviceList;
+
+static const char fstabHeader[] =
+    "# /etc/fstab: static file system information.\n"
+    "#\n"
+    "# Use 'blkid' to print the universally unique identifier for a device; this may\n"
+    "# be used with UUID= as a more robust way to name devices that works even if\n"
+    "# disks are added and removed. See fstab(5).\n"
+    "#\n"
+    "# <file system>             <mount point>  <type>  <options>  <dump>  <pass>\n";
+
+static const char crypttabHeader[] =
+    "# /etc/crypttab: mappings for encrypted partitions.\n"
+    "#\n"
+    "# Each mapped device will be created in /dev/mapper, so your /etc/fstab\n"
+    "# should use the /dev/mapper/<name> paths for encrypted devices.\n"
+    "#\n"
+    "# See crypttab(5) for the supported syntax.\n"
+    "#\n"
+    "# NOTE: Do not list your root (/) partition here, it must be set up\n"
+    "#       beforehand by the initramfs (/etc/mkinitcpio.conf). The same applies\n"
+    "#       to encrypted swap, which should be set up with mkinitcpio-openswap\n"
+    "#       for resume support.\n"
+    "#\n"
+    "# <name>               <device>                         <password> <options>\n";
+
+/// Turn Parted filesystem names into fstab names
+static QString
+fstabFilesystem( const QString& fs )
+{
+    const QString name = fs.toLower();
+    if ( name == QStringLiteral( "fat16" ) || name == QStringLiteral( "fat32" ) )
+    {
+        return QStringLiteral( "vfat" );
+    }
+    if ( name == QStringLiteral( "linuxswap" ) )
+    {
+        return QStringLiteral( "swap" );
+    }
+    return name;
+}
+
+/// Appends the options in @p extra to @p options, leaving out discard options if @p discard is false
+static void
+appendOptions( QStringList& options, const QString& extra, bool discard )
+{
+    for ( const QString& o : extra.split( ',', QString::SkipEmptyParts ) )
+    {
+        if ( !discard && ( o == QStringLiteral( "discard" ) || o.startsWith( QStringLiteral( "discard=" ) ) ) )
+        {
+            continue;
+        }
+        options.append( o );
+    }
+}
+
+FstabJob::FstabJob( QObject* parent )
+    : Calamares::CppJob( parent )
+{
+}
+
+FstabJob::~FstabJob() {}
+
+QString
+FstabJob::prettyName() const
+{
+    return tr( "Writing fstab." );
+}
+
+QString
+FstabJob::mountOptions( const QString& fs,
+                        const QString& mountPoint,
+                        const QString& efiMountPoint,
+                        const BlockDevice& disk ) const
+{
+    QStringList options;
+    if ( !m_efiMountOptions.isEmpty() && !efiMountPoint.isEmpty() && mountPoint == efiMountPoint )
+    {
+        options.append( m_efiMountOptions );
+    }
+    else
+    {
+        options.append( m_mountOptions.value( fs, m_mountOptions.value( "default" ) ).toString() );
+    }
+
+    // Unknown disks (e.g. LVM volumes) get no extra options
+    if ( disk.isValid() && !disk.rotational )
+    {
+        appendOptions( options, m_ssdExtraMountOptions.value( fs ).toString(), disk.supportsDiscard() );
+    }
+    if ( disk.isValid() && disk.dax )
+    {
+        appendOptions( options, m_daxExtraMountOptions.value( fs ).toString(), disk.supportsDiscard() );
+    }
+    options.removeAll( QString() );
+    return options.join( ',' );
+}
+
+QList< FstabJob::FstabEntry >
+FstabJob::fstabEntries( const QVariantList& partitions,
+                        const BlockDeviceList& devices,
+                        const Subvolumes& subvolumes,
+                        const QString& efiMountPoint ) const
+{
+    QList< FstabEntry > entries;
+    bool rootIsSsd = false;
+    for ( const QVariant& v : partitions )
+    {
+        const QVariantMap partition = v.toMap();
+        FstabEntry e;
+        e.fs = fstabFilesystem( partition.value( "fs" ).toString() );
+        e.mountPoint = partition.value( "mountPoint" ).toString();
+        const QString device = partition.value( "device" ).toString();
+
+        // Swap partitions have no mount point, but do get an entry
+        if ( e.mountPoint.isEmpty() && e.fs != QStringLiteral( "swap" ) )
+        {
+            continue;
+        }
+        if ( e.fs == QStringLiteral( "swap" ) )
+        {
+            if ( !partition.value( "claimed" ).toBool() )
+            {
+                cDebug() << "Ignoring foreign swap" << device << partition.value( "uuid" ).toString();
+                continue;
+            }
+            e.mountPoint = QStringLiteral( "swap" );
+        }
+
+        const BlockDevice disk = CalamaresUtils::Partition::diskFor( devices, device );
+        e.options = mountOptions( e.fs, e.mountPoint, efiMountPoint, disk );
+        e.check = e.mountPoint == QStringLiteral( "/" ) ? 1 : 2;
+        e.device = partition.contains( "luksMapperName" )
+            ? QStringLiteral( "/dev/mapper/" ) + partition.value( "luksMapperName" ).toString()
+            : QStringLiteral( "UUID=" ) + partition.value( "uuid" ).toString();
+
+        if ( e.mountPoint == QStringLiteral( "/" ) )
+        {
+            rootIsSsd = disk.isValid() && !disk.rotational;
+        }
+
+        // Special treatment for a btrfs root with subvolumes
+        if ( e.fs == QStringLiteral( "btrfs" ) && e.mountPoint == QStringLiteral( "/" ) && !subvolumes.root.isEmpty() )
+        {
+            const QString options = e.options;
+            e.options = QStringLiteral( "subvol=%1,%2" ).arg( subvolumes.root, options );
+            entries.append( e );
+            if ( !subvolumes.home.isEmpty() )
+            {
+                e.mountPoint = QStringLiteral( "/home" );
+                e.check = 2;
+                e.options = QStringLiteral( "subvol=%1,%2" ).arg( subvolumes.home, options );
+                entries.append( e );
+            }
+        }
+        else
+        {
+            entries.append( e );
+        }
+    }
+
+    if ( rootIsSsd )
+    {
+        // Mount /tmp on a tmpfs
+        FstabEntry tmp;
+        tmp.device = QStringLiteral( "tmpfs" );
+        tmp.mountPoint = QStringLiteral( "/tmp" );
+        tmp.fs = QStringLiteral( "tmpfs" );
+        tmp.options = QStringLiteral( "defaults,noatime,mode=1777" );
+        entries.append( tmp );
+    }
+    return entries;
+}
+
+QList< FstabJob::CrypttabEntry >
+FstabJob::crypttabEntries( const QVariantList& partitions ) const
+{
+    QList< CrypttabEntry > entries;
+    for ( const QVariant& v : partitions )
+    {
+        const QVariantMap partition = v.toMap();
+        const QString name = partition.value( "luksMapperName" ).toString();
+        const QString uuid = partition.value( "luksUuid" ).toString();
+        if ( name.isEmpty() || uuid.isEmpty() )
+        {
+            continue;
+        }
+        entries.append(
+            { name, QStringLiteral( "UUID=" ) + uuid, QStringLiteral( "/crypto_keyfile.bin" ), m_crypttabOptions } );
+    }
+    return entries;
+}
+
+QByteArray
+FstabJob::formatFstab( const QList< FstabEntry >& entries )
+{
+    QByteArray contents( fstabHeader );
+    for ( const auto& e : entries )
+    {
+        contents.append( QStringLiteral( "%1 %2 %3 %4 0 %5\n" )
+                             .arg( e.device, -41 )
+                             .arg( e.mountPoint, -14 )
+                             .arg( e.fs, -7 )
+                             .arg( e.options, -10 )
+                             .arg( e.check )
+                             .toUtf8() );
+    }
+    return contents;
+}
+
+QByteArray
+FstabJob::formatCrypttab( const QList< CrypttabEntry >& entries )
+{
+    QByteArray contents( crypttabHeader );
+    for ( const auto& e : entries )
+    {
+        contents.append( QStringLiteral( "%1 %2 %3 %4\n" )
+                             .arg( e.name, -21 )
+                             .arg( e.device, -45 )
+                             .arg( e.password )
+                             .arg( e.options )
+                             .toUtf8() );
+    }
+    return contents;
+}
+
+FstabJob::Subvolumes
+FstabJob::mountedSubvolumes( const QString& root, const QString& mountsFile )
+{
+    Subvolumes subvolumes;
+    QFile f( mountsFile.isEmpty() ? QStringLiteral( "/proc/self/mounts" ) : mountsFile );
+    if ( !f.open( QIODevice::ReadOnly ) )
+    {
+        return subvolumes;
+    }
+
+    const QByteArray rootPath = QFile::encodeName( root );
+    const QByteArray homePath = rootPath + "/home";
+    for ( const QByteArray& line : f.readAll().split( '\n' ) )
+    {
+        // device mountpoint type options dump pass
+        const auto fields = line.split( ' ' );
+        if ( fields.count() < 4 || fields.at( 2 ) != "btrfs" )
+        {
+            continue;
+        }
+        QString subvolume;
+        for ( const QByteArray& option : fields.at( 3 ).split( ',' ) )
+        {
+            if ( option.startsWith( "subvol=" ) )
+            {
+                // The kernel lists the subvolume as an absolute path, e.g. subvol=/@
+                subvolume = QString::fromUtf8( option.mid( 7 ) );
+                if ( subvolume.startsWith( '/' ) )
+                {
+                    subvolume = subvolume.mid( 1 );
+                }
+            }
+        }
+        // Later mounts on the same path hide earlier ones, so the last one wins
+        if ( fields.at( 1 ) == rootPath )
+        {
+            subvolumes.root = subvolume;
+        }
+        else if ( fields.at( 1 ) == homePath )
+        {
+            subvolumes.home = subvolume;
+        }
+    }
+    return subvolumes;
+}
+
+/// @brief Replace @p path with @p contents atomically; returns an error message, or empty
+static QString
+writeAtomically( const QString& path, const QByteArray& contents )
+{
+    QSaveFile f( path );
+    if ( !f.open( QIODevice::WriteOnly ) || f.write( contents ) != contents.size() || !f.commit() )
+    {
+        return f.errorString();
+    }
+    return QString();
+}
+
+Calamares::JobResult
+FstabJob::exec()
+{
+    Calamares::GlobalStorage* gs = Calamares::JobQueue::instance()->globalStorage();
+    const QVariantList partitions = gs->value( "partitions" ).toList();
+    const QString root = gs->value( "rootMountPoint" ).toString();
+
+    if ( partitions.isEmpty() )
+    {
+        cWarning() << "No partitions for fstab.";
+        return Calamares::JobResult::error( tr( "Configuration Error" ),
+                                            tr( "No partitions are defined for <pre>%1</pre> to use." ).arg( "fstab" ) );
+    }
+    if ( root.isEmpty() )
+    {
+        cWarning() << "No rootMountPoint for fstab.";
+        return Calamares::JobResult::error(
+            tr( "Configuration Error" ), tr( "No root mount point is given for <pre>%1</pre> to use." ).arg( "fstab" ) );
+    }
+
+    const auto devices = CalamaresUtils::Partition::DeviceInventory::instance()->devices();
+    const auto fstab = fstabEntries(
+        partitions, devices, mountedSubvolumes( root ), gs->value( "efiSystemPartition" ).toString() );
+    const auto crypttab = crypttabEntries( partitions );
+
+    QDir etc( root );
+    if ( !etc.mkpath( QStringLiteral( "etc" ) ) )
+    {
+        return Calamares::JobResult::error( tr( "Could not create directory %1." ).arg( etc.filePath( "etc" ) ) );
+    }
+    for ( const auto& file : { qMakePair( QStringLiteral( "etc/fstab" ), formatFstab( fstab ) ),
+                               qMakePair( QStringLiteral( "etc/crypttab" ), formatCrypttab( crypttab ) ) } )
+    {
+        const QString path = etc.filePath( file.first );
+        const QString error = writeAtomically( path, file.second );
+        if ( !error.isEmpty() )
+        {
+            return Calamares::JobResult::error( tr( "Could not write %1." ).arg( path ), error );
+        }
+    }
+
+    // Create mount points
+    for ( const QVariant& v : partitions )
+    {
+        const QString mountPoint = v.toMap().value( "mountPoint" ).toString();
+        if ( !mountPoint.isEmpty() )
+        {
+            QDir().mkpath( root + mountPoint );
+        }
+    }
+    return Calamares::JobResult::ok();
+}
+
+void
+FstabJob::setConfigurationMap( const QVariantMap& configurationMap )
+{
+    bool ok = false;
+    m_mountOptions = CalamaresUtils::getSubMap( configurationMap, "mountOptions", ok );
+    if ( !ok || !m_mountOptions.contains( "default" ) )
+    {
+        cWarning() << "No *mountOptions* (with a *default*) in fstab configuration.";
+    }
+    m_efiMountOptions = CalamaresUtils::getString( configurationMap, "efiMountOptions" );
+    m_ssdExtraMountOptions = CalamaresUtils::getSubMap( configurationMap, "ssdExtraMountOptions", ok );
+    m_daxExtraMountOptions = CalamaresUtils::getSubMap( configurationMap, "daxExtraMountOptions", ok );
+    m_crypttabOptions = configurationMap.contains( "crypttabOptions" )
+        ? CalamaresUtils::getString( configurationMap, "crypttabOptions" )
+        : QStringLiteral( "luks" );
+}
+
+CALAMARES_PLUGIN_FACTORY_DEFINITION( FstabJobFactory, registerPlugin< FstabJob >(); )
@@ -0,0 +1,113 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FSTABJOB_H
+#define FSTABJOB_H
+
+#include "CppJob.h"
+#include "DllMacro.h"
+#include "partition/DeviceInventory.h"
+#include "utils/PluginFactory.h"
+
+#include <QObject>
+#include <QVariantList>
+#include <QVariantMap>
+
+/** @brief Writes /etc/fstab and /etc/crypttab in the target system
+ *
+ * Mount options depend on the filesystem and on what the disk
+ * holding it can do. The disks are looked up in the shared
+ * DeviceInventory, which reads /sys/block in one go.
+ * Both files are replaced atomically.
+ */
+class PLUGINDLLEXPORT FstabJob : public Calamares::CppJob
+{
+    Q_OBJECT
+
+public:
+    /// @brief One line of /etc/fstab
+    struct FstabEntry
+    {
+        QString device;
+        QString mountPoint;
+        QString fs;
+        QString options;
+        int check = 0;  ///< The pass field; 1 for root, 2 for other partitions
+    };
+
+    /// @brief One line of /etc/crypttab
+    struct CrypttabEntry
+    {
+        QString name;
+        QString device;
+        QString password;
+        QString options;
+    };
+
+    /// @brief btrfs subvolumes that are mounted on / and /home in the target
+    struct Subvolumes
+    {
+        QString root;
+        QString home;
+    };
+
+    explicit FstabJob( QObject* parent = nullptr );
+    ~FstabJob() override;
+
+    QString prettyName() const override;
+
+    Calamares::JobResult exec() override;
+
+    void setConfigurationMap( const QVariantMap& configurationMap ) override;
+
+    /** @brief The fstab lines for @p partitions (from GlobalStorage)
+     *
+     * The disks holding the partitions are looked up in @p devices.
+     * A btrfs root gets a line for each of the @p subvolumes.
+     */
+    QList< FstabEntry > fstabEntries( const QVariantList& partitions,
+                                      const CalamaresUtils::Partition::BlockDeviceList& devices,
+                                      const Subvolumes& subvolumes,
+                                      const QString& efiMountPoint ) const;
+    /// @brief The crypttab lines for @p partitions (from GlobalStorage)
+    QList< CrypttabEntry > crypttabEntries( const QVariantList& partitions ) const;
+
+    static QByteArray formatFstab( const QList< FstabEntry >& entries );
+    static QByteArray formatCrypttab( const QList< CrypttabEntry >& entries );
+
+    /** @brief The btrfs subvolumes mounted at @p root and @p root /home
+     *
+     * Reads the mount options (subvol=) from @p mountsFile, which is
+     * /proc/self/mounts by default.
+     */
+    static Subvolumes mountedSubvolumes( const QString& root, const QString& mountsFile = QString() );
+
+private:
+    QString mountOptions( const QString& fs,
+                          const QString& mountPoint,
+                          const QString& efiMountPoint,
+                          const CalamaresUtils::Partition::BlockDevice& disk ) const;
+
+    QVariantMap m_mountOptions;
+    QString m_efiMountOptions;
+    QVariantMap m_ssdExtraMountOptions;
+    QVariantMap m_daxExtraMountOptions;
+    QString m_crypttabOptions;
+};
+
+CALAMARES_PLUGIN_FACTORY_DECLARATION( FstabJobFactory )
+
+#endif  // FSTABJOB_H
@@ -0,0 +1,209 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FstabJob.h"
+
+#include "utils/Logger.h"
+
+#include <QTemporaryFile>
+#include <QtTest/QtTest>
+
+using CalamaresUtils::Partition::BlockDevice;
+using CalamaresUtils::Partition::BlockDeviceList;
+
+class FstabTests : public QObject
+{
+    Q_OBJECT
+public:
+    FstabTests() {}
+    ~FstabTests() override {}
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testOptions();
+    void testBtrfs();
+    void testCrypttab();
+    void testMountedSubvolumes();
+
+private:
+    void configure( FstabJob& job )
+    {
+        job.setConfigurationMap( QVariantMap {
+            { "mountOptions",
+              QVariantMap { { "default", "defaults,noatime" }, { "btrfs", "defaults,noatime,autodefrag" } } },
+            { "efiMountOptions", "umask=0077" },
+            { "ssdExtraMountOptions",
+              QVariantMap { { "ext4", "discard" }, { "swap", "discard" }, { "btrfs", "discard=async,compress=lzo" } } },
+            { "daxExtraMountOptions", QVariantMap { { "ext4", "dax" } } } } );
+    }
+
+    static QVariantMap
+    partition( const QString& device, const QString& mountPoint, const QString& fs, const QString& uuid )
+    {
+        return QVariantMap { { "device", device }, { "mountPoint", mountPoint }, { "fs", fs }, { "uuid", uuid } };
+    }
+
+    static BlockDeviceList devices()
+    {
+        BlockDevice hdd;
+        hdd.name = "sda";
+        hdd.partitions = QStringList { "sda1", "sda2", "sda3" };
+
+        BlockDevice ssd;  // Without discard
+        ssd.name = "sdb";
+        ssd.rotational = false;
+        ssd.partitions = QStringList { "sdb1" };
+
+        BlockDevice nvme;
+        nvme.name = "nvme0n1";
+        nvme.rotational = false;
+        nvme.discardGranularity = 512;
+        nvme.partitions = QStringList { "nvme0n1p1", "nvme0n1p2" };
+
+        BlockDevice pmem;
+        pmem.name = "pmem0";
+        pmem.rotational = false;
+        pmem.dax = true;
+
+        return { hdd, ssd, nvme, pmem };
+    }
+};
+
+void
+FstabTests::initTestCase()
+{
+    Logger::setupLogLevel( Logger::LOGDEBUG );
+}
+
+void
+FstabTests::testOptions()
+{
+    FstabJob job;
+    configure( job );
+
+    QVariantMap swap = partition( "/dev/nvme0n1p2", "", "linuxswap", "swap-uuid" );
+    swap.insert( "claimed", true );
+    const QVariantList partitions { partition( "/dev/nvme0n1p1", "/", "ext4", "root-uuid" ),
+                                    partition( "/dev/sda1", "/boot/efi", "fat32", "efi-uuid" ),
+                                    partition( "/dev/sda2", "/home", "ext4", "home-uuid" ),
+                                    partition( "/dev/sdb1", "/srv", "ext4", "srv-uuid" ),
+                                    partition( "/dev/pmem0", "/data", "ext4", "data-uuid" ),
+                                    partition( "/dev/sda3", "", "linuxswap", "foreign-uuid" ),  // not claimed
+                                    swap };
+
+    const auto entries = job.fstabEntries( partitions, devices(), FstabJob::Subvolumes(), "/boot/efi" );
+    QCOMPARE( entries.count(), 7 );  // 5 filesystems, 1 swap and /tmp
+
+    QCOMPARE( entries.at( 0 ).device, QStringLiteral( "UUID=root-uuid" ) );
+    QCOMPARE( entries.at( 0 ).options, QStringLiteral( "defaults,noatime,discard" ) );
+    QCOMPARE( entries.at( 0 ).check, 1 );
+    QCOMPARE( entries.at( 1 ).fs, QStringLiteral( "vfat" ) );
+    QCOMPARE( entries.at( 1 ).options, QStringLiteral( "umask=0077" ) );
+    QCOMPARE( entries.at( 2 ).options, QStringLiteral( "defaults,noatime" ) );  // Rotational
+    QCOMPARE( entries.at( 3 ).options, QStringLiteral( "defaults,noatime" ) );  // SSD without discard
+    QCOMPARE( entries.at( 4 ).options, QStringLiteral( "defaults,noatime,dax" ) );
+    QCOMPARE( entries.at( 5 ).mountPoint, QStringLiteral( "swap" ) );
+    QCOMPARE( entries.at( 5 ).fs, QStringLiteral( "swap" ) );
+    QCOMPARE( entries.at( 5 ).options, QStringLiteral( "defaults,noatime,discard" ) );
+    QCOMPARE( entries.at( 6 ).mountPoint, QStringLiteral( "/tmp" ) );  // Because root is on an SSD
+    QCOMPARE( entries.at( 6 ).check, 0 );
+
+    const QByteArray fstab = FstabJob::formatFstab( entries );
+    QVERIFY( fstab.startsWith( "# /etc/fstab" ) );
+    QVERIFY( fstab.contains(
+        "\nUUID=root-uuid                            /              ext4    defaults,noatime,discard 0 1\n" ) );
+    QVERIFY( fstab.contains(
+        "\ntmpfs                                     /tmp           tmpfs   defaults,noatime,mode=1777 0 0\n" ) );
+}
+
+void
+FstabTests::testBtrfs()
+{
+    FstabJob job;
+    configure( job );
+
+    const QVariantList partitions { partition( "/dev/nvme0n1p1", "/", "btrfs", "root-uuid" ) };
+    {
+        const auto entries = job.fstabEntries( partitions, devices(), { "@", "@home" }, QString() );
+        QCOMPARE( entries.count(), 3 );
+        QCOMPARE( entries.at( 0 ).mountPoint, QStringLiteral( "/" ) );
+        QCOMPARE( entries.at( 0 ).options,
+                  QStringLiteral( "subvol=@,defaults,noatime,autodefrag,discard=async,compress=lzo" ) );
+        QCOMPARE( entries.at( 1 ).mountPoint, QStringLiteral( "/home" ) );
+        QCOMPARE( entries.at( 1 ).device, QStringLiteral( "UUID=root-uuid" ) );
+        QCOMPARE( entries.at( 1 ).options,
+                  QStringLiteral( "subvol=@home,defaults,noatime,autodefrag,discard=async,compress=lzo" ) );
+        QCOMPARE( entries.at( 1 ).check, 2 );
+    }
+    {
+        // Not mounted from a subvolume
+        const auto entries = job.fstabEntries( partitions, devices(), FstabJob::Subvolumes(), QString() );
+        QCOMPARE( entries.count(), 2 );
+        QCOMPARE( entries.at( 0 ).options, QStringLiteral( "defaults,noatime,autodefrag,discard=async,compress=lzo" ) );
+    }
+}
+
+void
+FstabTests::testCrypttab()
+{
+    FstabJob job;
+    configure( job );
+
+    QVariantMap crypted = partition( "/dev/sda2", "/home", "ext4", "home-uuid" );
+    crypted.insert( "luksMapperName", "luks-home" );
+    crypted.insert( "luksUuid", "luks-uuid" );
+    const QVariantList partitions { partition( "/dev/sda1", "/", "ext4", "root-uuid" ), crypted };
+
+    const auto fstab = job.fstabEntries( partitions, devices(), FstabJob::Subvolumes(), QString() );
+    QCOMPARE( fstab.count(), 2 );
+    QCOMPARE( fstab.at( 1 ).device, QStringLiteral( "/dev/mapper/luks-home" ) );
+
+    const auto crypttab = job.crypttabEntries( partitions );
+    QCOMPARE( crypttab.count(), 1 );
+    QCOMPARE( crypttab.first().name, QStringLiteral( "luks-home" ) );
+    QCOMPARE( crypttab.first().device, QStringLiteral( "UUID=luks-uuid" ) );
+    QCOMPARE( crypttab.first().options, QStringLiteral( "luks" ) );  // The default
+    QVERIFY( FstabJob::formatCrypttab( crypttab )
+                 .endsWith( "\nluks-home             UUID=luks-uuid                                "
+                            "/crypto_keyfile.bin luks\n" ) );
+}
+
+void
+FstabTests::testMountedSubvolumes()
+{
+    QTemporaryFile mounts;
+    QVERIFY( mounts.open() );
+    mounts.write( "/dev/sda2 / ext4 rw,relatime 0 0\n"
+                  "/dev/nvme0n1p1 /tmp/calamares-root-x btrfs rw,noatime,subvolid=256,subvol=/@ 0 0\n"
+                  "/dev/nvme0n1p1 /tmp/calamares-root-x/home btrfs rw,noatime,subvolid=257,subvol=/@home 0 0\n"
+                  "proc /tmp/calamares-root-x/proc proc rw 0 0\n" );
+    mounts.close();
+
+    auto subvolumes = FstabJob::mountedSubvolumes( "/tmp/calamares-root-x", mounts.fileName() );
+    QCOMPARE( subvolumes.root, QStringLiteral( "@" ) );
+    QCOMPARE( subvolumes.home, QStringLiteral( "@home" ) );
+
+    subvolumes = FstabJob::mountedSubvolumes( "/tmp/calamares-root-y", mounts.fileName() );
+    QVERIFY( subvolumes.root.isEmpty() );
+    QVERIFY( subvolumes.home.isEmpty() );
+}
+
+QTEST_GUILESS_MAIN( FstabTests )
+
+#include "utils/moc-warnings.h"
+
+#include "Tests.moc"
@@ -19,6 +19,7 @@
 #include "InitcpioJob.h"
 
 #include "utils/CalamaresUtilsSystem.h"
+#include "utils/Initramfs.h"
 #include "utils/Logger.h"
 #include "utils/UMask.h"
 #include "utils/Variant.h"
@@ -57,6 +58,14 @@ fixPermissions( const QDir& d )
 Calamares::JobResult
 InitcpioJob::exec()
 {
+    if ( !CalamaresUtils::Initramfs::isRegenerationNeeded() )
+    {
+        cDebug() << "The initramfs is up-to-date already.";
+        return Calamares::JobResult::ok();
+    }
+    cDebug() << "Regenerating initramfs for" << CalamaresUtils::Initramfs::regenerationRequests();
+    CalamaresUtils::Initramfs::restoreHooks();
+
     CalamaresUtils::UMask m( CalamaresUtils::UMask::Safe );
 
     if ( m_unsafe )
@@ -75,6 +84,10 @@ InitcpioJob::exec()
     cDebug() << "Updating initramfs with kernel" << m_kernel;
     auto r = CalamaresUtils::System::instance()->targetEnvCommand(
         { "mkinitcpio", "-p", m_kernel }, QString(), QString() /* no timeout , 0 */ );
+    if ( r.getExitCode() == 0 )
+    {
+        CalamaresUtils::Initramfs::regenerated();
+    }
     return r.explainProcess( "mkinitcpio", std::chrono::seconds( 10 ) /* fake timeout */ );
 }
 
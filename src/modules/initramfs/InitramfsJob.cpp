@@ -19,6 +19,7 @@
 #include "InitramfsJob.h"
 
 #include "utils/CalamaresUtilsSystem.h"
+#include "utils/Initramfs.h"
 #include "utils/Logger.h"
 #include "utils/UMask.h"
 #include "utils/Variant.h"
@@ -41,6 +42,14 @@ InitramfsJob::prettyName() const
 Calamares::JobResult
 InitramfsJob::exec()
 {
+    if ( !CalamaresUtils::Initramfs::isRegenerationNeeded() )
+    {
+        cDebug() << "The initramfs is up-to-date already.";
+        return Calamares::JobResult::ok();
+    }
+    cDebug() << "Regenerating initramfs for" << CalamaresUtils::Initramfs::regenerationRequests();
+    CalamaresUtils::Initramfs::restoreHooks();
+
     CalamaresUtils::UMask m( CalamaresUtils::UMask::Safe );
 
     cDebug() << "Updating initramfs with kernel" << m_kernel;
@@ -64,6 +73,10 @@ InitramfsJob::exec()
     // And then do the ACTUAL work.
     auto r = CalamaresUtils::System::instance()->targetEnvCommand(
         { "update-initramfs", "-k", m_kernel, "-c", "-t" }, QString(), QString() /* no timeout, 0 */ );
+    if ( r.getExitCode() == 0 )
+    {
+        CalamaresUtils::Initramfs::regenerated();
+    }
     return r.explainProcess( "update-initramfs", std::chrono::seconds( 10 ) /* fake timeout */ );
 }
 
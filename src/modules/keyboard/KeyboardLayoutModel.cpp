@@ -25,7 +25,6 @@
 KeyboardLayoutModel::KeyboardLayoutModel( QObject* parent )
     : QAbstractListModel( parent )
 {
-    init();
 }
 
 
@@ -58,17 +57,27 @@ KeyboardLayoutModel::data( const QModelIndex& index, int role ) const
 
 
 void
-KeyboardLayoutModel::init()
+KeyboardLayoutModel::setLayouts( const LayoutList& layouts )
 {
-    KeyboardGlobal::LayoutsMap layouts =
-        KeyboardGlobal::getKeyboardLayouts();
+    beginResetModel();
+    m_layouts = layouts;
+    endResetModel();
+}
+
+
+KeyboardLayoutModel::LayoutList
+KeyboardLayoutModel::sortedLayouts( const KeyboardGlobal::LayoutsMap& layouts )
+{
+    LayoutList l;
+    l.reserve( layouts.count() );
     for ( KeyboardGlobal::LayoutsMap::const_iterator it = layouts.constBegin();
             it != layouts.constEnd(); ++it )
-        m_layouts.append( qMakePair( it.key(), it.value() ) );
+        l.append( qMakePair( it.key(), it.value() ) );
 
-    std::stable_sort( m_layouts.begin(), m_layouts.end(), []( const QPair< QString, KeyboardGlobal::KeyboardInfo >& a,
+    std::stable_sort( l.begin(), l.end(), []( const QPair< QString, KeyboardGlobal::KeyboardInfo >& a,
                       const QPair< QString, KeyboardGlobal::KeyboardInfo >& b )
     {
         return a.second.description < b.second.description;
     } );
+    return l;
 }
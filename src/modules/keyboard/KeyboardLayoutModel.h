@@ -36,16 +36,30 @@ public:
         KeyboardLayoutKeyRole
     };
 
+    using LayoutList = QList< QPair< QString, KeyboardGlobal::KeyboardInfo > >;
+
+    /** @brief Creates an empty model
+     *
+     * Fill the model with setLayouts(), typically with layouts
+     * that were loaded (and sorted) in the background.
+     */
     KeyboardLayoutModel( QObject* parent = nullptr );
 
     int rowCount( const QModelIndex& parent = QModelIndex() ) const override;
 
     QVariant data( const QModelIndex& index, int role ) const override;
 
-private:
-    void init();
+    /// @brief Replaces the layouts in the model (resets the model)
+    void setLayouts( const LayoutList& layouts );
 
-    QList< QPair< QString, KeyboardGlobal::KeyboardInfo > > m_layouts;
+    /** @brief Turns the layouts map into a list sorted by description
+     *
+     * This is thread-safe, so it can be done while loading the layouts.
+     */
+    static LayoutList sortedLayouts( const KeyboardGlobal::LayoutsMap& layouts );
+
+private:
+    LayoutList m_layouts;
 };
 
 #endif // KEYBOARDLAYOUTMODEL_H
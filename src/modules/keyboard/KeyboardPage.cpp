@@ -36,6 +36,7 @@
 #include <QComboBox>
 #include <QProcess>
 #include <QPushButton>
+#include <QtConcurrent/QtConcurrentRun>
 
 class LayoutItem : public QListWidgetItem
 {
@@ -69,7 +70,9 @@ KeyboardPage::KeyboardPage( QWidget* parent )
     : QWidget( parent )
     , ui( new Ui::Page_Keyboard )
     , m_keyboardPreview( new KeyBoardPreview( this ) )
+    , m_layoutModel( new KeyboardLayoutModel( this ) )
     , m_defaultIndex( 0 )
+    , m_setxkbmapPending( false )
 {
     ui->setupUi( this );
 
@@ -77,6 +80,13 @@ KeyboardPage::KeyboardPage( QWidget* parent )
     ui->KBPreviewLayout->addWidget( m_keyboardPreview );
 
     m_setxkbmapTimer.setSingleShot( true );
+    connect( &m_setxkbmapTimer, &QTimer::timeout, this, &KeyboardPage::applyXkbmap );
+    connect( &m_setxkbmapWatcher, &QFutureWatcher< void >::finished, this, [this] {
+        if ( m_setxkbmapPending )
+        {
+            applyXkbmap();
+        }
+    } );
 
     // Connect signals and slots
     connect( ui->listVariant, &QListWidget::currentItemChanged,
@@ -92,10 +102,9 @@ KeyboardPage::KeyboardPage( QWidget* parent )
              static_cast< void ( QComboBox::* )( const QString& ) >( &QComboBox::currentIndexChanged ),
              [this]( const QString& text )
     {
-        QString model = m_models.value( text, "pc105" );
-
+        Q_UNUSED( text )
         // Set Xorg keyboard model
-        QProcess::execute( "setxkbmap", QStringList{ "-model", model } );
+        m_setxkbmapTimer.start( QApplication::keyboardInputInterval() );
     } );
 
     CALAMARES_RETRANSLATE( ui->retranslateUi( this ); )
@@ -108,10 +117,12 @@ KeyboardPage::~KeyboardPage()
 }
 
 
-void
-KeyboardPage::init()
+/* Runs `setxkbmap -print` to find the currently-active layout
+ * and variant; returns empty strings if there is none.
+ */
+static QPair< QString, QString >
+detectCurrentLayout()
 {
-    //### Detect current keyboard layout and variant
     QString currentLayout;
     QString currentVariant;
     QProcess process;
@@ -154,8 +165,52 @@ KeyboardPage::init()
         }
     }
 
+    return qMakePair( currentLayout, currentVariant );
+}
+
+
+/// Loads everything the page needs; this runs in a worker thread.
+static KeyboardData
+loadKeyboardData()
+{
+    KeyboardData data;
+
+    //### Detect current keyboard layout and variant
+    const auto current = detectCurrentLayout();
+    data.currentLayout = current.first;
+    data.currentVariant = current.second;
+
+    //### Models, Layouts and Variants
+    KeyboardGlobal::Database db = KeyboardGlobal::getDatabase();
+    data.models = db.models;
+    data.layouts = KeyboardLayoutModel::sortedLayouts( db.layouts );
+
+    return data;
+}
+
+
+void
+KeyboardPage::init()
+{
+    ui->listLayout->setModel( m_layoutModel );
+    connect( ui->listLayout->selectionModel(), &QItemSelectionModel::currentChanged,
+             this, &KeyboardPage::onListLayoutCurrentItemChanged );
+
+    connect( &m_loadWatcher, &QFutureWatcher< KeyboardData >::finished,
+             this, &KeyboardPage::onKeyboardDataLoaded );
+    m_loadWatcher.setFuture( QtConcurrent::run( loadKeyboardData ) );
+}
+
+
+void
+KeyboardPage::onKeyboardDataLoaded()
+{
+    const KeyboardData data = m_loadWatcher.result();
+    QString currentLayout = data.currentLayout;
+    const QString currentVariant = data.currentVariant;
+
     //### Models
-    m_models = KeyboardGlobal::getKeyboardModels();
+    m_models = data.models;
     QMapIterator< QString, QString > mi( m_models );
 
     ui->comboBoxModel->blockSignals( true );
@@ -178,10 +233,8 @@ KeyboardPage::init()
 
     //### Layouts and Variants
 
-    KeyboardLayoutModel* klm = new KeyboardLayoutModel( this );
-    ui->listLayout->setModel( klm );
-    connect( ui->listLayout->selectionModel(), &QItemSelectionModel::currentChanged,
-             this, &KeyboardPage::onListLayoutCurrentItemChanged );
+    KeyboardLayoutModel* klm = m_layoutModel;
+    klm->setLayouts( data.layouts );
 
     // Block signals
     ui->listLayout->blockSignals( true );
@@ -209,6 +262,13 @@ KeyboardPage::init()
     // Do this after unblocking signals so we get the default variant handling.
     if ( !currentLayoutItem.isValid() && klm->rowCount() > 0 )
         ui->listLayout->setCurrentIndex( klm->index( 0 ) );
+
+    // The page was activated before the data was here
+    if ( !m_pendingLangParts.isEmpty() )
+    {
+        guessLayout( m_pendingLangParts );
+        m_pendingLangParts.clear();
+    }
 }
 
 
@@ -250,7 +310,7 @@ KeyboardPage::createJobs( const QString& xOrgConfFileName,
 void
 KeyboardPage::guessLayout( const QStringList& langParts )
 {
-    const KeyboardLayoutModel* klm = dynamic_cast< KeyboardLayoutModel* >( ui->listLayout->model() );
+    const KeyboardLayoutModel* klm = m_layoutModel;
     bool foundCountryPart = false;
     for ( auto countryPart = langParts.rbegin(); !foundCountryPart && countryPart != langParts.rend(); ++countryPart )
     {
@@ -374,7 +434,10 @@ KeyboardPage::onActivate()
         QString country = QLocale::countryToString( QLocale( lang ).country() );
         cDebug() << Logger::SubEntry << "extracted country" << country << "::" << langParts;
 
-        guessLayout( langParts );
+        if ( m_loadWatcher.isFinished() )
+            guessLayout( langParts );
+        else
+            m_pendingLangParts = langParts;
     }
 }
 
@@ -444,16 +507,35 @@ KeyboardPage::onListLayoutCurrentItemChanged( const QModelIndex& current,
 }
 
 /* Returns stringlist with suitable setxkbmap command-line arguments
- * to set the given @p layout and @p variant.
+ * to set the given @p model, @p layout and @p variant. An empty
+ * layout leaves the layout (and variant) unchanged.
  */
-static inline QStringList xkbmap_args( const QString& layout, const QString& variant )
+static inline QStringList xkbmap_args( const QString& model, const QString& layout, const QString& variant )
 {
-    QStringList r{ "-layout", layout };
-    if ( !variant.isEmpty() )
+    QStringList r{ "-model", model };
+    if ( !layout.isEmpty() )
+        r << "-layout" << layout;
+    if ( !layout.isEmpty() && !variant.isEmpty() )
         r << "-variant" << variant;
     return r;
 }
 
+void
+KeyboardPage::applyXkbmap()
+{
+    if ( m_setxkbmapWatcher.isRunning() )
+    {
+        m_setxkbmapPending = true;
+        return;
+    }
+    m_setxkbmapPending = false;
+
+    const QString model = m_models.value( ui->comboBoxModel->currentText(), "pc105" );
+    const QStringList args = xkbmap_args( model, m_selectedLayout, m_selectedVariant );
+    m_setxkbmapWatcher.setFuture( QtConcurrent::run( [args] { QProcess::execute( "setxkbmap", args ); } ) );
+    cDebug() << "xkbmap selection changed to: " << model << m_selectedLayout << '-' << m_selectedVariant;
+}
+
 void
 KeyboardPage::onListVariantCurrentItemChanged( QListWidgetItem* current, QListWidgetItem* previous )
 {
@@ -473,22 +555,9 @@ KeyboardPage::onListVariantCurrentItemChanged( QListWidgetItem* current, QListWi
 
     //emit checkReady();
 
-    // Set Xorg keyboard layout
-    if ( m_setxkbmapTimer.isActive() )
-    {
-        m_setxkbmapTimer.stop();
-        m_setxkbmapTimer.disconnect( this );
-    }
-
-    connect( &m_setxkbmapTimer, &QTimer::timeout,
-             this, [=]
-    {
-        QProcess::execute( "setxkbmap", xkbmap_args( layout, variant ) );
-        cDebug() << "xkbmap selection changed to: " << layout << '-' << variant;
-        m_setxkbmapTimer.disconnect( this );
-    } );
-    m_setxkbmapTimer.start( QApplication::keyboardInputInterval() );
-
     m_selectedLayout = layout;
     m_selectedVariant = variant;
+
+    // Set Xorg keyboard layout, once the user stops scrolling
+    m_setxkbmapTimer.start( QApplication::keyboardInputInterval() );
 }
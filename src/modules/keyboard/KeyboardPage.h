@@ -26,6 +26,9 @@
 
 #include "Job.h"
 
+#include "KeyboardLayoutModel.h"
+
+#include <QFutureWatcher>
 #include <QListWidgetItem>
 #include <QTimer>
 #include <QWidget>
@@ -37,6 +40,19 @@ class Page_Keyboard;
 
 class KeyBoardPreview;
 
+/** @brief Keyboard data that is loaded in the background
+ *
+ * This is the xkb database plus the layout that is currently
+ * active in X (from `setxkbmap -print`).
+ */
+struct KeyboardData
+{
+    KeyboardLayoutModel::LayoutList layouts;
+    KeyboardGlobal::ModelsMap models;
+    QString currentLayout;
+    QString currentVariant;
+};
+
 class KeyboardPage : public QWidget
 {
     Q_OBJECT
@@ -44,6 +60,11 @@ public:
     explicit KeyboardPage( QWidget* parent = nullptr );
     virtual ~KeyboardPage();
 
+    /** @brief Starts loading layouts and models
+     *
+     * This returns immediately; the page is filled in when the
+     * data has been loaded in the background.
+     */
     void init();
 
     QString prettyStatus() const;
@@ -62,19 +83,35 @@ protected slots:
                                           QListWidgetItem* previous );
 
 private:
+    /// Fills in the page once the KeyboardData has been loaded
+    void onKeyboardDataLoaded();
     /// Guess a layout based on the split-apart locale
     void guessLayout( const QStringList& langParts );
     void updateVariants( const QPersistentModelIndex& currentItem,
                          QString currentVariant = QString() );
+    /** @brief Applies the selected model, layout and variant to X
+     *
+     * Runs setxkbmap in a worker thread; while one is running,
+     * further requests are collapsed into a single follow-up run
+     * with whatever is selected at that time.
+     */
+    void applyXkbmap();
 
     Ui::Page_Keyboard* ui;
     KeyBoardPreview* m_keyboardPreview;
+    KeyboardLayoutModel* m_layoutModel;
     int m_defaultIndex;
     QMap< QString, QString > m_models;
 
+    QFutureWatcher< KeyboardData > m_loadWatcher;
+    /// Locale parts from onActivate() that arrived before the data did
+    QStringList m_pendingLangParts;
+
     QString m_selectedLayout;
     QString m_selectedVariant;
     QTimer m_setxkbmapTimer;
+    QFutureWatcher< void > m_setxkbmapWatcher;
+    bool m_setxkbmapPending;
 };
 
 #endif // KEYBOARDPAGE_H
@@ -27,12 +27,21 @@
 
 #include "utils/Logger.h"
 
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
 #ifdef Q_OS_FREEBSD
 static const char XKB_FILE[] = "/usr/local/share/X11/xkb/rules/base.lst";
 #else
 static const char XKB_FILE[] = "/usr/share/X11/xkb/rules/base.lst";
 #endif
 
+/// Bump this when the layout of the database file changes
+static const quint32 DATABASE_VERSION = 1;
+
 // The xkb rules file is made of several "sections". Each section
 // starts with a line "! <sectionname>". The static methods here
 // handle individual sections.
@@ -54,6 +63,9 @@ static bool findSection( QFile& fh, const char* name )
     return false;
 }
 
+/* The parse*() functions produce untranslated data, suitable
+ * for caching; see translateDatabase() for the rest.
+ */
 static KeyboardGlobal::ModelsMap parseKeyboardModels( const char* filepath )
 {
     KeyboardGlobal::ModelsMap models;
@@ -84,13 +96,7 @@ static KeyboardGlobal::ModelsMap parseKeyboardModels( const char* filepath )
         // insert into the model map
         if ( rx.indexIn( line ) != -1 )
         {
-            QString modelDesc = rx.cap( 2 );
-            QString model = rx.cap( 1 );
-
-            if ( model == "pc105" )
-                modelDesc += "  -  " + QObject::tr( "Default Keyboard Model" );
-
-            models.insert( modelDesc, model );
+            models.insert( rx.cap( 2 ), rx.cap( 1 ) );
         }
     }
 
@@ -98,7 +104,7 @@ static KeyboardGlobal::ModelsMap parseKeyboardModels( const char* filepath )
 }
 
 
-KeyboardGlobal::LayoutsMap parseKeyboardLayouts( const char* filepath )
+static KeyboardGlobal::LayoutsMap parseKeyboardLayouts( const char* filepath )
 {
     KeyboardGlobal::LayoutsMap layouts;
 
@@ -130,7 +136,6 @@ KeyboardGlobal::LayoutsMap parseKeyboardLayouts( const char* filepath )
         {
             KeyboardGlobal::KeyboardInfo info;
             info.description = rx.cap( 2 );
-            info.variants.insert( QObject::tr( "Default" ), "" );
             layouts.insert( rx.cap( 1 ), info );
         }
     }
@@ -165,7 +170,6 @@ KeyboardGlobal::LayoutsMap parseKeyboardLayouts( const char* filepath )
                 // create a new map in the multimap - the value was not found.
                 KeyboardGlobal::KeyboardInfo info;
                 info.description = rx.cap( 2 );
-                info.variants.insert( QObject::tr( "Default" ), "" );
                 info.variants.insert( rx.cap( 3 ), rx.cap( 1 ) );
                 layouts.insert( rx.cap( 2 ), info );
             }
@@ -176,14 +180,115 @@ KeyboardGlobal::LayoutsMap parseKeyboardLayouts( const char* filepath )
 }
 
 
+static QDataStream& operator<<( QDataStream& out, const KeyboardGlobal::KeyboardInfo& info )
+{
+    return out << info.description << info.variants;
+}
+
+
+static QDataStream& operator>>( QDataStream& in, KeyboardGlobal::KeyboardInfo& info )
+{
+    return in >> info.description >> info.variants;
+}
+
+
+static QString databaseFile()
+{
+    return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + QStringLiteral( "/xkb-layouts.db" );
+}
+
+
+/** @brief Reads the cached database, if it matches @p rules
+ *
+ * The cache is keyed on the size and modification time of the
+ * rules file; returns false if there is no usable cache.
+ */
+static bool readDatabase( const QFileInfo& rules, KeyboardGlobal::Database& db )
+{
+    QFile fh( databaseFile() );
+    if ( !fh.open( QIODevice::ReadOnly ) )
+        return false;
+
+    QDataStream in( &fh );
+    in.setVersion( QDataStream::Qt_5_9 );
+
+    quint32 version = 0;
+    qint64 size = -1;
+    QDateTime modified;
+    in >> version >> size >> modified;
+    if ( in.status() != QDataStream::Ok || version != DATABASE_VERSION
+         || size != rules.size() || modified != rules.lastModified() )
+        return false;
+
+    in >> db.layouts >> db.models;
+    return in.status() == QDataStream::Ok && !db.layouts.isEmpty();
+}
+
+
+static void writeDatabase( const QFileInfo& rules, const KeyboardGlobal::Database& db )
+{
+    if ( !QDir().mkpath( QFileInfo( databaseFile() ).absolutePath() ) )
+        return;
+
+    QSaveFile fh( databaseFile() );
+    if ( !fh.open( QIODevice::WriteOnly ) )
+        return;
+
+    QDataStream out( &fh );
+    out.setVersion( QDataStream::Qt_5_9 );
+    out << DATABASE_VERSION << rules.size() << rules.lastModified();
+    out << db.layouts << db.models;
+    if ( !fh.commit() )
+        cWarning() << "Could not write keyboard layout cache" << fh.fileName();
+}
+
+
+/// Adds the translated bits that are not stored in the cache
+static void translateDatabase( KeyboardGlobal::Database& db )
+{
+    for ( auto it = db.layouts.begin(); it != db.layouts.end(); ++it )
+        it.value().variants.insert( QObject::tr( "Default" ), "" );
+
+    for ( auto it = db.models.begin(); it != db.models.end(); ++it )
+    {
+        if ( it.value() == "pc105" )
+        {
+            QString model = it.value();
+            QString modelDesc = it.key() + "  -  " + QObject::tr( "Default Keyboard Model" );
+            db.models.erase( it );
+            db.models.insert( modelDesc, model );
+            break;
+        }
+    }
+}
+
+
+KeyboardGlobal::Database KeyboardGlobal::getDatabase()
+{
+    Database db;
+    QFileInfo rules( XKB_FILE );
+
+    if ( !readDatabase( rules, db ) )
+    {
+        db.layouts = parseKeyboardLayouts( XKB_FILE );
+        db.models = parseKeyboardModels( XKB_FILE );
+        if ( !db.layouts.isEmpty() )
+            writeDatabase( rules, db );
+    }
+
+    translateDatabase( db );
+    return db;
+}
+
+
 KeyboardGlobal::LayoutsMap KeyboardGlobal::getKeyboardLayouts()
 {
-    return parseKeyboardLayouts( XKB_FILE );
+    return getDatabase().layouts;
 }
 
 
 KeyboardGlobal::ModelsMap KeyboardGlobal::getKeyboardModels()
 {
-    return parseKeyboardModels( XKB_FILE );
+    return getDatabase().models;
 }
 
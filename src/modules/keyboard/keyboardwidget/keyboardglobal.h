@@ -46,6 +46,19 @@ public:
     using LayoutsMap = QMap< QString, KeyboardInfo >;
     using ModelsMap = QMap< QString, QString >;
 
+    /** @brief Everything that is read from the xkb rules file
+     *
+     * Parsing the rules file is slow-ish, so the parsed data is
+     * kept in the cache directory and re-used as long as the
+     * rules file does not change. Loading the database is
+     * thread-safe, so it can be done in the background.
+     */
+    struct Database {
+        LayoutsMap layouts;
+        ModelsMap models;
+    };
+
+    static Database getDatabase();
     static LayoutsMap getKeyboardLayouts();
     static ModelsMap getKeyboardModels();
 };
@@ -24,6 +24,12 @@
 #include "utils/Logger.h"
 #include "keyboardpreview.h"
 
+#include <QApplication>
+#include <QDir>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+
 KeyBoardPreview::KeyBoardPreview( QWidget* parent )
     : QWidget( parent )
     , layout( "us" )
@@ -59,6 +65,10 @@ KeyBoardPreview::KeyBoardPreview( QWidget* parent )
     kbList[KB_106].keys.append(QList<int>() << 0x2c << 0x2d << 0x2e << 0x2f << 0x30 << 0x31 << 0x32 << 0x33 << 0x34 << 0x35 << 0x36);
 
     kb = &kbList[KB_104];
+
+    loadTimer.setSingleShot(true);
+    connect(&loadTimer, &QTimer::timeout, this, &KeyBoardPreview::requestCodes);
+    connect(&loadWatcher, &QFutureWatcher<CodeList>::finished, this, &KeyBoardPreview::codesLoaded);
 }
 
 
@@ -72,11 +82,20 @@ void KeyBoardPreview::setLayout(QString _layout) {
 void KeyBoardPreview::setVariant(QString _variant) {
     variant = _variant;
 
-    if (!loadCodes())
+    loadInfo();
+
+    // A layout we have seen before can be shown right away; otherwise
+    // wait until the user stops scrolling through the list before
+    // running ckbcomp in the background.
+    auto it = codeCache.constFind(cacheKey(layout, variant));
+    if (it != codeCache.constEnd()) {
+        loadTimer.stop();
+        codes = it.value();
+        update();
         return;
+    }
 
-    loadInfo();
-    repaint();
+    loadTimer.start(QApplication::keyboardInputInterval());
 }
 
 
@@ -101,9 +120,67 @@ void KeyBoardPreview::loadInfo() {
 
 
 
-bool KeyBoardPreview::loadCodes() {
+void KeyBoardPreview::requestCodes() {
     if (layout.isEmpty())
-        return false;
+        return;
+
+    // Only one ckbcomp at a time; when it finishes, codesLoaded()
+    // notices that the selection moved on and asks again.
+    if (loadWatcher.isRunning())
+        return;
+
+    loadingKey = cacheKey(layout, variant);
+    loadWatcher.setFuture(QtConcurrent::run(&KeyBoardPreview::loadCodes, layout, variant));
+}
+
+
+
+void KeyBoardPreview::codesLoaded() {
+    const CodeList loaded = loadWatcher.result();
+    if (!loaded.isEmpty())
+        codeCache.insert(loadingKey, loaded);
+
+    const QString wantedKey = cacheKey(layout, variant);
+    if (loadingKey != wantedKey) {
+        // Stale result; the current selection is either cached by
+        // now or still needs loading.
+        auto it = codeCache.constFind(wantedKey);
+        if (it != codeCache.constEnd()) {
+            codes = it.value();
+            update();
+        }
+        else if (!loadTimer.isActive())
+            requestCodes();
+        return;
+    }
+
+    if (loaded.isEmpty())
+        return;
+
+    codes = loaded;
+    update();
+}
+
+
+
+QString KeyBoardPreview::cacheKey(const QString& layout, const QString& variant) {
+    return variant.isEmpty() ? layout : QString("%1(%2)").arg(layout, variant);
+}
+
+
+
+KeyBoardPreview::CodeList KeyBoardPreview::loadCodes(const QString& layout, const QString& variant) {
+    // ckbcomp output depends only on the layout and variant (the model
+    // is fixed below), so it is kept across sessions in the cache dir.
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/keyboard-preview");
+    const QString cacheFile = cacheDir + '/' + cacheKey(layout, variant) + QStringLiteral(".ckbcomp");
+
+    QFile cached(cacheFile);
+    if (cached.open(QIODevice::ReadOnly)) {
+        CodeList codes = parseCodes(cached.readAll());
+        if (!codes.isEmpty())
+            return codes;
+    }
 
     QStringList param;
     param << "-model" << "pc106" << "-layout" << layout << "-compact";
@@ -117,19 +194,35 @@ bool KeyBoardPreview::loadCodes() {
     if (!process.waitForStarted())
     {
         cWarning() << "ckbcomp not found , keyboard preview disabled";
-        return false;
+        return CodeList();
     }
 
     if (!process.waitForFinished())
     {
         cWarning() << "ckbcomp failed, keyboard preview disabled";
-        return false;
+        return CodeList();
+    }
+
+    const QByteArray output = process.readAll();
+    CodeList codes = parseCodes(output);
+
+    if (!codes.isEmpty() && QDir().mkpath(cacheDir)) {
+        QSaveFile f(cacheFile);
+        if (f.open(QIODevice::WriteOnly)) {
+            f.write(output);
+            f.commit();
+        }
     }
 
-    // Clear codes
-    codes.clear();
+    return codes;
+}
+
+
+
+KeyBoardPreview::CodeList KeyBoardPreview::parseCodes(const QByteArray& ckbcompOutput) {
+    CodeList codes;
 
-    const QStringList list = QString(process.readAll()).split("\n", QString::SkipEmptyParts);
+    const QStringList list = QString(ckbcompOutput).split("\n", QString::SkipEmptyParts);
 
     for (const QString &line : list) {
         if (!line.startsWith("keycode") || !line.contains('='))
@@ -154,7 +247,7 @@ bool KeyBoardPreview::loadCodes() {
         codes.append(code);
     }
 
-    return true;
+    return codes;
 }
 
 
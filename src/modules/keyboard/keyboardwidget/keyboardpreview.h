@@ -26,6 +26,8 @@
 #include <QWidget>
 #include <QRectF>
 #include <QFont>
+#include <QFutureWatcher>
+#include <QHash>
 #include <QPainter>
 #include <QPen>
 #include <QPainterPath>
@@ -34,6 +36,7 @@
 #include <QProcess>
 #include <QString>
 #include <QStringList>
+#include <QTimer>
 
 
 class KeyBoardPreview : public QWidget
@@ -56,20 +59,43 @@ private:
     struct Code {
         QString plain, shift, ctrl, alt;
     };
+    using CodeList = QList<Code>;
 
     QString layout, variant;
     QFont lowerFont, upperFont;
     KB* kb, kbList[3];
-    QList<Code> codes;
+    CodeList codes;
     int space, usable_width, key_w;
 
+    /** @brief Parsed keymaps, keyed by cacheKey()
+     *
+     * Only touched from the UI thread; the worker thread keeps
+     * its own on-disk cache (see loadCodes()).
+     */
+    QHash<QString, CodeList> codeCache;
+    /// Debounces ckbcomp runs while the user scrolls through layouts
+    QTimer loadTimer;
+    QFutureWatcher<CodeList> loadWatcher;
+    /// The cacheKey() that the running loadWatcher is working on
+    QString loadingKey;
+
     void loadInfo();
-    bool loadCodes();
+    void requestCodes();
+    void codesLoaded();
     QString regular_text(int index);
     QString shift_text(int index);
     QString ctrl_text(int index);
     QString alt_text(int index);
-    QString fromUnicodeString(QString raw);
+
+    static QString cacheKey(const QString& layout, const QString& variant);
+    /** @brief Runs ckbcomp (or consults the disk cache) for a keymap
+     *
+     * This is run in a worker thread, so it must not touch any
+     * member variables. An empty list means ckbcomp failed.
+     */
+    static CodeList loadCodes(const QString& layout, const QString& variant);
+    static CodeList parseCodes(const QByteArray& ckbcompOutput);
+    static QString fromUnicodeString(QString raw);
 
 protected:
     void paintEvent(QPaintEvent* event);
@@ -25,6 +25,9 @@
 import os
 import re
 import shutil
+import subprocess
+
+from concurrent.futures import ThreadPoolExecutor
 
 import libcalamares
 
@@ -75,6 +78,10 @@ def rewrite_locale_gen(srcfilename, destfilename, locale_conf):
     Copies a locale.gen file from @p srcfilename to @p destfilename
     (this may be the same name), enabling those locales that can
     be found in the map @p locale_conf. Also always enables en_US.UTF-8.
+
+    Returns a dict of the selected locales that are available (enabled
+    by this function or already enabled in the file), mapping each
+    locale to its charmap.
     """
     en_us_locale = 'en_US.UTF-8'
 
@@ -89,6 +96,7 @@ def rewrite_locale_gen(srcfilename, destfilename, locale_conf):
 
     enabled_locales = {}
     seen_locales = set()
+    selected_locales = {}
 
     # Write source out again, enabling some
     with open(destfilename, "w") as gen:
@@ -100,10 +108,11 @@ def rewrite_locale_gen(srcfilename, destfilename, locale_conf):
             # may be enabled if they match a desired locale
             if not c:
                 seen_locales.add(locale)
-            else:
-                for locale_value in locale_values:
-                    if locale.startswith(locale_value):
+            for locale_value in locale_values:
+                if locale and locale.startswith(locale_value):
+                    if c:
                         enabled_locales[locale] = uncommented
+                    selected_locales[locale] = uncommented.split()[1]
             gen.write(line)
 
         gen.write("\n###\n#\n# Locales enabled by Calamares\n")
@@ -116,12 +125,140 @@ def rewrite_locale_gen(srcfilename, destfilename, locale_conf):
             if locale not in seen_locales:
                 gen.write("# Missing: %s\n" % locale)
 
+    return selected_locales
+
+
+def normalize_locale_name(locale):
+    """
+    Returns the name glibc uses for @p locale in the locale archive:
+    the codeset is lower-cased and stripped of punctuation, so
+    "de_DE.UTF-8@euro" becomes "de_DE.utf8@euro".
+    """
+    name, at, modifier = locale.partition("@")
+    language, dot, codeset = name.partition(".")
+    if dot:
+        codeset = "".join(c for c in codeset.lower() if c.isalnum())
+    return language + dot + codeset + at + modifier
+
+
+def localedef_input(locale):
+    """
+    Returns the locale source (in /usr/share/i18n/locales) for
+    @p locale, which is the name without its codeset; this is
+    how locale-gen picks the input for localedef.
+    """
+    name, at, modifier = locale.partition("@")
+    return name.partition(".")[0] + at + modifier
+
+
+def archived_locales(root):
+    """
+    Returns the set of locales (normalized names) in the locale archive
+    of the system at @p root, or an empty set if it can't be listed.
+    """
+    command = ["localedef", "--list-archive"]
+    if root != "/":
+        command = ["chroot", root] + command
+    try:
+        output = subprocess.check_output(command, stderr=subprocess.DEVNULL,
+                                         universal_newlines=True)
+    except (OSError, subprocess.CalledProcessError):
+        return set()
+    return set(output.split())
+
+
+def libc_version(root):
+    """
+    Returns the GNU libc version of the system at @p root, or None.
+    """
+    command = ["getconf", "GNU_LIBC_VERSION"]
+    if root != "/":
+        command = ["chroot", root] + command
+    try:
+        return subprocess.check_output(command, stderr=subprocess.DEVNULL,
+                                       universal_newlines=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+LOCALE_ARCHIVE = "usr/lib/locale/locale-archive"
+
+def reuse_live_archive(root, locales):
+    """
+    Copies the locale archive of the live system into the target
+    system at @p root, if it contains all of @p locales (normalized
+    names) and both systems have the same libc: the archive format
+    is specific to the libc that wrote it. Returns True if the
+    archive was copied.
+    """
+    live_archive = "/" + LOCALE_ARCHIVE
+    if not os.path.exists(live_archive):
+        return False
+    missing = locales - archived_locales("/")
+    if missing:
+        libcalamares.utils.debug("Live locale archive lacks {!s}".format(", ".join(sorted(missing))))
+        return False
+    live_libc = libc_version("/")
+    if live_libc is None or live_libc != libc_version(root):
+        libcalamares.utils.debug("Live and target libc differ, not reusing the locale archive")
+        return False
+
+    target_archive = os.path.join(root, LOCALE_ARCHIVE)
+    os.makedirs(os.path.dirname(target_archive), exist_ok=True)
+    shutil.copy2(live_archive, target_archive)
+    libcalamares.utils.debug("Reused live locale archive for {!s}".format(", ".join(sorted(locales))))
+    return True
+
+
+def compile_locales(root, selected_locales, reuse_live):
+    """
+    Compiles only the locales in @p selected_locales (a dict mapping
+    locale to charmap, as returned by rewrite_locale_gen()) into the
+    locale archive of the target system at @p root. Locales already
+    in the target archive are skipped; the others are compiled in
+    parallel, one localedef per locale (localedef locks the archive
+    while adding to it). With @p reuse_live, the live system's archive
+    is copied instead, when it has everything that is needed.
+
+    Returns a list of the locales that failed to compile.
+    """
+    wanted = {normalize_locale_name(l): l for l in selected_locales}
+    present = archived_locales(root)
+    missing = {n: l for n, l in wanted.items() if n not in present}
+    if not missing:
+        libcalamares.utils.debug("All selected locales are already compiled")
+        return []
+    if reuse_live and reuse_live_archive(root, set(wanted.keys())):
+        return []
+
+    def localedef(locale):
+        command = ["localedef", "-i", localedef_input(locale), "-c",
+                   "-f", selected_locales[locale],
+                   "-A", "/usr/share/locale/locale.alias", locale]
+        if root != "/":
+            command = ["chroot", root] + command
+        libcalamares.utils.debug("Compiling locale {!s}".format(locale))
+        r = subprocess.run(command, stdout=subprocess.PIPE,
+                           stderr=subprocess.STDOUT, universal_newlines=True)
+        if r.returncode != 0:
+            libcalamares.utils.debug("localedef {!s}: {!s}".format(locale, r.stdout.strip()))
+
+    with ThreadPoolExecutor(max_workers=os.cpu_count() or 1) as pool:
+        list(pool.map(localedef, sorted(missing.values())))
+
+    # With -c, localedef exits with 1 for warnings and errors alike,
+    # so check the archive to see which locales made it.
+    present = archived_locales(root)
+    return sorted(l for n, l in missing.items() if n not in present)
+
 
 def run():
     """ Create locale """
     import libcalamares
 
     locale_conf = libcalamares.globalstorage.value("localeConf")
+    generate = libcalamares.job.configuration.get("localeGen", "locale-gen")
+    reuse_live = libcalamares.job.configuration.get("reuseLiveArchive", False)
 
     if not locale_conf:
         locale_conf = {
@@ -159,8 +296,14 @@ def run():
     # if the live system has locale.gen, but the target does not:
     # in that case, fix your installation filesystem.
     if os.path.exists('/etc/locale.gen'):
-        rewrite_locale_gen(target_locale_gen, target_locale_gen, locale_conf)
-        libcalamares.utils.target_env_call(['locale-gen'])
+        selected_locales = rewrite_locale_gen(target_locale_gen, target_locale_gen, locale_conf)
+        if generate == "selected":
+            failed = compile_locales(install_path, selected_locales, reuse_live)
+            if failed:
+                return (_("Could not generate locales."),
+                        _("localedef failed for {!s}.").format(", ".join(failed)))
+        else:
+            libcalamares.utils.target_env_call(['locale-gen'])
         libcalamares.utils.debug('{!s} done'.format(target_locale_gen))
 
     # write /etc/locale.conf
@@ -19,6 +19,7 @@
 #include "LuksBootKeyFileJob.h"
 
 #include "utils/CalamaresUtilsSystem.h"
+#include "utils/Initramfs.h"
 #include "utils/Logger.h"
 #include "utils/UMask.h"
 #include "utils/Variant.h"
@@ -208,6 +209,8 @@ LuksBootKeyFileJob::exec()
                 tr( "Could not configure LUKS key file on partition %1." ).arg( d.device ) );
     }
 
+    // The keyfile goes into the initramfs
+    CalamaresUtils::Initramfs::requestRegeneration( QStringLiteral( "luksbootkeyfile" ) );
     return Calamares::JobResult::ok();
 }
 
@@ -0,0 +1,331 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MountJob.h"
+
+#include "GlobalStorage.h"
+#include "JobQueue.h"
+#include "partition/Mount.h"
+#include "utils/CalamaresUtilsSystem.h"
+#include "utils/Logger.h"
+#include "utils/Trace.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <linux/btrfs.h>
+#include <sys/ioctl.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+#endif
+
+MountJob::MountJob( QObject* parent )
+    : Calamares::CppJob( parent )
+{
+}
+
+MountJob::~MountJob() {}
+
+QString
+MountJob::prettyName() const
+{
+    return tr( "Mounting partitions." );
+}
+
+QString
+MountJob::Entry::mountOptions() const
+{
+    QStringList o;
+    if ( !subvolume.isEmpty() )
+    {
+        o.append( QStringLiteral( "subvol=" ) + subvolume );
+    }
+    if ( !options.isEmpty() )
+    {
+        o.append( options );
+    }
+    return o.join( ',' );
+}
+
+QList< MountJob::EntryList >
+MountJob::plan( const QVariantList& partitions, const QVariantList& extraMounts )
+{
+    const bool hasHome = std::any_of( partitions.cbegin(), partitions.cend(), []( const QVariant& p ) {
+        return p.toMap().value( "mountPoint" ).toString() == QStringLiteral( "/home" );
+    } );
+
+    std::map< int, EntryList > levels;
+    for ( const QVariant& v : partitions + extraMounts )
+    {
+        const QVariantMap m = v.toMap();
+        Entry e;
+        e.mountPoint = m.value( "mountPoint" ).toString();
+        if ( e.mountPoint.isEmpty() )
+        {
+            continue;
+        }
+        e.fs = m.value( "fs" ).toString().toLower();
+        if ( e.fs == QStringLiteral( "fat16" ) || e.fs == QStringLiteral( "fat32" ) )
+        {
+            e.fs = QStringLiteral( "vfat" );
+        }
+        e.options = m.value( "options" ).toString();
+        e.device = m.contains( "luksMapperName" )
+            ? QStringLiteral( "/dev/mapper/" ) + m.value( "luksMapperName" ).toString()
+            : m.value( "device" ).toString();
+
+        if ( e.fs == QStringLiteral( "btrfs" ) && e.mountPoint == QStringLiteral( "/" ) )
+        {
+            e.subvolume = QStringLiteral( "@" );
+            e.createSubvolumes.append( e.subvolume );
+            if ( !hasHome )
+            {
+                e.createSubvolumes.append( QStringLiteral( "@home" ) );
+
+                Entry home = e;
+                home.mountPoint = QStringLiteral( "/home" );
+                home.subvolume = QStringLiteral( "@home" );
+                home.createSubvolumes.clear();
+                levels[ 1 ].append( home );
+            }
+        }
+        levels[ CalamaresUtils::Partition::mountPointDepth( e.mountPoint ) ].append( e );
+    }
+
+    QList< EntryList > l;
+    for ( auto& level : levels )
+    {
+        std::stable_sort( level.second.begin(), level.second.end(), []( const Entry& a, const Entry& b ) {
+            return a.mountPoint < b.mountPoint;
+        } );
+        l.append( level.second );
+    }
+    return l;
+}
+
+/// @brief Give @p target the SELinux context of @p reference (like chcon --reference)
+static void
+copySecurityContext( const QString& reference, const QString& target )
+{
+#ifdef Q_OS_LINUX
+    static const char attribute[] = "security.selinux";
+    char context[ 256 ];
+    ssize_t size = ::lgetxattr( QFile::encodeName( reference ).constData(), attribute, context, sizeof( context ) );
+    if ( size > 0
+         && ::lsetxattr( QFile::encodeName( target ).constData(), attribute, context, static_cast< size_t >( size ), 0 )
+             != 0 )
+    {
+        cDebug() << "Could not set SELinux context of" << target << strerror( errno );
+    }
+#else
+    Q_UNUSED( reference )
+    Q_UNUSED( target )
+#endif
+}
+
+/// @brief Create btrfs subvolume @p name in the mounted filesystem at @p mountPoint; returns an errno value
+static int
+createSubvolume( const QString& mountPoint, const QString& name )
+{
+#ifdef Q_OS_LINUX
+    int fd = ::open( QFile::encodeName( mountPoint ).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+    if ( fd < 0 )
+    {
+        return errno;
+    }
+    struct btrfs_ioctl_vol_args args;
+    memset( &args, 0, sizeof( args ) );
+    strncpy( args.name, QFile::encodeName( name ).constData(), BTRFS_PATH_NAME_MAX );
+    int r = ::ioctl( fd, BTRFS_IOC_SUBVOL_CREATE, &args ) == 0 ? 0 : errno;
+    ::close( fd );
+    return r;
+#else
+    auto r = CalamaresUtils::System::runCommand( { "btrfs", "subvolume", "create", mountPoint + '/' + name },
+                                                 std::chrono::seconds( 10 ) );
+    return r.getExitCode() ? EIO : 0;
+#endif
+}
+
+static QString
+errorString( int error )
+{
+    return QString::fromLocal8Bit( strerror( error ) );
+}
+
+QString
+MountJob::mountEntry( const QString& root, const Entry& entry )
+{
+    using namespace CalamaresUtils::Partition;
+
+    CalamaresUtils::Trace::Span span( "mount", entry.mountPoint );
+    // mountPoint starts with a /
+    const QString target = root + entry.mountPoint;
+    if ( !QDir().mkpath( target ) )
+    {
+        return tr( "Could not create the directory %1." ).arg( target );
+    }
+    copySecurityContext( entry.mountPoint, target );
+
+    if ( !entry.createSubvolumes.isEmpty() )
+    {
+        int r = mountNative( entry.device, target, entry.fs, entry.options );
+        if ( r )
+        {
+            return tr( "Could not mount %1 on %2: %3" ).arg( entry.device, target, errorString( r ) );
+        }
+        for ( const QString& subvolume : entry.createSubvolumes )
+        {
+            r = createSubvolume( target, subvolume );
+            if ( r )
+            {
+                unmountNative( target );
+                return tr( "Could not create btrfs subvolume %1 on %2: %3" )
+                    .arg( subvolume, entry.device, errorString( r ) );
+            }
+        }
+        r = unmountNative( target, false );
+        if ( r )
+        {
+            return tr( "Could not unmount %1: %2" ).arg( target, errorString( r ) );
+        }
+    }
+
+    int r = mountNative( entry.device, target, entry.fs, entry.mountOptions() );
+    if ( r )
+    {
+        return tr( "Could not mount %1 (type %2, options %3) on %4: %5" )
+            .arg( entry.device,
+                  entry.fs.isEmpty() ? QStringLiteral( "auto" ) : entry.fs,
+                  entry.mountOptions().isEmpty() ? QStringLiteral( "defaults" ) : entry.mountOptions(),
+                  target,
+                  errorString( r ) );
+    }
+    return QString();
+}
+
+Calamares::JobResult
+MountJob::exec()
+{
+    Calamares::GlobalStorage* gs = Calamares::JobQueue::instance()->globalStorage();
+    const QVariantList partitions = gs->value( "partitions" ).toList();
+    if ( partitions.isEmpty() )
+    {
+        cWarning() << "No partitions to mount.";
+        return Calamares::JobResult::error( tr( "Configuration Error" ),
+                                            tr( "No partitions are defined for <pre>%1</pre> to use." ).arg( "mount" ) );
+    }
+
+    QTemporaryDir rootDir( QDir::tempPath() + QStringLiteral( "/calamares-root-XXXXXX" ) );
+    if ( !rootDir.isValid() )
+    {
+        return Calamares::JobResult::error( tr( "Could not create a directory to mount the target system on." ),
+                                            rootDir.errorString() );
+    }
+    rootDir.setAutoRemove( false );
+    const QString root = rootDir.path();
+
+    QVariantList extraMounts = m_extraMounts;
+    if ( gs->value( "firmwareType" ).toString() == QStringLiteral( "efi" ) )
+    {
+        extraMounts.append( m_extraMountsEfi );
+    }
+
+    const auto levels = plan( partitions, extraMounts );
+    const int total = std::accumulate(
+        levels.cbegin(), levels.cend(), 0, []( int n, const EntryList& l ) { return n + l.count(); } );
+    int done = 0;
+    for ( const auto& level : levels )
+    {
+        // Entries for the same mount point stack on each other, so they
+        // are done one after the other in a single task.
+        std::map< QString, EntryList > byMountPoint;
+        for ( const auto& e : level )
+        {
+            byMountPoint[ e.mountPoint ].append( e );
+        }
+
+        QList< QFuture< QString > > running;
+        for ( const auto& entries : byMountPoint )
+        {
+            const EntryList l = entries.second;
+            running.append( QtConcurrent::run( [root, l]() {
+                for ( const auto& e : l )
+                {
+                    QString error = mountEntry( root, e );
+                    if ( !error.isEmpty() )
+                    {
+                        return error;
+                    }
+                }
+                return QString();
+            } ) );
+        }
+
+        QStringList errors;
+        for ( auto& f : running )
+        {
+            f.waitForFinished();
+            if ( !f.result().isEmpty() )
+            {
+                errors.append( f.result() );
+            }
+        }
+        if ( !errors.isEmpty() )
+        {
+            cError() << "Mounting the target system failed:" << errors;
+            const QStringList unmountErrors = CalamaresUtils::Partition::unmountTree( root );
+            if ( unmountErrors.isEmpty() )
+            {
+                QDir().rmdir( root );
+            }
+            return Calamares::JobResult::error( tr( "Could not mount the target system." ),
+                                                ( errors + unmountErrors ).join( '\n' ) );
+        }
+
+        done += level.count();
+        emit progress( qreal( done ) / qreal( total ) );
+    }
+
+    cDebug() << "Mounted" << total << "filesystems on" << root;
+    gs->insert( "rootMountPoint", root );
+    // Remember the extra mounts for the unpackfs module
+    gs->insert( "extraMounts", extraMounts );
+    return Calamares::JobResult::ok();
+}
+
+void
+MountJob::setConfigurationMap( const QVariantMap& configurationMap )
+{
+    m_extraMounts = configurationMap.value( "extraMounts" ).toList();
+    m_extraMountsEfi = configurationMap.value( "extraMountsEfi" ).toList();
+    if ( m_extraMounts.isEmpty() && m_extraMountsEfi.isEmpty() )
+    {
+        cWarning() << "No extra mounts defined. Does mount.conf exist?";
+    }
+}
+
+CALAMARES_PLUGIN_FACTORY_DEFINITION( MountJobFactory, registerPlugin< MountJob >(); )
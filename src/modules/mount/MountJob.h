@@ -0,0 +1,93 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MOUNTJOB_H
+#define MOUNTJOB_H
+
+#include "CppJob.h"
+#include "DllMacro.h"
+#include "utils/PluginFactory.h"
+
+#include <QObject>
+#include <QStringList>
+#include <QVariantList>
+#include <QVariantMap>
+
+/** @brief Mounts the target system's filesystems
+ *
+ * Mounts the partitions from GlobalStorage (set up by the *partition*
+ * module) and the extra mounts from the configuration (API filesystems
+ * like /proc and /dev) under a new temporary root. This root is stored
+ * in GlobalStorage as *rootMountPoint*.
+ *
+ * The mount(2) system call is used directly. The mount tree is planned
+ * once: parents are mounted before their children, and mounts that do
+ * not depend on each other (e.g. /proc, /sys, /dev and /boot) are done
+ * in parallel. If a mount fails, everything already mounted is
+ * unmounted again.
+ */
+class PLUGINDLLEXPORT MountJob : public Calamares::CppJob
+{
+    Q_OBJECT
+
+public:
+    /// @brief One filesystem to mount; the mount point is relative to the target root
+    struct Entry
+    {
+        QString device;
+        QString mountPoint;
+        QString fs;
+        QString options;  ///< As configured
+        QString subvolume;  ///< btrfs subvolume to mount, if any
+        QStringList createSubvolumes;  ///< btrfs subvolumes to create before mounting
+
+        /// @brief Options for mount(2), including the subvolume
+        QString mountOptions() const;
+    };
+    using EntryList = QList< Entry >;
+
+    explicit MountJob( QObject* parent = nullptr );
+    ~MountJob() override;
+
+    QString prettyName() const override;
+
+    Calamares::JobResult exec() override;
+
+    void setConfigurationMap( const QVariantMap& configurationMap ) override;
+
+    /** @brief Plan the mounts for @p partitions and @p extraMounts
+     *
+     * Entries without a mount point (e.g. swap) are skipped. The entries
+     * are grouped by the depth of their mount point, with the root first.
+     * Each group can be mounted once the groups before it are. Entries
+     * in a group with different mount points do not depend on each other.
+     *
+     * A btrfs root gets subvolume @ and, unless there is a separate
+     * /home partition, @home mounted on /home.
+     */
+    static QList< EntryList > plan( const QVariantList& partitions, const QVariantList& extraMounts );
+
+private:
+    /// @brief Mount one entry below @p root; returns a description of the error, or empty
+    static QString mountEntry( const QString& root, const Entry& entry );
+
+    QVariantList m_extraMounts;
+    QVariantList m_extraMountsEfi;
+};
+
+CALAMARES_PLUGIN_FACTORY_DECLARATION( MountJobFactory )
+
+#endif  // MOUNTJOB_H
@@ -0,0 +1,133 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MountJob.h"
+
+#include "utils/Logger.h"
+
+#include <QtTest/QtTest>
+
+class MountTests : public QObject
+{
+    Q_OBJECT
+public:
+    MountTests() {}
+    ~MountTests() override {}
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testPlan();
+    void testPlanBtrfs();
+
+private:
+    static QVariantMap partition( const QString& device, const QString& mountPoint, const QString& fs )
+    {
+        return QVariantMap { { "device", device }, { "mountPoint", mountPoint }, { "fs", fs } };
+    }
+    static QStringList mountPoints( const MountJob::EntryList& l )
+    {
+        QStringList points;
+        for ( const auto& e : l )
+        {
+            points.append( e.mountPoint );
+        }
+        return points;
+    }
+};
+
+void
+MountTests::initTestCase()
+{
+    Logger::setupLogLevel( Logger::LOGDEBUG );
+}
+
+void
+MountTests::testPlan()
+{
+    QVariantMap crypted = partition( "/dev/sda3", "/home", "ext4" );
+    crypted.insert( "luksMapperName", "luks-home" );
+    const QVariantList partitions { partition( "/dev/sda2", "/boot", "ext4" ),
+                                    partition( "/dev/sda4", "/", "ext4" ),
+                                    partition( "/dev/sda1", "/boot/efi", "FAT32" ),
+                                    partition( "/dev/sda5", "", "linuxswap" ),
+                                    crypted };
+    const QVariantList extra { partition( "proc", "/proc", "proc" ),
+                               QVariantMap { { "device", "/dev" }, { "mountPoint", "/dev" }, { "options", "bind" } },
+                               partition( "efivarfs", "/sys/firmware/efi/efivars", "efivarfs" ),
+                               partition( "sys", "/sys", "sysfs" ) };
+
+    const auto levels = MountJob::plan( partitions, extra );
+    // Depths 0, 1, 2 and 4; swap has no mount point
+    QCOMPARE( levels.count(), 4 );
+    QCOMPARE( mountPoints( levels.at( 0 ) ), QStringList { "/" } );
+    QCOMPARE( mountPoints( levels.at( 1 ) ), QStringList( { "/boot", "/dev", "/home", "/proc", "/sys" } ) );
+    QCOMPARE( mountPoints( levels.at( 2 ) ), QStringList { "/boot/efi" } );
+    QCOMPARE( mountPoints( levels.at( 3 ) ), QStringList { "/sys/firmware/efi/efivars" } );
+
+    QCOMPARE( levels.at( 2 ).first().fs, QStringLiteral( "vfat" ) );
+    const auto& home = levels.at( 1 ).at( 2 );
+    QCOMPARE( home.device, QStringLiteral( "/dev/mapper/luks-home" ) );
+    const auto& dev = levels.at( 1 ).at( 1 );
+    QVERIFY( dev.fs.isEmpty() );
+    QCOMPARE( dev.mountOptions(), QStringLiteral( "bind" ) );
+    for ( const auto& level : levels )
+    {
+        for ( const auto& e : level )
+        {
+            QVERIFY( e.subvolume.isEmpty() );
+            QVERIFY( e.createSubvolumes.isEmpty() );
+        }
+    }
+}
+
+void
+MountTests::testPlanBtrfs()
+{
+    QVariantMap root = partition( "/dev/sda2", "/", "btrfs" );
+    root.insert( "options", "compress=zstd" );
+
+    // No separate /home: @home is mounted there
+    {
+        const auto levels = MountJob::plan( { root, partition( "/dev/sda1", "/boot/efi", "fat16" ) }, {} );
+        QCOMPARE( levels.count(), 3 );
+        const auto& r = levels.at( 0 ).first();
+        QCOMPARE( r.createSubvolumes, QStringList( { "@", "@home" } ) );
+        QCOMPARE( r.options, QStringLiteral( "compress=zstd" ) );
+        QCOMPARE( r.mountOptions(), QStringLiteral( "subvol=@,compress=zstd" ) );
+
+        QCOMPARE( mountPoints( levels.at( 1 ) ), QStringList { "/home" } );
+        const auto& home = levels.at( 1 ).first();
+        QCOMPARE( home.device, QStringLiteral( "/dev/sda2" ) );
+        QVERIFY( home.createSubvolumes.isEmpty() );
+        QCOMPARE( home.mountOptions(), QStringLiteral( "subvol=@home,compress=zstd" ) );
+    }
+    // Separate /home partition
+    {
+        const auto levels = MountJob::plan( { root, partition( "/dev/sda3", "/home", "xfs" ) }, {} );
+        QCOMPARE( levels.count(), 2 );
+        QCOMPARE( levels.at( 0 ).first().createSubvolumes, QStringList { "@" } );
+        QCOMPARE( levels.at( 1 ).count(), 1 );
+        QCOMPARE( levels.at( 1 ).first().device, QStringLiteral( "/dev/sda3" ) );
+        QCOMPARE( levels.at( 1 ).first().mountOptions(), QString() );
+    }
+}
+
+QTEST_GUILESS_MAIN( MountTests )
+
+#include "utils/moc-warnings.h"
+
+#include "Tests.moc"
@@ -24,8 +24,12 @@
 #   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
 
 import abc
+import os
+import shlex
+import shutil
 from string import Template
 import subprocess
+import time
 
 import libcalamares
 from libcalamares.utils import check_target_env_call, target_env_call
@@ -46,7 +50,8 @@ group_packages = 0  # One group of packages from an -install or -remove entry
 
 INSTALL = object()
 REMOVE = object()
-mode_packages = None  # Changes to INSTALL or REMOVE
+WAIT = object()
+mode_packages = None  # Changes to INSTALL, REMOVE or WAIT
 
 
 def _change_mode(mode):
@@ -73,6 +78,8 @@ def pretty_status_message():
     elif mode_packages is REMOVE:
         s = _n("Removing one package.",
                "Removing %(num)d packages.", group_packages)
+    elif mode_packages is WAIT:
+        s = _("Waiting for package downloads.")
     else:
         # No mode, generic description
         s = _("Install packages.")
@@ -92,6 +99,8 @@ class PackageManager(metaclass=abc.ABCMeta):
     backends.
     """
     backend = None
+    # Extra arguments for install(), to use a cache of downloaded packages
+    cache_options = []
 
     @abc.abstractmethod
     def install(self, pkgs, from_local=False):
@@ -122,10 +131,44 @@ class PackageManager(metaclass=abc.ABCMeta):
     def update_db(self):
         pass
 
+    def download_command(self, pkgs, cachedir):
+        """
+        Returns the command that downloads @p pkgs (and the
+        dependencies they need) into @p cachedir, in the host
+        system, or None if the backend can't download ahead.
+
+        @param pkgs: list[str]
+            list of package names
+        @param cachedir: str
+            directory for the downloaded packages
+        """
+        return None
+
+    def use_cache(self, cachedir):
+        """
+        Sets cache_options so that install() uses the packages in
+        @p cachedir, which is a path inside the target system.
+        """
+        pass
+
     def run(self, script):
         if script != "":
             check_target_env_call(script.split(" "))
 
+    def install_together(self, pkgs, from_local=False):
+        """
+        Install @p pkgs in a single transaction; merged operations
+        (see run_planned()) use this. Backends whose install() handles
+        the packages one by one override it.
+        """
+        self.install(pkgs, from_local=from_local)
+
+    def remove_together(self, pkgs):
+        """
+        Removes @p pkgs in a single transaction; see install_together().
+        """
+        self.remove(pkgs)
+
     def install_package(self, packagedata, from_local=False):
         """
         Install a package from a single entry in the install list.
@@ -172,6 +215,12 @@ class PMPackageKit(PackageManager):
         for pkg in pkgs:
             check_target_env_call(["pkcon", "-py", "remove", pkg])
 
+    def install_together(self, pkgs, from_local=False):
+        check_target_env_call(["pkcon", "-py", "install"] + pkgs)
+
+    def remove_together(self, pkgs):
+        check_target_env_call(["pkcon", "-py", "remove"] + pkgs)
+
     def update_db(self):
         check_target_env_call(["pkcon", "refresh"])
 
@@ -259,7 +308,8 @@ class PMApt(PackageManager):
     backend = "apt"
 
     def install(self, pkgs, from_local=False):
-        check_target_env_call(["apt-get", "-q", "-y", "install"] + pkgs)
+        check_target_env_call(["apt-get", "-q", "-y"] + self.cache_options +
+                              ["install"] + pkgs)
 
     def remove(self, pkgs):
         check_target_env_call(["apt-get", "--purge", "-q", "-y",
@@ -270,6 +320,14 @@ class PMApt(PackageManager):
     def update_db(self):
         check_target_env_call(["apt-get", "update"])
 
+    def download_command(self, pkgs, cachedir):
+        os.makedirs(os.path.join(cachedir, "partial"), exist_ok=True)
+        return ["apt-get", "-q", "-y", "--download-only",
+                "-o", "Dir::Cache::archives=" + cachedir, "install"] + pkgs
+
+    def use_cache(self, cachedir):
+        self.cache_options = ["-o", "Dir::Cache::archives=" + cachedir]
+
     def update_system(self):
         # Doesn't need to update the system explicitly
         pass
@@ -285,7 +343,7 @@ class PMPacman(PackageManager):
             pacman_flags = "-S"
 
         check_target_env_call(["pacman", pacman_flags,
-                               "--noconfirm"] + pkgs)
+                               "--noconfirm"] + self.cache_options + pkgs)
 
     def remove(self, pkgs):
         check_target_env_call(["pacman", "-Rs", "--noconfirm"] + pkgs)
@@ -293,6 +351,15 @@ class PMPacman(PackageManager):
     def update_db(self):
         check_target_env_call(["pacman", "-Sy"])
 
+    def download_command(self, pkgs, cachedir):
+        return ["pacman", "-Sw", "--noconfirm", "--cachedir", cachedir] + pkgs
+
+    def use_cache(self, cachedir):
+        # pacman downloads into the first usable cache directory,
+        # and looks for packages in all of them.
+        self.cache_options = ["--cachedir", "/var/cache/pacman/pkg",
+                              "--cachedir", cachedir]
+
     def update_system(self):
         check_target_env_call(["pacman", "-Su", "--noconfirm"])
 
@@ -383,6 +450,12 @@ class PMApk(PackageManager):
         for pkg in pkgs:
             check_target_env_call(["apk", "del", pkg])
 
+    def install_together(self, pkgs, from_local=False):
+        check_target_env_call(["apk", "add"] + pkgs)
+
+    def remove_together(self, pkgs):
+        check_target_env_call(["apk", "del"] + pkgs)
+
     def update_db(self):
         check_target_env_call(["apk", "update"])
 
@@ -516,6 +589,252 @@ def run_operations(pkgman, entry):
     _change_mode(None)
 
 
+# Operation keys that plan_operations() merges, with the transaction
+# they go into and whether failures are tolerated.
+PLANNED_OPERATIONS = {
+    "install": ("install", False),
+    "try_install": ("install", True),
+    "localInstall": ("localInstall", False),
+    "remove": ("remove", False),
+    "try_remove": ("remove", True),
+    }
+
+
+def plan_operations(operations):
+    """
+    Merges all of @p operations into as few package-manager
+    transactions as possible: one that installs (*install* and
+    *try_install*), one for *localInstall*, and one that removes
+    (*remove* and *try_remove*). The transactions are in the order
+    in which their first operation appears in @p operations.
+
+    Returns a list of dicts, with keys *action* (install, localInstall
+    or remove), *packages* (the package-data that must succeed) and
+    *optional* (the package-data whose failure is tolerated).
+    """
+    transactions = {}
+    order = []
+    for entry in operations:
+        for key, package_list in entry.items():
+            if key == "source":
+                libcalamares.utils.debug("Package-list from {!s}".format(package_list))
+                continue
+            if key not in PLANNED_OPERATIONS:
+                libcalamares.utils.warning("Unknown package-operation key {!s}".format(key))
+                continue
+            action, optional = PLANNED_OPERATIONS[key]
+            if action not in transactions:
+                transactions[action] = {"action": action, "packages": [], "optional": []}
+                order.append(action)
+            t = transactions[action]
+            for packagedata in subst_locale(package_list):
+                if packagedata in t["packages"]:
+                    continue
+                if not optional:
+                    # Required wins over optional
+                    if packagedata in t["optional"]:
+                        t["optional"].remove(packagedata)
+                    t["packages"].append(packagedata)
+                elif packagedata not in t["optional"]:
+                    t["optional"].append(packagedata)
+    return [transactions[action] for action in order]
+
+
+def package_name(packagedata):
+    if isinstance(packagedata, str):
+        return packagedata
+    return packagedata["package"]
+
+
+def run_tolerant(operation, names):
+    """
+    Calls @p operation with the list of package @p names. If that
+    fails, the list is split in two and each half is tried again, so
+    that only the packages that fail on their own are left out.
+
+    Returns the names of the packages that failed.
+    """
+    try:
+        operation(names)
+        return []
+    except subprocess.CalledProcessError:
+        if len(names) == 1:
+            libcalamares.utils.warning("Package operation failed for {!s}".format(names[0]))
+            return names
+        half = len(names) // 2
+        return run_tolerant(operation, names[:half]) + run_tolerant(operation, names[half:])
+
+
+def run_planned(pkgman, plan):
+    """
+    Runs the transactions of @p plan (see plan_operations()) with
+    @p pkgman. Each transaction is a single package-manager call,
+    unless it fails: then the required packages are done on their
+    own (a failure there fails the installation), and the optional
+    ones are retried with the failing ones left out.
+
+    The pre-scripts of the package-data in a transaction all run
+    before it, and the post-scripts after it.
+    """
+    global group_packages, completed_packages
+
+    for transaction in plan:
+        action = transaction["action"]
+        required = transaction["packages"]
+        optional = transaction["optional"]
+        if action == "remove":
+            _change_mode(REMOVE)
+            def operation(names):
+                pkgman.remove_together(names)
+        else:
+            _change_mode(INSTALL)
+            def operation(names):
+                pkgman.install_together(names, from_local=(action == "localInstall"))
+
+        group_packages = len(required) + len(optional)
+        # Pass it to pretty_status_message() before the first call
+        libcalamares.job.setprogress(completed_packages * 1.0 / total_packages)
+
+        scripted = [p for p in required + optional if not isinstance(p, str)]
+        for packagedata in scripted:
+            pkgman.run(packagedata["pre-script"])
+        try:
+            operation([package_name(p) for p in required + optional])
+        except subprocess.CalledProcessError:
+            if not optional:
+                raise
+            libcalamares.utils.debug("Combined {!s} failed, retrying".format(action))
+            if required:
+                operation([package_name(p) for p in required])
+            run_tolerant(operation, [package_name(p) for p in optional])
+        for packagedata in scripted:
+            pkgman.run(packagedata["post-script"])
+
+        completed_packages += group_packages
+        libcalamares.job.setprogress(completed_packages * 1.0 / total_packages)
+
+    group_packages = 0
+    _change_mode(None)
+
+
+# Marker file, written into the prefetch directory when the downloads are done
+PREFETCH_DONE = ".calamares-prefetch-done"
+# Where the prefetch directory is bind-mounted in the target system
+TARGET_PREFETCH_DIR = "/var/cache/calamares-packages"
+
+
+def prefetch_names(operations):
+    """
+    Returns the names of the packages that @p operations install
+    from a repository (*install* and *try_install*), without duplicates.
+    """
+    names = []
+    for entry in operations:
+        for key in ("install", "try_install"):
+            for packagedata in subst_locale(entry.get(key, [])):
+                if isinstance(packagedata, str):
+                    name = packagedata
+                else:
+                    name = packagedata["package"]
+                if name not in names:
+                    names.append(name)
+    return names
+
+
+def start_prefetch(pkgman, operations):
+    """
+    Starts downloading the packages that @p operations install into
+    the prefetch directory, in the background, using the package
+    manager of the live system. The downloads go on while the user
+    is on the next pages and while the image is unpacked; a later
+    instance of this module uses them (see use_prefetch()).
+    """
+    cachedir = libcalamares.job.configuration.get("prefetch_dir", TARGET_PREFETCH_DIR)
+    names = prefetch_names(operations)
+    if not names:
+        libcalamares.utils.debug("No packages to prefetch")
+        return
+    os.makedirs(cachedir, exist_ok=True)
+    command = pkgman.download_command(names, cachedir)
+    if command is None:
+        libcalamares.utils.warning("Backend {!s} can not prefetch packages".format(pkgman.backend))
+        return
+
+    def shell(args):
+        return " ".join(shlex.quote(a) for a in args)
+
+    # Everything at once; if that fails (e.g. a try_install package
+    # does not exist), one by one, to get what can be got.
+    singles = "; ".join(shell(pkgman.download_command([n], cachedir)) for n in names)
+    done = os.path.join(cachedir, PREFETCH_DONE)
+    if os.path.exists(done):
+        os.remove(done)
+    script = "{!s} || {{ {!s}; }}; touch {!s}".format(shell(command), singles, shlex.quote(done))
+
+    libcalamares.utils.debug("Prefetching {!s} packages into {!s}".format(len(names), cachedir))
+    with open(os.path.join(cachedir, "calamares-prefetch.log"), "w") as log:
+        p = subprocess.Popen(["sh", "-c", script], stdin=subprocess.DEVNULL,
+                             stdout=log, stderr=subprocess.STDOUT,
+                             start_new_session=True)
+    libcalamares.globalstorage.insert("packagesPrefetch",
+                                      {"backend": pkgman.backend, "cacheDir": cachedir, "pid": p.pid})
+
+
+def prefetch_running(pid):
+    """
+    Is the prefetch process @p pid (a child of Calamares) still running?
+    """
+    try:
+        return os.waitpid(pid, os.WNOHANG) == (0, 0)
+    except ChildProcessError:
+        return False
+
+
+def use_prefetch(pkgman):
+    """
+    If packages were prefetched for this backend, waits for the
+    downloads to finish, makes them visible in the target system
+    and tells @p pkgman to use them.
+
+    Returns the prefetch directory, or None.
+    """
+    prefetch = libcalamares.globalstorage.value("packagesPrefetch")
+    if not prefetch or prefetch.get("backend") != pkgman.backend:
+        return None
+    cachedir = prefetch["cacheDir"]
+
+    _change_mode(WAIT)
+    done = os.path.join(cachedir, PREFETCH_DONE)
+    while not os.path.exists(done) and prefetch_running(prefetch["pid"]):
+        time.sleep(1)
+    _change_mode(None)
+    if not os.path.exists(done):
+        libcalamares.utils.warning("Prefetching packages did not finish, see {!s}".format(
+            os.path.join(cachedir, "calamares-prefetch.log")))
+
+    target = libcalamares.globalstorage.value("rootMountPoint") + TARGET_PREFETCH_DIR
+    if libcalamares.utils.mount(cachedir, target, "", "--bind") != 0:
+        libcalamares.utils.warning("Could not use prefetched packages in {!s}".format(cachedir))
+        return None
+    pkgman.use_cache(TARGET_PREFETCH_DIR)
+    return cachedir
+
+
+def release_prefetch(cachedir):
+    """
+    Undoes use_prefetch() and removes the prefetched packages,
+    which are usually held in memory on a live system.
+    """
+    target = libcalamares.globalstorage.value("rootMountPoint") + TARGET_PREFETCH_DIR
+    subprocess.call(["umount", "-l", target])
+    try:
+        os.rmdir(target)
+    except OSError:
+        pass
+    shutil.rmtree(cachedir, ignore_errors=True)
+    libcalamares.globalstorage.remove("packagesPrefetch")
+
+
 def run():
     """
     Calls routine with detected package manager to install locale packages
@@ -539,6 +858,15 @@ def run():
         libcalamares.utils.warning( "Package installation has been skipped: no internet" )
         return None
 
+    operations = libcalamares.job.configuration.get("operations", [])
+    if libcalamares.globalstorage.contains("packageOperations"):
+        operations += libcalamares.globalstorage.value("packageOperations")
+
+    if libcalamares.job.configuration.get("prefetch_only", False):
+        if libcalamares.globalstorage.value("hasInternet"):
+            start_prefetch(pkgman, operations)
+        return None
+
     update_db = libcalamares.job.configuration.get("update_db", False)
     if update_db and libcalamares.globalstorage.value("hasInternet"):
         pkgman.update_db()
@@ -547,10 +875,6 @@ def run():
     if update_system and libcalamares.globalstorage.value("hasInternet"):
         pkgman.update_system()
 
-    operations = libcalamares.job.configuration.get("operations", [])
-    if libcalamares.globalstorage.contains("packageOperations"):
-        operations += libcalamares.globalstorage.value("packageOperations")
-
     mode_packages = None
     total_packages = 0
     completed_packages = 0
@@ -562,10 +886,23 @@ def run():
         # Avoids potential divide-by-zero in progress reporting
         return None
 
-    for entry in operations:
-        group_packages = 0
-        libcalamares.utils.debug(pretty_name())
-        run_operations(pkgman, entry)
+    # If a later module regenerates the initramfs, the package
+    # manager's hooks need not do it after every transaction.
+    if libcalamares.utils.defer_initramfs_hooks():
+        libcalamares.utils.request_initramfs("packages")
+
+    prefetched = use_prefetch(pkgman)
+    try:
+        if libcalamares.job.configuration.get("merge_operations", False):
+            run_planned(pkgman, plan_operations(operations))
+        else:
+            for entry in operations:
+                group_packages = 0
+                libcalamares.utils.debug(pretty_name())
+                run_operations(pkgman, entry)
+    finally:
+        if prefetched:
+            release_prefetch(prefetched)
 
     mode_packages = None
 
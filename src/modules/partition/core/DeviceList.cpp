@@ -25,12 +25,14 @@
 
 #include "GlobalStorage.h"
 #include "JobQueue.h"
+#include "partition/DeviceInventory.h"
 #include "partition/PartitionIterator.h"
 #include "utils/Logger.h"
 
 #include <kpmcore/backend/corebackend.h>
 #include <kpmcore/backend/corebackendmanager.h>
 #include <kpmcore/core/device.h>
+#include <kpmcore/core/lvmdevice.h>
 #include <kpmcore/core/partition.h>
 
 #include <QProcess>
@@ -117,11 +119,34 @@ getDevices( DeviceType which, qint64 minimumSize )
     bool writableOnly = ( which == DeviceType::WritableOnly );
 
     CoreBackend* backend = CoreBackendManager::self()->backend();
+    DeviceList devices;
+    if ( CalamaresUtils::Partition::DeviceInventory::isSupported() )
+    {
+        // Probing a disk is slow; only ask KPMcore about the disks that
+        // the shared inventory says could be used at all (this skips
+        // read-only, loop, zram and CD devices, like scanDevices() would).
+        const auto candidates
+            = CalamaresUtils::Partition::DeviceInventory::instance()->installableDevices( minimumSize );
+        for ( const auto& candidate : candidates )
+        {
+            Device* device = backend->scanDevice( candidate.devicePath() );
+            if ( device )
+            {
+                devices.append( device );
+            }
+        }
+        // scanDevices() also adds the LVM volume groups; those are not
+        // block devices of their own, so add them the same way.
+        LvmDevice::scanSystemLVM( devices );
+    }
+    else
+    {
 #if defined( WITH_KPMCORE4API )
-    DeviceList devices = backend->scanDevices( /* not includeReadOnly, not includeLoopback */ ScanFlag( 0 ) );
+        devices = backend->scanDevices( /* not includeReadOnly, not includeLoopback */ ScanFlag( 0 ) );
 #else
-    DeviceList devices = backend->scanDevices( /* excludeReadOnly */ true );
+        devices = backend->scanDevices( /* excludeReadOnly */ true );
 #endif
+    }
 
 #ifdef DEBUG_PARTITION_UNSAFE
     cWarning() << "Allowing unsafe partitioning choices." << devices.count() << "candidates.";
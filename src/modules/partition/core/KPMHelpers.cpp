@@ -23,14 +23,23 @@
 #include "core/PartitionInfo.h"
 
 #include "partition/PartitionIterator.h"
+#include "utils/CalamaresUtilsSystem.h"
 #include "utils/Logger.h"
 
 // KPMcore
+#include <kpmcore/backend/corebackend.h>
+#include <kpmcore/backend/corebackenddevice.h>
 #include <kpmcore/backend/corebackendmanager.h>
+#include <kpmcore/backend/corebackendpartitiontable.h>
 #include <kpmcore/core/device.h>
 #include <kpmcore/core/partition.h>
 #include <kpmcore/fs/filesystemfactory.h>
 #include <kpmcore/fs/luks.h>
+#include <kpmcore/util/report.h>
+
+#include <QMutex>
+
+#include <memory>
 
 using CalamaresUtils::Partition::PartitionIterator;
 
@@ -132,4 +141,112 @@ clonePartition( Device* device, Partition* partition )
                           partition->activeFlags() );
 }
 
+QMutex&
+backendLock()
+{
+    static QMutex s_lock;
+    return s_lock;
+}
+
+bool
+canFormatDirectly( const Partition* partition )
+{
+    const FileSystem& fs = partition->fileSystem();
+    switch ( fs.type() )
+    {
+    case FileSystem::Unknown:
+    case FileSystem::Unformatted:
+    case FileSystem::Extended:
+    case FileSystem::Luks:
+    case FileSystem::Luks2:
+    case FileSystem::Lvm2_PV:
+        return false;
+    default:
+        return fs.supportCreate() == FileSystem::cmdSupportFileSystem;
+    }
+}
+
+/* KPMcore 3 returns owning raw pointers from the backend, KPMcore 4
+ * returns std::unique_ptr; take ownership either way.
+ */
+template < typename T >
+static std::unique_ptr< T >
+owned( T* p )
+{
+    return std::unique_ptr< T >( p );
+}
+
+template < typename T >
+static std::unique_ptr< T >
+owned( std::unique_ptr< T > p )
+{
+    return p;
+}
+
+bool
+formatPartition( Device* device, Partition* partition, Report& report )
+{
+    FileSystem& fs = partition->fileSystem();
+    const QString node = partition->partitionPath();
+
+    // KPMcore clobbers old file-system signatures before creating a
+    // new one, so that blkid doesn't see both afterwards.
+    auto r = CalamaresUtils::System::runCommand( { "wipefs", "--all", node }, std::chrono::seconds( 60 ) );
+    if ( r.getExitCode() )
+    {
+        cWarning() << "Could not wipe old signatures from" << node << r.getExitCode();
+    }
+
+    {
+#ifdef WITH_KPMCORE4API
+        // KPMcore 4 runs the tools through its privileged helper, which
+        // is shared by all of ExternalCommand.
+        QMutexLocker lock( &backendLock() );
+#endif
+        // What KPMcore's CreateFileSystemOperation does after clobbering the
+        // old file system: create the new one, then check it.
+        if ( !fs.createWithLabel( report, node, fs.label() ) )
+        {
+            report.line() << QStringLiteral( "Could not create file system %1 on %2." ).arg( fs.name(), node );
+            return false;
+        }
+        if ( fs.supportCheck() == FileSystem::cmdSupportFileSystem && !fs.check( report, node ) )
+        {
+            report.line() << QStringLiteral( "The new file system on %1 failed its check." ).arg( node );
+            return false;
+        }
+    }
+
+    // The partition-table type (e.g. GPT type GUID) follows the file system;
+    // only real partition tables have one.
+    bool hasPartitionTable = device->type() == Device::Type::Disk_Device;
+#ifdef WITH_KPMCORE4API
+    hasPartitionTable = hasPartitionTable || device->type() == Device::Type::SoftwareRAID_Device;
+#endif
+    if ( !hasPartitionTable )
+    {
+        return true;
+    }
+
+    QMutexLocker lock( &backendLock() );
+    auto backendDevice = owned( CoreBackendManager::self()->backend()->openDevice( *device ) );
+    if ( !backendDevice )
+    {
+        report.line() << QStringLiteral( "Could not open device %1." ).arg( device->deviceNode() );
+        return false;
+    }
+    auto backendPartitionTable = owned( backendDevice->openPartitionTable() );
+    if ( !backendPartitionTable )
+    {
+        report.line() << QStringLiteral( "Could not open partition table on %1." ).arg( device->deviceNode() );
+        return false;
+    }
+    if ( !backendPartitionTable->setPartitionSystemType( report, *partition ) )
+    {
+        return false;
+    }
+    backendPartitionTable->commit();
+    return true;
+}
+
 }  // namespace KPMHelpers
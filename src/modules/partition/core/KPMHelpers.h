@@ -33,6 +33,8 @@ class Device;
 class Partition;
 class PartitionNode;
 class PartitionRole;
+class QMutex;
+class Report;
 
 #if defined( WITH_KPMCORE4API )
 #define KPM_PARTITION_FLAG( x ) PartitionTable::Flag::x
@@ -79,6 +81,43 @@ Partition* createNewEncryptedPartition( PartitionNode* parent,
 
 Partition* clonePartition( Device* device, Partition* partition );
 
+/** @brief Lock for KPMcore access
+ *
+ * KPMcore is not thread-safe: the backends have global state (libparted
+ * does), and with KPMcore 4, ExternalCommand, which KPMcore uses to run
+ * every tool, shares the privileged helper between commands. Calamares
+ * has always used KPMcore from the job thread, but from only one thread at
+ * a time. When partition jobs run concurrently (see ConcurrentDeviceJobs),
+ * every use of the backend and of KPMcore's operations holds this lock,
+ * and so do file-system tools with KPMcore 4. With KPMcore 3, each
+ * ExternalCommand is a QProcess of its own, and formatPartition() runs
+ * the tools without the lock.
+ */
+QMutex& backendLock();
+
+/** @brief Can formatPartition() handle @p partition ?
+ *
+ * True for file systems that KPMcore can create with its tools; false
+ * for unformatted, extended, LUKS and LVM PV partitions, which need
+ * KPMcore's own operations.
+ */
+bool canFormatDirectly( const Partition* partition );
+
+/** @brief Create the file system of @p partition (which exists already)
+ *
+ * This does what KPMcore's CreateFileSystemOperation does: wipe the old
+ * signatures, create the file system with KPMcore's FileSystem (so with
+ * KPMcore's options for each file system), check it, and set the partition
+ * type. Only setting the partition type uses the backend, under
+ * backendLock(). With KPMcore 3, the (slow) file-system tools run without
+ * the lock, so that several devices can be formatted at once.
+ *
+ * This is meant for jobs run by ConcurrentDeviceJobs; otherwise, use
+ * KPMcore's operations. Returns true on success; details are added
+ * to @p report.
+ */
+bool formatPartition( Device* device, Partition* partition, Report& report );
+
 }  // namespace KPMHelpers
 
 #endif /* KPMHELPERS_H */
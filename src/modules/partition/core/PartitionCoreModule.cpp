@@ -32,6 +32,7 @@
 #include "core/PartitionModel.h"
 #include "jobs/ClearMountsJob.h"
 #include "jobs/ClearTempMountsJob.h"
+#include "jobs/ConcurrentDeviceJobs.h"
 #include "jobs/CreatePartitionJob.h"
 #include "jobs/CreatePartitionTableJob.h"
 #include "jobs/CreateVolumeGroupJob.h"
@@ -549,11 +550,17 @@ PartitionCoreModule::jobs() const
         }
     }
 
+    // Jobs for different disks are independent, so they can run at the
+    // same time (each disk's jobs stay in order).
+    QList< Calamares::JobList > deviceJobs;
+    QList< bool > plainDisks;
     for ( auto info : m_deviceInfos )
     {
-        lst << info->jobs;
+        deviceJobs << info->jobs;
+        plainDisks << ( info->device->type() == Device::Type::Disk_Device );
         devices << info->device.data();
     }
+    lst << ConcurrentDeviceJobs::arrange( deviceJobs, plainDisks );
     lst << Calamares::job_ptr( new FillGlobalStorageJob( devices, m_bootLoaderInstallPath ) );
 
     return lst;
@@ -22,8 +22,11 @@
 
 #include "core/PartitionInfo.h"
 
+#include "partition/DeviceInventory.h"
+#include "partition/Mount.h"
 #include "partition/Sync.h"
 #include "partition/PartitionIterator.h"
+#include "utils/CalamaresUtilsSystem.h"
 #include "utils/Logger.h"
 
 // KPMcore
@@ -32,8 +35,27 @@
 #include <kpmcore/util/report.h>
 
 #include <QDir>
-#include <QProcess>
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
 #include <QStringList>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/dm-ioctl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/swap.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
 
 using CalamaresUtils::Partition::PartitionIterator;
 
@@ -63,234 +85,475 @@ ClearMountsJob::prettyStatusMessage() const
 QStringList
 getPartitionsForDevice( const QString& deviceName )
 {
-    QStringList partitions;
+    // The inventory re-reads sysfs if the kernel has reported changes
+    // to block devices since it was last asked.
+    auto device = CalamaresUtils::Partition::DeviceInventory::instance()->device( deviceName );
+    if ( !device.isValid() )
+    {
+        cDebug() << "No block device" << deviceName << "in the inventory.";
+    }
+    return device.partitions;
+}
 
-    QFile dev_partitions( "/proc/partitions" );
-    if ( dev_partitions.open( QFile::ReadOnly ) )
+static QString
+readSysfs( const QString& path )
+{
+    QFile f( path );
+    if ( f.open( QIODevice::ReadOnly ) )
     {
-        cDebug() << "Reading from" << dev_partitions.fileName();
-        QTextStream in( &dev_partitions );
-        (void) in.readLine();  // That's the header line, skip it
-        while ( !in.atEnd() )
+        return QString::fromUtf8( f.readAll().trimmed() );
+    }
+    return QString();
+}
+
+/** @brief Group the block devices stacked on @p roots, top of the stack first
+ *
+ * Follows the holders/ links in @p sysClassBlock (normally /sys/class/block)
+ * from each of the @p roots. The first group holds the devices that nothing
+ * else is stacked on; each later group only holds devices whose holders are
+ * all in earlier groups. The last group contains (at least some of) the roots.
+ * Fedora's live-* mappings belong to the live system and are left out.
+ *
+ * Not exactly public API: used in tests.
+ */
+QList< QStringList >
+getTeardownLevels( const QStringList& roots, const QString& sysClassBlock )
+{
+    const QDir sys( sysClassBlock );
+    QMap< QString, int > heights;
+
+    // Height is the length of the longest chain of holders above a device
+    std::function< int( const QString& ) > height = [&]( const QString& name ) -> int {
+        auto it = heights.constFind( name );
+        if ( it != heights.constEnd() )
+        {
+            return it.value();
+        }
+        heights.insert( name, 0 );  // Guards against (impossible) cycles
+
+        int h = 0;
+        const QStringList holders
+            = QDir( sys.filePath( name + QStringLiteral( "/holders" ) ) ).entryList( QDir::AllEntries | QDir::NoDotAndDotDot );
+        for ( const QString& holder : holders )
         {
-            // The fourth column (index from 0, so index 3) is the name of the device;
-            // keep it if it is followed by something.
-            QStringList columns = in.readLine().split( ' ', QString::SkipEmptyParts );
-            if ( ( columns.count() >= 4 ) && ( columns[3].startsWith( deviceName ) )  && ( columns[3] != deviceName ) )
+            // Fedora live images use /dev/mapper/live-* internally; we must not touch those.
+            if ( readSysfs( sys.filePath( holder + QStringLiteral( "/dm/name" ) ) ).startsWith( QStringLiteral( "live-" ) ) )
             {
-                partitions.append( columns[3] );
+                continue;
             }
+            h = qMax( h, height( holder ) + 1 );
         }
-    }
-    else
+        heights.insert( name, h );
+        return h;
+    };
+    for ( const QString& root : roots )
     {
-        cDebug() << "Could not open" << dev_partitions.fileName();
+        height( root );
     }
 
-    return partitions;
+    QList< QStringList > levels;
+    for ( auto it = heights.constBegin(); it != heights.constEnd(); ++it )
+    {
+        while ( levels.count() <= it.value() )
+        {
+            levels.append( QStringList() );
+        }
+        levels[ it.value() ].append( it.key() );  // QMap is sorted, so each level is too
+    }
+    return levels;
 }
 
-Calamares::JobResult
-ClearMountsJob::exec()
+/** @brief If the swap at @p path holds a hibernation image, mark it as plain swap again
+ *
+ * This is what the kernel does when it decides not to resume from an
+ * image: the original swap signature is copied back over the
+ * hibernation signature, at the end of the first page. When the
+ * original signature is unknown, mkswap re-creates the swap header
+ * with the same UUID.
+ *
+ * Not exactly public API: used in tests.
+ */
+bool
+clearHibernationSignature( const QString& path, int pageSize )
 {
-    CalamaresUtils::Partition::Syncer s;
+    static const char* const hibernationSignatures[] = { "S1SUSPEND", "S2SUSPEND", "ULSUSPEND", "LINHIB0001" };
+    static const int signatureSize = 10;
 
-    QString deviceName = m_device->deviceNode().split( '/' ).last();
-
-    QStringList goodNews;
-    QProcess process;
-
-    QStringList partitionsList = getPartitionsForDevice( deviceName );
-
-    // Build a list of partitions of type 82 (Linux swap / Solaris).
-    // We then need to clear them just in case they contain something resumable from a
-    // previous suspend-to-disk.
-    QStringList swapPartitions;
-    process.start( "sfdisk", { "-d", m_device->deviceNode() } );
-    process.waitForFinished();
-    // Sample output:
-    //    % sudo sfdisk -d /dev/sda
-    //    label: dos
-    //    label-id: 0x000ced89
-    //    device: /dev/sda
-    //    unit: sectors
-
-    //    /dev/sda1 : start=          63, size=    29329345, type=83, bootable
-    //    /dev/sda2 : start=    29331456, size=     2125824, type=82
-
-    swapPartitions = QString::fromLocal8Bit( process.readAllStandardOutput() )
-                        .split( '\n' );
-    swapPartitions = swapPartitions.filter( "type=82" );
-    for ( QStringList::iterator it = swapPartitions.begin();
-          it != swapPartitions.end(); ++it )
+    const QByteArray name = QFile::encodeName( path );
+    QByteArray page( pageSize, '\0' );
     {
-        *it = (*it).simplified().split( ' ' ).first();
+        // Only open for writing when needed, because that makes udev re-probe the device
+        int fd = ::open( name.constData(), O_RDONLY | O_CLOEXEC );
+        if ( fd < 0 )
+        {
+            return false;
+        }
+        ssize_t r = ::pread( fd, page.data(), static_cast< size_t >( pageSize ), 0 );
+        ::close( fd );
+        if ( r != pageSize )
+        {
+            return false;
+        }
     }
 
-    const QStringList cryptoDevices = getCryptoDevices();
-    for ( const QString &mapperPath : cryptoDevices )
+    const char* signature = page.constData() + pageSize - signatureSize;
+    const char* originalSignature = signature - signatureSize;
+    if ( std::none_of( std::begin( hibernationSignatures ), std::end( hibernationSignatures ), [signature]( const char* s ) {
+             return memcmp( signature, s, strlen( s ) ) == 0;
+         } ) )
     {
-        tryUmount( mapperPath );
-        QString news = tryCryptoClose( mapperPath );
-        if ( !news.isEmpty() )
-            goodNews.append( news );
+        return false;
     }
 
-    // First we umount all LVM logical volumes we can find
-    process.start( "lvscan", { "-a" } );
-    process.waitForFinished();
-    if ( process.exitCode() == 0 ) //means LVM2 tools are installed
+    if ( memcmp( originalSignature, "SWAPSPACE2", signatureSize ) == 0
+         || memcmp( originalSignature, "SWAP-SPACE", signatureSize ) == 0 )
     {
-        const QStringList lvscanLines = QString::fromLocal8Bit( process.readAllStandardOutput() ).split( '\n' );
-        for ( const QString& lvscanLine : lvscanLines )
+        int fd = ::open( name.constData(), O_WRONLY | O_CLOEXEC );
+        if ( fd < 0 )
         {
-            QString lvPath = lvscanLine.simplified().split( ' ' ).value( 1 ); //second column
-            lvPath = lvPath.replace( '\'', "" );
-
-            QString news = tryUmount( lvPath );
-            if ( !news.isEmpty() )
-                goodNews.append( news );
+            return false;
         }
+        bool ok = ::pwrite( fd, originalSignature, signatureSize, pageSize - signatureSize ) == signatureSize
+            && ::fsync( fd ) == 0;
+        ::close( fd );
+        return ok;
     }
-    else
-        cWarning() << "this system does not seem to have LVM2 tools.";
 
-    // Then we go looking for volume groups that use this device for physical volumes
-    process.start( "pvdisplay", { "-C", "--noheadings" } );
-    process.waitForFinished();
-    if ( process.exitCode() == 0 ) //means LVM2 tools are installed
-    {
-        QString pvdisplayOutput = process.readAllStandardOutput();
-        if ( !pvdisplayOutput.simplified().isEmpty() ) //means there is at least one LVM PV
-        {
-            QSet< QString > vgSet;
+    // The swap header (with the UUID at offset 1036) is still there
+    const QByteArray uuid = page.mid( 1036, 16 ).toHex();
+    const QString uuidString = QStringLiteral( "%1-%2-%3-%4-%5" )
+                                   .arg( QString::fromLatin1( uuid.mid( 0, 8 ) ),
+                                         QString::fromLatin1( uuid.mid( 8, 4 ) ),
+                                         QString::fromLatin1( uuid.mid( 12, 4 ) ),
+                                         QString::fromLatin1( uuid.mid( 16, 4 ) ),
+                                         QString::fromLatin1( uuid.mid( 20 ) ) );
+    auto r = CalamaresUtils::System::runCommand( { "mkswap", "-U", uuidString, path }, std::chrono::seconds( 30 ) );
+    return r.getExitCode() == 0;
+}
 
-            const QStringList pvdisplayLines = pvdisplayOutput.split( '\n' );
-            for ( const QString& pvdisplayLine : pvdisplayLines )
-            {
-                QString pvPath = pvdisplayLine.simplified().split( ' ' ).value( 0 );
-                QString vgName = pvdisplayLine.simplified().split( ' ' ).value( 1 );
-                if ( !pvPath.contains( deviceName ) )
-                    continue;
+/// @brief The major:minor number of block device @p path, or empty
+static QString
+deviceNumber( const QString& path )
+{
+    struct stat st;
+    if ( ::stat( QFile::encodeName( path ).constData(), &st ) == 0 && S_ISBLK( st.st_mode ) )
+    {
+        return QStringLiteral( "%1:%2" ).arg( major( st.st_rdev ) ).arg( minor( st.st_rdev ) );
+    }
+    return QString();
+}
 
-                vgSet.insert( vgName );
-            }
+/// @brief Mount points in the live system, by major:minor of the device mounted there
+static QMultiMap< QString, QString >
+mountsByDevice()
+{
+    QMultiMap< QString, QString > mounts;
+    QFile f( QStringLiteral( "/proc/self/mountinfo" ) );
+    if ( !f.open( QIODevice::ReadOnly ) )
+    {
+        return mounts;
+    }
+    for ( const QByteArray& line : f.readAll().split( '\n' ) )
+    {
+        // id parent major:minor root mountpoint options [optional fields] - type source superoptions
+        const auto fields = line.split( ' ' );
+        if ( fields.count() < 5 )
+        {
+            continue;
+        }
+        const QString mountPoint = CalamaresUtils::Partition::unescapeMountPath( fields.at( 4 ) );
+        const QString number = QString::fromLatin1( fields.at( 2 ) );
+        mounts.insert( number, mountPoint );
 
-            foreach ( const QString& vgName, vgSet )
+        // btrfs reports an anonymous device number; the source names the real one
+        const int separator = fields.indexOf( "-" );
+        if ( separator > 0 && separator + 2 < fields.count() && fields.at( separator + 2 ).startsWith( "/dev/" ) )
+        {
+            const QString source = deviceNumber( CalamaresUtils::Partition::unescapeMountPath( fields.at( separator + 2 ) ) );
+            if ( !source.isEmpty() && source != number )
             {
-                process.start( "vgchange", { "-an", vgName } );
-                process.waitForFinished();
-                if ( process.exitCode() == 0 )
-                    goodNews.append( QString( "Successfully disabled volume group %1." ).arg( vgName ) );
+                mounts.insert( source, mountPoint );
             }
         }
     }
-    else
-        cWarning() << "this system does not seem to have LVM2 tools.";
+    return mounts;
+}
 
-    const QStringList cryptoDevices2 = getCryptoDevices();
-    for ( const QString &mapperPath : cryptoDevices2 )
+/// @brief Active swap areas, by major:minor of the device
+static QMap< QString, QString >
+swapsByDevice()
+{
+    QMap< QString, QString > swaps;
+    QFile f( QStringLiteral( "/proc/swaps" ) );
+    if ( !f.open( QIODevice::ReadOnly ) )
     {
-        tryUmount( mapperPath );
-        QString news = tryCryptoClose( mapperPath );
-        if ( !news.isEmpty() )
-            goodNews.append( news );
+        return swaps;
     }
-
-    for ( const QString &p : partitionsList )
+    const auto lines = f.readAll().split( '\n' );
+    for ( int i = 1; i < lines.count(); ++i )  // Skip the header
     {
-        QString partPath = QString( "/dev/%1" ).arg( p );
-
-        QString news = tryUmount( partPath );
-        if ( !news.isEmpty() )
-            goodNews.append( news );
+        const QString path = CalamaresUtils::Partition::unescapeMountPath( lines.at( i ).simplified().split( ' ' ).first() );
+        const QString number = deviceNumber( path );
+        if ( !number.isEmpty() )
+        {
+            swaps.insert( number, path );
+        }
     }
+    return swaps;
+}
 
-    foreach ( QString p, swapPartitions )
+/// @brief Remove device-mapper device @p name (like dmsetup remove); returns an errno value
+static int
+removeMapping( const QString& name )
+{
+    int fd = ::open( "/dev/mapper/control", O_RDWR | O_CLOEXEC );
+    if ( fd < 0 )
     {
-        QString news = tryClearSwap( p );
-        if ( !news.isEmpty() )
-            goodNews.append( news );
+        return errno;
     }
 
-    Calamares::JobResult ok = Calamares::JobResult::ok();
-    ok.setMessage( tr( "Cleared all mounts for %1" )
-                        .arg( m_device->deviceNode() ) );
-    ok.setDetails( goodNews.join( "\n" ) );
-
-    cDebug() << "ClearMountsJob finished. Here's what was done:\n" << goodNews.join( "\n" );
-
-    return ok;
+    int error = 0;
+    for ( int attempt = 0; attempt < 5; ++attempt )
+    {
+        struct dm_ioctl io;
+        memset( &io, 0, sizeof( io ) );
+        io.version[ 0 ] = DM_VERSION_MAJOR;  // Remove exists since 4.0.0
+        io.data_size = sizeof( io );
+        io.data_start = sizeof( io );
+        strncpy( io.name, name.toUtf8().constData(), DM_NAME_LEN - 1 );
+        if ( ::ioctl( fd, DM_DEV_REMOVE, &io ) == 0 )
+        {
+            error = 0;
+            break;
+        }
+        error = errno;
+        if ( error != EBUSY )
+        {
+            break;
+        }
+        QThread::msleep( 200 );  // udev may still be probing the device
+    }
+    ::close( fd );
+    return error;
 }
 
-
-QString
-ClearMountsJob::tryUmount( const QString& partPath )
+/// @brief The volume group name from an LVM device-mapper name ("my--vg-root" is LV root in VG my-vg)
+static QString
+volumeGroupName( const QString& dmName )
 {
-    QProcess process;
-    process.start( "umount", { partPath } );
-    process.waitForFinished();
-    if ( process.exitCode() == 0 )
-        return QString( "Successfully unmounted %1." ).arg( partPath );
-
-    process.start( "swapoff", { partPath } );
-    process.waitForFinished();
-    if ( process.exitCode() == 0 )
-        return QString( "Successfully disabled swap %1." ).arg( partPath );
-
+    for ( int i = 0; i < dmName.length(); ++i )
+    {
+        if ( dmName.at( i ) == '-' )
+        {
+            if ( i + 1 < dmName.length() && dmName.at( i + 1 ) == '-' )
+            {
+                ++i;  // Escaped dash
+                continue;
+            }
+            return dmName.left( i ).replace( QStringLiteral( "--" ), QStringLiteral( "-" ) );
+        }
+    }
     return QString();
 }
 
-
-QString
-ClearMountsJob::tryClearSwap( const QString& partPath )
+/// @brief Run @p f on each of the @p items concurrently, and wait for all of them
+template < typename T, typename F >
+static void
+runConcurrently( const QList< T >& items, F f )
 {
-    QProcess process;
-    process.start( "blkid", { "-s", "UUID", "-o", "value", partPath } );
-    process.waitForFinished();
-    QString swapPartUuid = QString::fromLocal8Bit( process.readAllStandardOutput() ).simplified();
-    if ( process.exitCode() != 0 ||
-         swapPartUuid.isEmpty() )
-        return QString();
-
-    process.start( "mkswap", { "-U", swapPartUuid, partPath } );
-    process.waitForFinished();
-    if ( process.exitCode() != 0 )
-        return QString();
-
-    return QString( "Successfully cleared swap %1." ).arg( partPath );
+    QList< QFuture< void > > running;
+    for ( const auto& item : items )
+    {
+        running.append( QtConcurrent::run( [f, item]() { f( item ); } ) );
+    }
+    for ( auto& r : running )
+    {
+        r.waitForFinished();
+    }
 }
 
-
-QString
-ClearMountsJob::tryCryptoClose( const QString& mapperPath )
+Calamares::JobResult
+ClearMountsJob::exec()
 {
-    QProcess process;
-    process.start( "cryptsetup", { "close", mapperPath } );
-    process.waitForFinished();
-    if ( process.exitCode() == 0 )
-        return QString( "Successfully closed mapper device %1." ).arg( mapperPath );
+    CalamaresUtils::Partition::Syncer s;
 
-    return QString();
-}
+    const QString sysClassBlock = QStringLiteral( "/sys/class/block/" );
+    const QString deviceName = m_device->deviceNode().split( '/' ).last();
+    const QStringList partitionsList = getPartitionsForDevice( deviceName );
 
+    QStringList goodNews;
+    QMutex newsMutex;
+    auto report = [&goodNews, &newsMutex]( const QString& news ) {
+        QMutexLocker lock( &newsMutex );
+        goodNews.append( news );
+    };
+
+    // Everything stacked on the disk (whole-disk LUKS or LVM) or on its partitions
+    const QList< QStringList > levels = getTeardownLevels( QStringList { deviceName } + partitionsList, sysClassBlock );
+    QMap< QString, QString > devicePaths;  // By major:minor
+    QMap< QString, QString > dmNames;  // By kernel name, only device-mapper devices
+    for ( const auto& level : levels )
+    {
+        for ( const QString& name : level )
+        {
+            const QString dmName = readSysfs( sysClassBlock + name + QStringLiteral( "/dm/name" ) );
+            if ( !dmName.isEmpty() )
+            {
+                dmNames.insert( name, dmName );
+            }
+            devicePaths.insert( readSysfs( sysClassBlock + name + QStringLiteral( "/dev" ) ),
+                                dmName.isEmpty() ? QStringLiteral( "/dev/" ) + name
+                                                 : QStringLiteral( "/dev/mapper/" ) + dmName );
+        }
+    }
 
-QStringList
-ClearMountsJob::getCryptoDevices() const
-{
-    QDir mapperDir( "/dev/mapper" );
-    const QFileInfoList fiList = mapperDir.entryInfoList( QDir::Files );
-    QStringList list;
-    QProcess process;
-    for ( const QFileInfo &fi : fiList )
+    // First unmount. A filesystem mounted inside another one goes with it,
+    // so only the outermost mount points are needed, and those are independent.
+    // Filesystems on a disk that is about to be partitioned must really be
+    // gone, so busy ones are not detached lazily: that is a failure.
+    QStringList unmountFailures;
     {
-        QString baseName = fi.baseName();
-        // Fedora live images use /dev/mapper/live-* internally. We must not
-        // unmount those devices, because they are used by the live image and
-        // because we need /dev/mapper/live-base in the unpackfs module.
-        if ( baseName == "control" || baseName.startsWith( "live-" ) )
-            continue;
-        list.append( fi.absoluteFilePath() );
+        const auto mounts = mountsByDevice();
+        QStringList mountPoints;
+        for ( auto it = devicePaths.constBegin(); it != devicePaths.constEnd(); ++it )
+        {
+            mountPoints.append( mounts.values( it.key() ) );
+        }
+        mountPoints.removeDuplicates();
+        if ( mountPoints.removeAll( QStringLiteral( "/" ) ) )
+        {
+            // Never take the running system down with the disk
+            cWarning() << "The root filesystem is on" << m_device->deviceNode() << "and is not unmounted.";
+            unmountFailures.append( QStringLiteral( "/: the running system is on this disk" ) );
+        }
+        QStringList outermost;
+        for ( const QString& mountPoint : mountPoints )
+        {
+            if ( std::none_of( mountPoints.cbegin(), mountPoints.cend(), [&mountPoint]( const QString& other ) {
+                     return other != mountPoint && mountPoint.startsWith( other + '/' );
+                 } ) )
+            {
+                outermost.append( mountPoint );
+            }
+        }
+        runConcurrently( outermost, [&report, &unmountFailures, &newsMutex]( const QString& mountPoint ) {
+            const QStringList failures = CalamaresUtils::Partition::unmountTree( mountPoint, false );
+            if ( failures.isEmpty() )
+            {
+                report( QString( "Successfully unmounted %1." ).arg( mountPoint ) );
+            }
+            else
+            {
+                cWarning() << "Could not unmount" << failures;
+                QMutexLocker lock( &newsMutex );
+                unmountFailures.append( failures );
+            }
+        } );
+    }
+    if ( !unmountFailures.isEmpty() )
+    {
+        return Calamares::JobResult::error(
+            tr( "Could not unmount the file systems on %1." ).arg( m_device->deviceNode() ),
+            unmountFailures.join( '\n' ) );
     }
-    return list;
+
+    // Then turn off swap
+    {
+        const auto swaps = swapsByDevice();
+        QStringList swapPaths;
+        for ( auto it = devicePaths.constBegin(); it != devicePaths.constEnd(); ++it )
+        {
+            if ( swaps.contains( it.key() ) )
+            {
+                swapPaths.append( swaps.value( it.key() ) );
+            }
+        }
+        runConcurrently( swapPaths, [&report]( const QString& path ) {
+            if ( ::swapoff( QFile::encodeName( path ).constData() ) == 0 )
+            {
+                report( QString( "Successfully disabled swap %1." ).arg( path ) );
+            }
+            else
+            {
+                // strerror() is not thread-safe
+                const int error = errno;
+                cWarning() << "Could not disable swap" << path << qt_error_string( error );
+            }
+        } );
+    }
+
+    // Then close LUKS and deactivate LVM volumes, top of the stack first
+    QSet< QString > volumeGroups;
+    for ( const auto& level : levels )
+    {
+        QStringList mappings;
+        for ( const QString& name : level )
+        {
+            if ( dmNames.contains( name ) )
+            {
+                mappings.append( dmNames.value( name ) );
+                if ( readSysfs( sysClassBlock + name + QStringLiteral( "/dm/uuid" ) ).startsWith( QStringLiteral( "LVM-" ) ) )
+                {
+                    volumeGroups.insert( volumeGroupName( dmNames.value( name ) ) );
+                }
+            }
+        }
+        runConcurrently( mappings, [&report]( const QString& dmName ) {
+            int r = removeMapping( dmName );
+            if ( r == 0 )
+            {
+                report( QString( "Successfully closed mapper device /dev/mapper/%1." ).arg( dmName ) );
+            }
+            else
+            {
+                cWarning() << "Could not close mapper device" << dmName << qt_error_string( r );
+            }
+        } );
+    }
+
+    // Volume groups that also have volumes on other disks are deactivated entirely.
+    volumeGroups.remove( QString() );
+    if ( !volumeGroups.isEmpty() )
+    {
+        QSet< QString > stillActive;
+        for ( const QString& name :
+              QDir( sysClassBlock ).entryList( { QStringLiteral( "dm-*" ) }, QDir::AllEntries | QDir::NoDotAndDotDot ) )
+        {
+            if ( readSysfs( sysClassBlock + name + QStringLiteral( "/dm/uuid" ) ).startsWith( QStringLiteral( "LVM-" ) ) )
+            {
+                stillActive.insert( volumeGroupName( readSysfs( sysClassBlock + name + QStringLiteral( "/dm/name" ) ) ) );
+            }
+        }
+        volumeGroups.intersect( stillActive );
+    }
+    if ( !volumeGroups.isEmpty() )
+    {
+        runConcurrently( volumeGroups.values(), [&report]( const QString& vgName ) {
+            auto r = CalamaresUtils::System::runCommand( { "vgchange", "-an", vgName }, std::chrono::seconds( 60 ) );
+            if ( r.getExitCode() == 0 )
+            {
+                report( QString( "Successfully disabled volume group %1." ).arg( vgName ) );
+            }
+        } );
+    }
+
+    // Finally make sure that no partition holds something resumable
+    // from a previous suspend-to-disk.
+    const int pageSize = static_cast< int >( ::sysconf( _SC_PAGESIZE ) );
+    runConcurrently( partitionsList, [&report, pageSize]( const QString& name ) {
+        const QString path = QStringLiteral( "/dev/" ) + name;
+        if ( clearHibernationSignature( path, pageSize ) )
+        {
+            report( QString( "Successfully cleared swap %1." ).arg( path ) );
+        }
+    } );
+
+    Calamares::JobResult ok = Calamares::JobResult::ok();
+    ok.setMessage( tr( "Cleared all mounts for %1" )
+                        .arg( m_device->deviceNode() ) );
+    ok.setDetails( goodNews.join( "\n" ) );
+
+    cDebug() << "ClearMountsJob finished. Here's what was done:\n" << goodNews.join( "\n" );
+
+    return ok;
 }
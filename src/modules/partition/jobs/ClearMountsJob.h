@@ -26,6 +26,11 @@ class Device;
 /**
  * This job tries to free all mounts for the given device, so partitioning
  * operations can proceed.
+ *
+ * The device-mapper devices (LUKS, LVM) stacked on the device are found
+ * through sysfs. The teardown goes top-down: first filesystems are
+ * unmounted and swap is turned off, then the mappings are removed one
+ * layer at a time. Independent parts of each step run in parallel.
  */
 class ClearMountsJob : public Calamares::Job
 {
@@ -36,10 +41,6 @@ public:
     QString prettyStatusMessage() const override;
     Calamares::JobResult exec() override;
 private:
-    QString tryUmount( const QString& partPath );
-    QString tryClearSwap( const QString& partPath );
-    QString tryCryptoClose( const QString& mapperPath );
-    QStringList getCryptoDevices() const;
     Device* m_device;
 };
 
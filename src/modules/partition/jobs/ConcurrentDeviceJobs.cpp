@@ -0,0 +1,201 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ConcurrentDeviceJobs.h"
+
+#include "core/KPMHelpers.h"
+#include "jobs/CreatePartitionJob.h"
+#include "jobs/FormatPartitionJob.h"
+
+#include "utils/Logger.h"
+#include "utils/Trace.h"
+
+#include <QFuture>
+#include <QtConcurrent/QtConcurrentRun>
+
+/// @brief Does @p job take the backend lock itself (to release it while formatting)?
+static bool
+locksBackendItself( const Calamares::job_ptr& job )
+{
+    return qobject_cast< CreatePartitionJob* >( job.data() ) || qobject_cast< FormatPartitionJob* >( job.data() );
+}
+
+Calamares::JobList
+ConcurrentDeviceJobs::arrange( const QList< Calamares::JobList >& deviceJobs, const QList< bool >& plainDisks )
+{
+    QList< Calamares::JobList > busy;
+    bool allPlainDisks = true;
+    for ( int i = 0; i < deviceJobs.count(); ++i )
+    {
+        if ( !deviceJobs.at( i ).isEmpty() )
+        {
+            busy << deviceJobs.at( i );
+            allPlainDisks = allPlainDisks && plainDisks.value( i, false );
+        }
+    }
+
+    Calamares::JobList l;
+    if ( allPlainDisks && busy.count() > 1 )
+    {
+        l << Calamares::job_ptr( new ConcurrentDeviceJobs( busy ) );
+    }
+    else
+    {
+        for ( const auto& jobs : busy )
+        {
+            l << jobs;
+        }
+    }
+    return l;
+}
+
+ConcurrentDeviceJobs::ConcurrentDeviceJobs( const QList< Calamares::JobList >& deviceJobs )
+    : Calamares::Job()
+    , m_deviceJobs( deviceJobs )
+    , m_progress( deviceJobs.count(), 0.0 )
+{
+}
+
+QString
+ConcurrentDeviceJobs::prettyName() const
+{
+    return tr( "Partition %n disk(s) at the same time.", "", m_deviceJobs.count() );
+}
+
+QString
+ConcurrentDeviceJobs::prettyDescription() const
+{
+    QStringList descriptions;
+    for ( const auto& jobs : m_deviceJobs )
+    {
+        for ( const auto& job : jobs )
+        {
+            const QString d = job->prettyDescription();
+            if ( !d.isEmpty() )
+            {
+                descriptions.append( d );
+            }
+        }
+    }
+    return descriptions.join( QStringLiteral( "<br/>" ) );
+}
+
+QString
+ConcurrentDeviceJobs::prettyStatusMessage() const
+{
+    QMutexLocker lock( &m_mutex );
+    return m_status.isEmpty() ? prettyName() : m_status;
+}
+
+qreal
+ConcurrentDeviceJobs::getJobWeight() const
+{
+    qreal weight = 0.0;
+    for ( const auto& jobs : m_deviceJobs )
+    {
+        for ( const auto& job : jobs )
+        {
+            weight += job->getJobWeight();
+        }
+    }
+    return weight;
+}
+
+void
+ConcurrentDeviceJobs::reportProgress( int index, qreal done )
+{
+    qreal total = 0.0;
+    {
+        QMutexLocker lock( &m_mutex );
+        m_progress[ index ] = done;
+        for ( qreal p : m_progress )
+        {
+            total += p;
+        }
+    }
+    const qreal weight = getJobWeight();
+    emit progress( weight > 0 ? total / weight : 1.0 );
+}
+
+ConcurrentDeviceJobs::Outcome
+ConcurrentDeviceJobs::runDevice( int index )
+{
+    qreal done = 0.0;
+    for ( const auto& job : m_deviceJobs.at( index ) )
+    {
+        {
+            QMutexLocker lock( &m_mutex );
+            m_status = job->prettyStatusMessage();
+        }
+        reportProgress( index, done );
+
+        cDebug() << "Starting concurrent job" << job->prettyName();
+        CalamaresUtils::Trace::Span span( "job", job->prettyName() );
+        QMutexLocker lock( &KPMHelpers::backendLock() );
+        auto* partitionJob = qobject_cast< PartitionJob* >( job.data() );
+        if ( partitionJob )
+        {
+            partitionJob->setConcurrent( true );
+        }
+        if ( locksBackendItself( job ) )
+        {
+            lock.unlock();
+        }
+        Calamares::JobResult result = job->exec();
+        lock.unlock();
+        if ( partitionJob )
+        {
+            partitionJob->setConcurrent( false );
+        }
+
+        if ( !result )
+        {
+            cWarning() << "Concurrent job" << job->prettyName() << "failed, skipping the rest for this device.";
+            Outcome failure;
+            failure.ok = false;
+            failure.message = result.message();
+            failure.details = result.details();
+            return failure;
+        }
+        done += job->getJobWeight();
+    }
+    reportProgress( index, done );
+    return Outcome();
+}
+
+Calamares::JobResult
+ConcurrentDeviceJobs::exec()
+{
+    QList< QFuture< Outcome > > running;
+    for ( int i = 0; i < m_deviceJobs.count(); ++i )
+    {
+        running.append( QtConcurrent::run( [this, i]() { return runDevice( i ); } ) );
+    }
+
+    for ( auto& f : running )
+    {
+        f.waitForFinished();
+    }
+    for ( const auto& f : running )
+    {
+        const Outcome o = f.result();
+        if ( !o.ok )
+        {
+            return Calamares::JobResult::error( o.message, o.details );
+        }
+    }
+    return Calamares::JobResult::ok();
+}
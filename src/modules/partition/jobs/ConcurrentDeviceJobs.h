@@ -0,0 +1,84 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONCURRENTDEVICEJOBS_H
+#define CONCURRENTDEVICEJOBS_H
+
+#include "Job.h"
+
+#include <QMutex>
+#include <QVector>
+
+/**
+ * Runs the partitioning jobs of several devices at the same time.
+ *
+ * Each device has its own list of jobs, which is run in order; the
+ * lists for different devices run concurrently. Jobs that use the
+ * KPMcore backend hold KPMHelpers::backendLock() while they do so;
+ * creating and formatting partitions release it while the file-system
+ * tools run (with KPMcore 3), which is where the time goes.
+ *
+ * If a job fails, the rest of that device's jobs are skipped; the
+ * other devices finish what they are doing. The first failure (in
+ * device order) is the result of this job.
+ *
+ * KPMcore is only ever used by one thread at a time: see
+ * KPMHelpers::backendLock() for what runs concurrently.
+ */
+class ConcurrentDeviceJobs : public Calamares::Job
+{
+    Q_OBJECT
+public:
+    explicit ConcurrentDeviceJobs( const QList< Calamares::JobList >& deviceJobs );
+
+    /** @brief The jobs to run for @p deviceJobs (one list per device)
+     *
+     * Devices without jobs are left out. If more than one device has
+     * jobs, and all of those are plain disks (according to @p plainDisks,
+     * one entry per device), they go into a single ConcurrentDeviceJobs.
+     * Otherwise -- volume groups tie disks together -- the jobs are
+     * returned one device after the other.
+     */
+    static Calamares::JobList arrange( const QList< Calamares::JobList >& deviceJobs, const QList< bool >& plainDisks );
+
+    QString prettyName() const override;
+    /// @brief The descriptions of all the jobs, one per line
+    QString prettyDescription() const override;
+    QString prettyStatusMessage() const override;
+    /// @brief The sum of the weights of all the jobs
+    qreal getJobWeight() const override;
+    Calamares::JobResult exec() override;
+
+private:
+    /// @brief What went wrong on one device (JobResult can't be copied)
+    struct Outcome
+    {
+        bool ok = true;
+        QString message;
+        QString details;
+    };
+
+    Outcome runDevice( int index );
+    void reportProgress( int index, qreal done );
+
+    QList< Calamares::JobList > m_deviceJobs;
+
+    mutable QMutex m_mutex;  // For the members below
+    QVector< qreal > m_progress;  ///< Weight of finished jobs, per device
+    QString m_status;
+};
+
+#endif  // CONCURRENTDEVICEJOBS_H
@@ -20,6 +20,8 @@
 
 #include "CreatePartitionJob.h"
 
+#include "core/KPMHelpers.h"
+
 #include "partition/FileSystem.h"
 #include "utils/Logger.h"
 #include "utils/Units.h"
@@ -29,9 +31,14 @@
 #include <kpmcore/core/partition.h>
 #include <kpmcore/core/partitiontable.h>
 #include <kpmcore/fs/filesystem.h>
+#include <kpmcore/fs/filesystemfactory.h>
 #include <kpmcore/ops/newoperation.h>
 #include <kpmcore/util/report.h>
 
+#include <QMutex>
+
+#include <memory>
+
 using CalamaresUtils::Partition::untranslatedFS;
 using CalamaresUtils::Partition::userVisibleFS;
 
@@ -76,11 +83,38 @@ Calamares::JobResult
 CreatePartitionJob::exec()
 {
     Report report( nullptr );
-    NewOperation op(*m_device, m_partition);
-    op.setStatus(Operation::StatusRunning);
-
     QString message = tr( "The installer failed to create partition on disk '%1'." ).arg( m_device->name() );
-    if (op.execute(report))
+
+    if ( !m_concurrent || !KPMHelpers::canFormatDirectly( m_partition ) )
+    {
+        QMutexLocker lock( &KPMHelpers::backendLock() );
+        NewOperation op(*m_device, m_partition);
+        op.setStatus(Operation::StatusRunning);
+
+        if (op.execute(report))
+            return Calamares::JobResult::ok();
+
+        return Calamares::JobResult::error(message, report.toText());
+    }
+
+    // Create the partition with a placeholder (unformatted) file system
+    // while holding the backend lock, then put the real file system back
+    // and create it with formatPartition(), which only takes the lock where
+    // it must (see KPMHelpers::backendLock()).
+    FileSystem* fs = &m_partition->fileSystem();
+    std::unique_ptr< FileSystem > placeholder( FileSystemFactory::create(
+        FileSystem::Unformatted, fs->firstSector(), fs->lastSector(), fs->sectorSize() ) );
+    bool created = false;
+    {
+        QMutexLocker lock( &KPMHelpers::backendLock() );
+        m_partition->setFileSystem( placeholder.get() );
+        NewOperation op( *m_device, m_partition );
+        op.setStatus( Operation::StatusRunning );
+        created = op.execute( report );
+        m_partition->setFileSystem( fs );
+    }
+
+    if ( created && KPMHelpers::formatPartition( m_device, m_partition, report ) )
         return Calamares::JobResult::ok();
 
     return Calamares::JobResult::error(message, report.toText());
@@ -20,6 +20,8 @@
 
 #include "FormatPartitionJob.h"
 
+#include "core/KPMHelpers.h"
+
 #include "partition/FileSystem.h"
 #include "utils/Logger.h"
 
@@ -30,6 +32,8 @@
 #include <kpmcore/ops/createfilesystemoperation.h>
 #include <kpmcore/util/report.h>
 
+#include <QMutex>
+
 using CalamaresUtils::Partition::untranslatedFS;
 using CalamaresUtils::Partition::userVisibleFS;
 
@@ -75,11 +79,21 @@ Calamares::JobResult
 FormatPartitionJob::exec()
 {
     Report report( nullptr );  // Root of the report tree, no parent
+    QString message = tr( "The installer failed to format partition %1 on disk '%2'." ).arg( m_partition->partitionPath(), m_device->name() );
+
+    // formatPartition() only takes the backend lock where it must, so
+    // that other disks can be partitioned or formatted meanwhile.
+    if ( m_concurrent && KPMHelpers::canFormatDirectly( m_partition ) )
+    {
+        if ( KPMHelpers::formatPartition( m_device, m_partition, report ) )
+            return Calamares::JobResult::ok();
+        return Calamares::JobResult::error( message, report.toText() );
+    }
+
+    QMutexLocker lock( &KPMHelpers::backendLock() );
     CreateFileSystemOperation op(*m_device, *m_partition, m_partition->fileSystem().type());
     op.setStatus(Operation::StatusRunning);
 
-    QString message = tr( "The installer failed to format partition %1 on disk '%2'." ).arg( m_partition->partitionPath(), m_device->name() );
-
     if (op.execute(report))
         return Calamares::JobResult::ok();
 
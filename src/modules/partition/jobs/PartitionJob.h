@@ -39,6 +39,17 @@ public:
         return m_partition;
     }
 
+    /** @brief Is this job run by ConcurrentDeviceJobs?
+     *
+     * Jobs that create file systems only use KPMHelpers::formatPartition()
+     * when they run concurrently with the jobs for other devices; otherwise
+     * they use KPMcore's operations.
+     */
+    void setConcurrent( bool concurrent )
+    {
+        m_concurrent = concurrent;
+    }
+
 public slots:
     /** @brief Translate from KPMCore to Calamares progress.
      *
@@ -50,6 +61,7 @@ public slots:
 protected:
     CalamaresUtils::Partition::KPMManager m_kpmcore;
     Partition* m_partition;
+    bool m_concurrent = false;
 };
 
 #endif /* PARTITIONJOB_H */
@@ -20,6 +20,8 @@
 
 #include "utils/Logger.h"
 
+#include <QTemporaryDir>
+#include <QTemporaryFile>
 #include <QtTest/QtTest>
 
 QTEST_GUILESS_MAIN( ClearMountsJobTests )
@@ -29,6 +31,12 @@ QTEST_GUILESS_MAIN( ClearMountsJobTests )
 QStringList
 getPartitionsForDevice( const QString& deviceName );
 
+QList< QStringList >
+getTeardownLevels( const QStringList& roots, const QString& sysClassBlock );
+
+bool
+clearHibernationSignature( const QString& path, int pageSize );
+
 QStringList
 getPartitionsForDevice_other(const QString& deviceName)
 {
@@ -64,3 +72,69 @@ void ClearMountsJobTests::testFindPartitions()
 
     QCOMPARE( partitions, other_part );
 }
+
+static void
+writeSysfs( const QDir& d, const QString& path, const QByteArray& value = QByteArray() )
+{
+    QFileInfo fi( d.filePath( path ) );
+    QVERIFY( d.mkpath( fi.path() ) );
+    QFile f( fi.filePath() );
+    QVERIFY( f.open( QIODevice::WriteOnly ) );
+    f.write( value );
+}
+
+void ClearMountsJobTests::testTeardownLevels()
+{
+    QTemporaryDir tempRoot;
+    QVERIFY( tempRoot.isValid() );
+    QDir sys( tempRoot.path() );
+
+    // sda1 holds LUKS, with LVM inside; sda2 is plain;
+    // sda3 is used by the live system.
+    writeSysfs( sys, "sda1/holders/dm-0" );
+    writeSysfs( sys, "dm-0/dm/name", "luks-1234" );
+    writeSysfs( sys, "dm-0/holders/dm-1" );
+    writeSysfs( sys, "dm-0/holders/dm-2" );
+    writeSysfs( sys, "dm-1/dm/name", "vg-root" );
+    writeSysfs( sys, "dm-2/dm/name", "vg-home" );
+    writeSysfs( sys, "sda2/dev", "8:2" );
+    writeSysfs( sys, "sda3/holders/dm-3" );
+    writeSysfs( sys, "dm-3/dm/name", "live-rw" );
+
+    const auto levels = getTeardownLevels( { "sda", "sda1", "sda2", "sda3" }, sys.path() );
+    QCOMPARE( levels.count(), 3 );
+    QCOMPARE( levels.at( 0 ), QStringList( { "dm-1", "dm-2", "sda", "sda2", "sda3" } ) );
+    QCOMPARE( levels.at( 1 ), QStringList { "dm-0" } );
+    QCOMPARE( levels.at( 2 ), QStringList { "sda1" } );
+
+    QVERIFY( getTeardownLevels( {}, sys.path() ).isEmpty() );
+}
+
+void ClearMountsJobTests::testClearHibernation()
+{
+    const int pageSize = 4096;
+    QByteArray page( pageSize, '\0' );
+    page.replace( 1036, 16, QByteArray::fromHex( "0123456789abcdef0123456789abcdef" ) );
+    page.replace( pageSize - 20, 20, QByteArray( "SWAPSPACE2S1SUSPEND", 20 ) );  // Includes the NUL
+
+    QTemporaryFile f;
+    QVERIFY( f.open() );
+    f.write( page );
+    f.close();
+
+    QVERIFY( clearHibernationSignature( f.fileName(), pageSize ) );
+    QVERIFY( f.open() );
+    const QByteArray cleared = f.readAll();
+    f.close();
+    QCOMPARE( cleared.size(), pageSize );
+    QCOMPARE( cleared.right( 20 ), QByteArray( "SWAPSPACE2SWAPSPACE2" ) );
+    QCOMPARE( cleared.left( pageSize - 10 ), page.left( pageSize - 10 ) );
+
+    // Plain swap is left alone
+    QVERIFY( !clearHibernationSignature( f.fileName(), pageSize ) );
+    // So are files that are too short
+    QVERIFY( f.open() );
+    f.resize( 100 );
+    f.close();
+    QVERIFY( !clearHibernationSignature( f.fileName(), pageSize ) );
+}
@@ -29,6 +29,8 @@ public:
 
 private Q_SLOTS:
     void testFindPartitions();
+    void testTeardownLevels();
+    void testClearHibernation();
 };
 
 #endif
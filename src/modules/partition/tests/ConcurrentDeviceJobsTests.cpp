@@ -0,0 +1,177 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ConcurrentDeviceJobsTests.h"
+
+#include "jobs/ConcurrentDeviceJobs.h"
+
+#include "utils/Logger.h"
+
+#include <QMutex>
+#include <QRegularExpression>
+#include <QThread>
+#include <QtTest/QtTest>
+
+QTEST_GUILESS_MAIN( ConcurrentDeviceJobsTests )
+
+/// @brief Job that logs its name when it runs, and can fail
+class DummyJob : public Calamares::Job
+{
+public:
+    DummyJob( const QString& name, QStringList& log, QMutex& mutex, bool fail = false )
+        : m_name( name )
+        , m_log( log )
+        , m_mutex( mutex )
+        , m_fail( fail )
+    {
+    }
+
+    QString prettyName() const override { return m_name; }
+    QString prettyDescription() const override { return m_name.startsWith( 'b' ) ? QString() : m_name + '!'; }
+
+    Calamares::JobResult exec() override
+    {
+        QThread::msleep( 20 );  // Give the other devices a chance
+        {
+            QMutexLocker lock( &m_mutex );
+            m_log.append( m_name );
+        }
+        return m_fail ? Calamares::JobResult::error( m_name, QStringLiteral( "details" ) )
+                      : Calamares::JobResult::ok();
+    }
+
+private:
+    QString m_name;
+    QStringList& m_log;
+    QMutex& m_mutex;
+    bool m_fail;
+};
+
+/// @brief Jobs named @p prefix followed by 1 .. @p count; job @p failing (if any) fails
+static Calamares::JobList
+dummyJobs( const QString& prefix, int count, QStringList& log, QMutex& mutex, int failing = 0 )
+{
+    Calamares::JobList l;
+    for ( int i = 1; i <= count; ++i )
+    {
+        l << Calamares::job_ptr( new DummyJob( prefix + QString::number( i ), log, mutex, i == failing ) );
+    }
+    return l;
+}
+
+static bool
+isConcurrent( const Calamares::job_ptr& job )
+{
+    return qobject_cast< ConcurrentDeviceJobs* >( job.data() );
+}
+
+ConcurrentDeviceJobsTests::ConcurrentDeviceJobsTests() {}
+
+void
+ConcurrentDeviceJobsTests::initTestCase()
+{
+    Logger::setupLogLevel( Logger::LOGDEBUG );
+}
+
+void
+ConcurrentDeviceJobsTests::testArrange()
+{
+    QStringList log;
+    QMutex mutex;
+    const auto a = dummyJobs( "a", 2, log, mutex );
+    const auto b = dummyJobs( "b", 3, log, mutex );
+
+    // Only one device with jobs: nothing to do concurrently
+    auto l = ConcurrentDeviceJobs::arrange( { a, Calamares::JobList() }, { true, true } );
+    QCOMPARE( l, a );
+    l = ConcurrentDeviceJobs::arrange( { Calamares::JobList(), b }, { true, true } );
+    QCOMPARE( l, b );
+
+    // Two disks
+    l = ConcurrentDeviceJobs::arrange( { a, Calamares::JobList(), b }, { true, false, true } );
+    QCOMPARE( l.count(), 1 );
+    QVERIFY( isConcurrent( l.first() ) );
+    QCOMPARE( l.first()->getJobWeight(), 5.0 );
+
+    // A disk and a volume group: in order
+    l = ConcurrentDeviceJobs::arrange( { a, b }, { true, false } );
+    QCOMPARE( l, a + b );
+    l = ConcurrentDeviceJobs::arrange( { b, a }, { false, true } );
+    QCOMPARE( l, b + a );
+
+    QVERIFY( ConcurrentDeviceJobs::arrange( {}, {} ).isEmpty() );
+    QVERIFY( log.isEmpty() );  // Nothing was run
+}
+
+void
+ConcurrentDeviceJobsTests::testOrder()
+{
+    QStringList log;
+    QMutex mutex;
+    const auto a = dummyJobs( "a", 4, log, mutex );
+    const auto b = dummyJobs( "b", 3, log, mutex );
+    const auto c = dummyJobs( "c", 2, log, mutex );
+
+    ConcurrentDeviceJobs job( { a, b, c } );
+    QVERIFY( job.exec() );
+
+    QCOMPARE( log.count(), 9 );
+    for ( const QString& prefix : { QStringLiteral( "a" ), QStringLiteral( "b" ), QStringLiteral( "c" ) } )
+    {
+        // Each device's jobs ran in order
+        const QStringList ran = log.filter( QRegularExpression( '^' + prefix ) );
+        QStringList expected;
+        for ( int i = 1; i <= ran.count(); ++i )
+        {
+            expected << prefix + QString::number( i );
+        }
+        QCOMPARE( ran, expected );
+    }
+}
+
+void
+ConcurrentDeviceJobsTests::testFailure()
+{
+    QStringList log;
+    QMutex mutex;
+    const auto a = dummyJobs( "a", 4, log, mutex, 2 );
+    const auto b = dummyJobs( "b", 3, log, mutex );
+    const auto c = dummyJobs( "c", 3, log, mutex, 1 );
+
+    ConcurrentDeviceJobs job( { a, b, c } );
+    auto result = job.exec();
+    QVERIFY( !result );
+    // The first failure in device order, not in time
+    QCOMPARE( result.message(), QStringLiteral( "a2" ) );
+    QCOMPARE( result.details(), QStringLiteral( "details" ) );
+
+    // Jobs after a failure are skipped, other devices finish
+    QCOMPARE( log.filter( QRegularExpression( "^a" ) ), QStringList( { "a1", "a2" } ) );
+    QCOMPARE( log.filter( QRegularExpression( "^b" ) ), QStringList( { "b1", "b2", "b3" } ) );
+    QCOMPARE( log.filter( QRegularExpression( "^c" ) ), QStringList( { "c1" } ) );
+}
+
+void
+ConcurrentDeviceJobsTests::testDescription()
+{
+    QStringList log;
+    QMutex mutex;
+
+    // The b jobs have no description
+    ConcurrentDeviceJobs job(
+        { dummyJobs( "a", 2, log, mutex ), dummyJobs( "b", 1, log, mutex ), dummyJobs( "c", 1, log, mutex ) } );
+    QCOMPARE( job.prettyDescription(), QStringLiteral( "a1!<br/>a2!<br/>c1!" ) );
+}
@@ -0,0 +1,36 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CONCURRENTDEVICEJOBSTESTS_H
+#define CONCURRENTDEVICEJOBSTESTS_H
+
+#include <QObject>
+
+class ConcurrentDeviceJobsTests : public QObject
+{
+    Q_OBJECT
+public:
+    ConcurrentDeviceJobsTests();
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testArrange();
+    void testOrder();
+    void testFailure();
+    void testDescription();
+};
+
+#endif
@@ -62,6 +62,8 @@ class PlymouthController:
             if (("plymouth_theme" in libcalamares.job.configuration) and
                (libcalamares.job.configuration["plymouth_theme"] is not None)):
                 self.setTheme()
+                # The theme is part of the initramfs
+                libcalamares.utils.request_initramfs("plymouthcfg")
         return None
 
 
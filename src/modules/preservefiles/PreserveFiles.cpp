@@ -26,12 +26,8 @@
 
 #include "utils/CalamaresUtilsSystem.h"
 #include "utils/CommandList.h"
+#include "utils/Files.h"
 #include "utils/Logger.h"
-#include "utils/Units.h"
-
-#include <QFile>
-
-using CalamaresUtils::operator""_MiB;
 
 QString targetPrefix()
 {
@@ -84,38 +80,6 @@ PreserveFiles::prettyName() const
     return tr( "Saving files for later ..." );
 }
 
-static bool
-copy_file( const QString& source, const QString& dest )
-{
-    QFile sourcef( source );
-    if ( !sourcef.open( QFile::ReadOnly ) )
-    {
-        cWarning() << "Could not read" << source;
-        return false;
-    }
-
-    QFile destf( dest );
-    if ( !destf.open( QFile::WriteOnly ) )
-    {
-        sourcef.close();
-        cWarning() << "Could not open" << destf.fileName() << "for writing; could not copy" << source;
-        return false;
-    }
-
-    QByteArray b;
-    do
-    {
-        b = sourcef.read( 1_MiB );
-        destf.write( b );
-    }
-    while ( b.count() > 0 );
-
-    sourcef.close();
-    destf.close();
-
-    return true;
-}
-
 Calamares::JobResult PreserveFiles::exec()
 {
     if ( m_items.isEmpty() )
@@ -145,25 +109,18 @@ Calamares::JobResult PreserveFiles::exec()
             cWarning() << "Skipping unnamed source file for" << dest;
         else
         {
-            if ( copy_file( source, dest ) )
+            // The mode is set as the file is created; the names for chown are looked up in the target
+            if ( CalamaresUtils::copyFile( source, dest, it.perm.isValid() ? it.perm.value() : -1 )
+                 != CalamaresUtils::CopyMethod::Failed )
             {
                 if ( it.perm.isValid() )
                 {
                     auto s_p = CalamaresUtils::System::instance();
 
-                    int r;
-
-                    r = s_p->targetEnvCall( QStringList{ "chown", it.perm.username(), bare_dest } );
+                    int r = s_p->targetEnvCall(
+                        QStringList{ "chown", it.perm.username() + ':' + it.perm.group(), bare_dest } );
                     if ( r )
                         cWarning() << "Could not chown target" << bare_dest;
-
-                    r = s_p->targetEnvCall( QStringList{ "chgrp", it.perm.group(), bare_dest } );
-                    if ( r )
-                        cWarning() << "Could not chgrp target" << bare_dest;
-
-                    r = s_p->targetEnvCall( QStringList{ "chmod", it.perm.octal(), bare_dest } );
-                    if ( r )
-                        cWarning() << "Could not chmod target" << bare_dest;
                 }
 
                 ++count;
@@ -171,6 +128,10 @@ Calamares::JobResult PreserveFiles::exec()
         }
     }
 
+    // One sync for all the files, rather than one each
+    if ( count && !CalamaresUtils::syncFilesystem( prefix ) )
+        cWarning() << "Could not sync" << prefix;
+
     return count == m_items.count() ?
         Calamares::JobResult::ok() :
         Calamares::JobResult::error( tr( "Not all of the configured files could be preserved." ) );
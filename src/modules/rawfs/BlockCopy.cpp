@@ -0,0 +1,521 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BlockCopy.h"
+
+#include "utils/Logger.h"
+
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+/// @brief Size of each buffer going from the reader to the writer
+static constexpr qint64 bufferSize = 8 * 1024 * 1024;
+/// @brief Number of buffers; the reader can be this far ahead of the writer
+static constexpr int bufferCount = 4;
+
+static qint64
+alignUp( qint64 value, qint64 align )
+{
+    return ( value + align - 1 ) / align * align;
+}
+
+namespace
+{
+/// @brief A filled buffer, to be written at @c offset
+struct Chunk
+{
+    char* data = nullptr;
+    qint64 offset = 0;
+    qint64 length = 0;
+};
+
+/** @brief Buffers going round from the reader to the writer and back
+ *
+ * The reader takes empty buffers and puts filled ones; the writer
+ * takes the filled buffers and gives them back once written. Either
+ * side can stop the other one: the reader with finish() (at the end,
+ * or on a read error), the writer with abort() (on a write error).
+ */
+class Pipeline
+{
+public:
+    Pipeline()
+    {
+        for ( int i = 0; i < bufferCount; ++i )
+        {
+            void* p = nullptr;
+            if ( posix_memalign( &p, BlockCopy::alignment, bufferSize ) == 0 )
+            {
+                m_buffers.append( static_cast< char* >( p ) );
+                m_free.enqueue( static_cast< char* >( p ) );
+            }
+        }
+    }
+    ~Pipeline()
+    {
+        for ( char* p : m_buffers )
+        {
+            free( p );
+        }
+    }
+
+    bool isValid() const { return !m_buffers.isEmpty(); }
+
+    /// @brief An empty buffer for the reader, or nullptr if the writer has given up
+    char* takeFree()
+    {
+        QMutexLocker lock( &m_mutex );
+        while ( m_free.isEmpty() && !m_aborted )
+        {
+            m_changed.wait( &m_mutex );
+        }
+        return m_aborted ? nullptr : m_free.dequeue();
+    }
+    void giveFree( char* buffer )
+    {
+        QMutexLocker lock( &m_mutex );
+        m_free.enqueue( buffer );
+        m_changed.wakeAll();
+    }
+
+    void put( const Chunk& chunk )
+    {
+        QMutexLocker lock( &m_mutex );
+        m_full.enqueue( chunk );
+        m_changed.wakeAll();
+    }
+    /// @brief The next filled buffer for the writer; false once there are no more
+    bool take( Chunk& chunk )
+    {
+        QMutexLocker lock( &m_mutex );
+        while ( m_full.isEmpty() && !m_finished && !m_aborted )
+        {
+            m_changed.wait( &m_mutex );
+        }
+        if ( m_full.isEmpty() || m_aborted )
+        {
+            return false;
+        }
+        chunk = m_full.dequeue();
+        return true;
+    }
+
+    /// @brief The reader is done; @p error is 0 or an errno value
+    void finish( int error )
+    {
+        QMutexLocker lock( &m_mutex );
+        m_finished = true;
+        m_readError = error;
+        m_changed.wakeAll();
+    }
+    /// @brief The writer is done, early
+    void abort()
+    {
+        QMutexLocker lock( &m_mutex );
+        m_aborted = true;
+        m_changed.wakeAll();
+    }
+    int readError()
+    {
+        QMutexLocker lock( &m_mutex );
+        return m_readError;
+    }
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_changed;
+    QList< char* > m_buffers;
+    QQueue< char* > m_free;
+    QQueue< Chunk > m_full;
+    bool m_finished = false;
+    bool m_aborted = false;
+    int m_readError = 0;
+};
+}  // namespace
+
+/** @brief Read @p length bytes at @p offset
+ *
+ * With direct I/O the read is rounded up to the alignment, which is
+ * fine because the buffers are multiples of it; only the end of the
+ * source can return less than that.
+ */
+static int
+readFully( int fd, char* buffer, qint64 length, qint64 offset )
+{
+    const qint64 want = std::min( alignUp( length, BlockCopy::alignment ), bufferSize );
+    qint64 done = 0;
+    while ( done < length )
+    {
+        ssize_t r = ::pread( fd, buffer + done, static_cast< size_t >( want - done ), offset + done );
+        if ( r < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            return errno;
+        }
+        if ( r == 0 )
+        {
+            return EIO;  // The source is shorter than it was
+        }
+        done += r;
+    }
+    return 0;
+}
+
+static int
+writeFully( int fd, const char* buffer, qint64 length, qint64 offset )
+{
+    qint64 done = 0;
+    while ( done < length )
+    {
+        ssize_t r = ::pwrite( fd, buffer + done, static_cast< size_t >( length - done ), offset + done );
+        if ( r < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            return errno;
+        }
+        done += r;
+    }
+    return 0;
+}
+
+/// @brief Size of the file or block device @p fd, or -1 (and errno set)
+static qint64
+sizeOf( int fd, bool& isDevice )
+{
+    struct stat st;
+    if ( ::fstat( fd, &st ) != 0 )
+    {
+        return -1;
+    }
+    isDevice = S_ISBLK( st.st_mode );
+#ifdef Q_OS_LINUX
+    if ( isDevice )
+    {
+        quint64 size = 0;
+        return ::ioctl( fd, BLKGETSIZE64, &size ) == 0 ? static_cast< qint64 >( size ) : -1;
+    }
+#endif
+    return st.st_size;
+}
+
+BlockCopy::BlockCopy( const QString& source, const QString& destination )
+    : m_source( source )
+    , m_destination( destination )
+{
+}
+
+BlockCopy::~BlockCopy()
+{
+    if ( m_sourceFd >= 0 )
+    {
+        ::close( m_sourceFd );
+    }
+    if ( m_destinationFd >= 0 )
+    {
+        ::close( m_destinationFd );
+    }
+}
+
+int
+BlockCopy::open()
+{
+    int direct = 0;
+#ifdef O_DIRECT
+    direct = m_direct ? O_DIRECT : 0;
+#endif
+
+    m_sourceFd = ::open( QFile::encodeName( m_source ).constData(), O_RDONLY | O_CLOEXEC | direct );
+    if ( m_sourceFd < 0 )
+    {
+        return errno;
+    }
+    bool sourceIsDevice = false;
+    m_sourceSize = sizeOf( m_sourceFd, sourceIsDevice );
+    if ( m_sourceSize < 0 )
+    {
+        return errno;
+    }
+
+    m_destinationFd = ::open( QFile::encodeName( m_destination ).constData(), O_WRONLY | O_CLOEXEC | direct );
+    if ( m_destinationFd < 0 )
+    {
+        return errno;
+    }
+    m_destinationSize = sizeOf( m_destinationFd, m_destinationIsDevice );
+    if ( m_destinationSize < 0 )
+    {
+        return errno;
+    }
+    if ( !m_destinationIsDevice )
+    {
+        // A file can grow to whatever size the source has
+        m_destinationSize = std::max( m_destinationSize, m_sourceSize );
+    }
+
+    m_extents = dataExtents( m_sourceFd, m_sourceSize );
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise( m_sourceFd, 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+    return 0;
+}
+
+qint64
+BlockCopy::dataSize() const
+{
+    qint64 size = 0;
+    for ( const auto& e : m_extents )
+    {
+        size += e.length;
+    }
+    return size;
+}
+
+BlockCopy::ExtentList
+BlockCopy::dataExtents( int fd, qint64 size, qint64 align )
+{
+    ExtentList extents;
+    auto add = [&extents, size, align]( qint64 start, qint64 end ) {
+        start = start / align * align;
+        end = std::min( size, alignUp( end, align ) );
+        if ( !extents.isEmpty() && start <= extents.last().offset + extents.last().length )
+        {
+            extents.last().length = end - extents.last().offset;
+        }
+        else
+        {
+            extents.append( Extent { start, end - start } );
+        }
+    };
+
+#if defined( SEEK_DATA ) && defined( SEEK_HOLE )
+    qint64 position = 0;
+    while ( position < size )
+    {
+        off_t data = ::lseek( fd, position, SEEK_DATA );
+        if ( data < 0 )
+        {
+            if ( errno != ENXIO )
+            {
+                // Can't tell, so assume the rest is data
+                add( position, size );
+            }
+            // ENXIO means there is no more data
+            break;
+        }
+        off_t hole = ::lseek( fd, data, SEEK_HOLE );
+        if ( hole < 0 || hole > size )
+        {
+            hole = size;
+        }
+        add( data, hole );
+        position = hole;
+    }
+#else
+    Q_UNUSED( fd )
+    if ( size > 0 )
+    {
+        add( 0, size );
+    }
+#endif
+    return extents;
+}
+
+int
+BlockCopy::copy( const ProgressFunction& progress )
+{
+    if ( m_sourceFd < 0 || m_destinationFd < 0 )
+    {
+        return EBADF;
+    }
+    if ( m_destinationSize < m_sourceSize )
+    {
+        return ENOSPC;
+    }
+    if ( !m_destinationIsDevice )
+    {
+        // Start from an empty file so the skipped regions read as zeroes
+        if ( ::ftruncate( m_destinationFd, 0 ) != 0 || ::ftruncate( m_destinationFd, m_sourceSize ) != 0 )
+        {
+            return errno;
+        }
+    }
+
+    Pipeline pipeline;
+    if ( !pipeline.isValid() )
+    {
+        return ENOMEM;
+    }
+
+    // A pool of its own, so the reader can't be queued behind other tasks while the writer waits;
+    // the hashing of each buffer runs there too.
+    QThreadPool readerPool;
+    readerPool.setMaxThreadCount( 2 );
+    const int sourceFd = m_sourceFd;
+    const ExtentList extents = m_extents;
+    QFuture< void > reader = QtConcurrent::run( &readerPool, [&pipeline, sourceFd, extents]() {
+        for ( const auto& e : extents )
+        {
+            for ( qint64 offset = e.offset; offset < e.offset + e.length; offset += bufferSize )
+            {
+                char* buffer = pipeline.takeFree();
+                if ( !buffer )
+                {
+                    return;
+                }
+                const qint64 length = std::min( bufferSize, e.offset + e.length - offset );
+                int r = readFully( sourceFd, buffer, length, offset );
+                if ( r )
+                {
+                    pipeline.giveFree( buffer );
+                    pipeline.finish( r );
+                    return;
+                }
+                pipeline.put( Chunk { buffer, offset, length } );
+            }
+        }
+        pipeline.finish( 0 );
+    } );
+
+    int error = 0;
+    qint64 written = 0;
+    m_hashed = 0;
+    m_hashResult.clear();
+    if ( m_hash )
+    {
+        m_hash->reset();
+    }
+    Chunk chunk;
+    while ( pipeline.take( chunk ) )
+    {
+        QFuture< void > hashing;
+        if ( m_hash )
+        {
+            hashing = QtConcurrent::run( &readerPool, [this, chunk]() {
+                hashZeroes( chunk.offset );
+                m_hash->addData( chunk.data, static_cast< int >( chunk.length ) );
+                m_hashed = chunk.offset + chunk.length;
+            } );
+        }
+#ifdef O_DIRECT
+        if ( m_direct && chunk.length % alignment )
+        {
+            // The unaligned tail of the source can't be written directly
+            ::fcntl( m_destinationFd, F_SETFL, ::fcntl( m_destinationFd, F_GETFL ) & ~O_DIRECT );
+        }
+#endif
+        error = writeFully( m_destinationFd, chunk.data, chunk.length, chunk.offset );
+        hashing.waitForFinished();
+        pipeline.giveFree( chunk.data );
+        if ( error )
+        {
+            pipeline.abort();
+            break;
+        }
+        written += chunk.length;
+        if ( progress )
+        {
+            progress( written );
+        }
+    }
+    reader.waitForFinished();
+    if ( !error )
+    {
+        error = pipeline.readError();
+    }
+    if ( !error && m_destinationIsDevice && m_zeroHoles )
+    {
+        error = zeroHoles();
+    }
+    if ( !error && ::fdatasync( m_destinationFd ) != 0 )
+    {
+        error = errno;
+    }
+    if ( !error && m_hash )
+    {
+        hashZeroes( m_sourceSize );
+        m_hashResult = m_hash->result();
+    }
+    return error;
+}
+
+void
+BlockCopy::setHashAlgorithm( QCryptographicHash::Algorithm algorithm )
+{
+    m_hash.reset( new QCryptographicHash( algorithm ) );
+}
+
+void
+BlockCopy::hashZeroes( qint64 offset )
+{
+    static const QByteArray zeroes( 1024 * 1024, '\0' );
+    while ( m_hashed < offset )
+    {
+        const qint64 length = std::min( offset - m_hashed, qint64( zeroes.size() ) );
+        m_hash->addData( zeroes.constData(), static_cast< int >( length ) );
+        m_hashed += length;
+    }
+}
+
+int
+BlockCopy::zeroHoles()
+{
+#ifdef Q_OS_LINUX
+    qint64 position = 0;
+    for ( const auto& e : m_extents + ExtentList { Extent { m_sourceSize, 0 } } )
+    {
+        // The ioctl wants whole sectors; only the end of the source may not be
+        const qint64 end = std::min( e.offset, m_sourceSize / 512 * 512 );
+        if ( end > position )
+        {
+            quint64 range[ 2 ] = { quint64( position ), quint64( end - position ) };
+            if ( ::ioctl( m_destinationFd, BLKZEROOUT, range ) != 0 )
+            {
+                const int error = errno;
+                cWarning() << "Could not zero" << range[ 1 ] << "bytes at" << range[ 0 ] << "of" << m_destination
+                           << strerror( error );
+                return error;
+            }
+        }
+        position = e.offset + e.length;
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,124 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLOCKCOPY_H
+#define BLOCKCOPY_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QList>
+#include <QString>
+
+#include <functional>
+#include <memory>
+
+/** @brief Copies a filesystem image or block device onto another one
+ *
+ * Only the parts of the source that hold data are read: holes in a
+ * sparse image are found with lseek(SEEK_DATA / SEEK_HOLE). A block
+ * device has no holes, so it is copied whole.
+ *
+ * Reading and writing overlap: a reader thread fills large, aligned
+ * buffers and hands them to the writer (the calling thread), which
+ * writes each one at the same offset in the destination. With direct
+ * I/O both ends bypass the page cache.
+ *
+ * A regular file as destination is truncated to the size of the
+ * source, so the holes stay holes. On a block device, the holes are
+ * zeroed (with BLKZEROOUT, which most SSDs do without writing) unless
+ * zeroing is switched off.
+ *
+ * The copy can also hash the whole source as it goes, for checking
+ * the image against a known checksum without reading it twice. The
+ * holes are hashed as the zeroes they read as. Each buffer is hashed
+ * while it is being written.
+ */
+class BlockCopy
+{
+public:
+    /// @brief A region of the source that holds data
+    struct Extent
+    {
+        qint64 offset = 0;
+        qint64 length = 0;
+    };
+    using ExtentList = QList< Extent >;
+
+    /// @brief Called with the number of bytes written so far
+    using ProgressFunction = std::function< void( qint64 ) >;
+
+    /// @brief Offsets and lengths of the copy are multiples of this (except at the end of the source)
+    static constexpr qint64 alignment = 4096;
+
+    BlockCopy( const QString& source, const QString& destination );
+    ~BlockCopy();
+
+    void setDirectIO( bool direct ) { m_direct = direct; }
+    void setZeroHoles( bool zero ) { m_zeroHoles = zero; }
+    /// @brief Hash the source with @p algorithm during copy()
+    void setHashAlgorithm( QCryptographicHash::Algorithm algorithm );
+    /// @brief The hash of the source, after a successful copy(); empty if not hashing
+    QByteArray hash() const { return m_hashResult; }
+
+    /** @brief Open source and destination and find the data in the source
+     *
+     * @returns 0 on success, otherwise an errno value.
+     */
+    int open();
+
+    qint64 sourceSize() const { return m_sourceSize; }
+    qint64 destinationSize() const { return m_destinationSize; }
+    /// @brief The number of bytes that copy() reads and writes
+    qint64 dataSize() const;
+
+    /** @brief Copy the data extents of the source
+     *
+     * The destination must be at least as large as the source.
+     * @p progress is called after each buffer that is written.
+     *
+     * @returns 0 on success, otherwise an errno value.
+     */
+    int copy( const ProgressFunction& progress = ProgressFunction() );
+
+    /** @brief The regions of @p fd, of @p size bytes, that hold data
+     *
+     * Extents are widened to @p align and merged where they touch.
+     * If the filesystem cannot tell holes from data, the
+     * whole file is one extent.
+     */
+    static ExtentList dataExtents( int fd, qint64 size, qint64 align = alignment );
+
+private:
+    int zeroHoles();
+    /// @brief Hash the zeroes from the end of the data hashed so far up to @p offset
+    void hashZeroes( qint64 offset );
+
+    QString m_source;
+    QString m_destination;
+    int m_sourceFd = -1;
+    int m_destinationFd = -1;
+    bool m_destinationIsDevice = false;
+    bool m_direct = false;
+    bool m_zeroHoles = true;
+    qint64 m_sourceSize = 0;
+    qint64 m_destinationSize = 0;
+    ExtentList m_extents;
+    std::unique_ptr< QCryptographicHash > m_hash;
+    qint64 m_hashed = 0;  ///< Bytes of the source hashed so far
+    QByteArray m_hashResult;
+};
+
+#endif  // BLOCKCOPY_H
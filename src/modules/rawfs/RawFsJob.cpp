@@ -0,0 +1,300 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RawFsJob.h"
+
+#include "BlockCopy.h"
+
+#include "GlobalStorage.h"
+#include "JobQueue.h"
+#include "partition/Mount.h"
+#include "utils/CalamaresUtilsSystem.h"
+#include "utils/Logger.h"
+#include "utils/Trace.h"
+#include "utils/Variant.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QPair>
+
+#include <memory>
+#include <vector>
+
+#include <string.h>
+
+RawFsJob::RawFsJob( QObject* parent )
+    : Calamares::CppJob( parent )
+{
+}
+
+RawFsJob::~RawFsJob() {}
+
+QString
+RawFsJob::prettyName() const
+{
+    return tr( "Installing data." );
+}
+
+QString
+RawFsJob::sourceDevice( const QString& source, const QString& mountsFile )
+{
+    const QString canonical = QFileInfo( source ).canonicalFilePath();
+    const QString path = canonical.isEmpty() ? source : canonical;
+
+    QFile mounts( mountsFile.isEmpty() ? QStringLiteral( "/proc/self/mounts" ) : mountsFile );
+    if ( !mounts.open( QIODevice::ReadOnly ) )
+    {
+        return path;
+    }
+    // The last mount on a path is the one that is visible there
+    QString device = path;
+    for ( const QByteArray& line : mounts.readAll().split( '\n' ) )
+    {
+        const auto fields = line.split( ' ' );
+        if ( fields.count() > 2 && CalamaresUtils::Partition::unescapeMountPath( fields.at( 1 ) ) == path )
+        {
+            device = CalamaresUtils::Partition::unescapeMountPath( fields.at( 0 ) );
+        }
+    }
+    return device;
+}
+
+QList< RawFsJob::Item >
+RawFsJob::items( const QVariantList& partitions, const QString& mountsFile ) const
+{
+    QList< Item > l;
+    for ( const QVariant& p : partitions )
+    {
+        const QVariantMap partition = p.toMap();
+        const QString mountPoint = partition.value( "mountPoint" ).toString();
+        if ( mountPoint.isEmpty() )
+        {
+            continue;
+        }
+        for ( const QVariant& t : m_targets )
+        {
+            const QVariantMap target = t.toMap();
+            if ( target.value( "mountPoint" ).toString() == mountPoint )
+            {
+                Item item;
+                item.source = sourceDevice( target.value( "source" ).toString(), mountsFile );
+                item.destination = partition.value( "device" ).toString();
+                item.fs = partition.value( "fs" ).toString();
+                item.resize = CalamaresUtils::getBool( target, "resize", false );
+                item.checksumFile = CalamaresUtils::getString( target, "checksum" );
+                if ( item.checksumFile.isEmpty() && QFileInfo( item.source ).isFile()
+                     && QFileInfo::exists( item.source + QStringLiteral( ".sha256" ) ) )
+                {
+                    item.checksumFile = item.source + QStringLiteral( ".sha256" );
+                }
+                cDebug() << "Adding an entry for raw copy of" << item.source << "to" << item.destination;
+                l.append( item );
+            }
+        }
+    }
+    return l;
+}
+
+QByteArray
+RawFsJob::expectedChecksum( const QString& checksumFile, const QString& source )
+{
+    QFile f( checksumFile );
+    if ( !f.open( QIODevice::ReadOnly ) )
+    {
+        return QByteArray();
+    }
+
+    const QString name = QFileInfo( source ).fileName();
+    QList< QPair< QByteArray, QString > > sums;
+    for ( const QByteArray& line : f.readAll().split( '\n' ) )
+    {
+        const QByteArray l = line.trimmed();
+        const int space = l.indexOf( ' ' );
+        if ( l.isEmpty() || l.startsWith( '#' ) || space < 0 )
+        {
+            continue;
+        }
+        // The name is preceded by '*' for binary mode, or by a second space for text mode
+        QByteArray file = l.mid( space + 1 );
+        if ( file.startsWith( '*' ) || file.startsWith( ' ' ) )
+        {
+            file = file.mid( 1 );
+        }
+        sums.append( qMakePair( l.left( space ).toLower(), QFileInfo( QFile::decodeName( file ) ).fileName() ) );
+    }
+
+    if ( sums.count() == 1 )
+    {
+        return sums.first().first;
+    }
+    for ( const auto& sum : sums )
+    {
+        if ( sum.second == name )
+        {
+            return sum.first;
+        }
+    }
+    return QByteArray();
+}
+
+/// @brief Remember in GlobalStorage whether @p source matched its checksum
+static void
+storeIntegrity( Calamares::GlobalStorage* gs, const QString& source, const QByteArray& expected, const QByteArray& actual )
+{
+    QVariantMap integrity = gs->value( "imageIntegrity" ).toMap();
+    integrity.insert( source,
+                      QVariantMap { { "algorithm", QStringLiteral( "sha256" ) },
+                                    { "expected", QString::fromLatin1( expected ) },
+                                    { "actual", QString::fromLatin1( actual ) },
+                                    { "verified", expected == actual } } );
+    gs->insert( "imageIntegrity", integrity );
+}
+
+static QString
+errorString( int error )
+{
+    return QString::fromLocal8Bit( strerror( error ) );
+}
+
+Calamares::JobResult
+RawFsJob::exec()
+{
+    Calamares::GlobalStorage* gs = Calamares::JobQueue::instance()->globalStorage();
+    QVariantList partitions = gs->value( "partitions" ).toList();
+    if ( partitions.isEmpty() )
+    {
+        cWarning() << "No partitions to copy to.";
+        return Calamares::JobResult::error( tr( "Configuration Error" ),
+                                            tr( "No partitions are defined for <pre>%1</pre> to use." ).arg( "rawfs" ) );
+    }
+
+    // Open everything first, so that progress is over the data of all the items
+    const QList< Item > copies = items( partitions );
+    std::vector< std::unique_ptr< BlockCopy > > engines;
+    qint64 total = 0;
+    for ( const auto& item : copies )
+    {
+        std::unique_ptr< BlockCopy > engine( new BlockCopy( item.source, item.destination ) );
+        engine->setDirectIO( m_directIO );
+        engine->setZeroHoles( m_zeroHoles );
+        int r = engine->open();
+        if ( r )
+        {
+            return Calamares::JobResult::error( tr( "Could not open %1 or %2." ).arg( item.source, item.destination ),
+                                                errorString( r ) );
+        }
+        if ( !item.checksumFile.isEmpty() )
+        {
+            if ( expectedChecksum( item.checksumFile, item.source ).isEmpty() )
+            {
+                return Calamares::JobResult::error(
+                    tr( "Could not check the image %1." ).arg( item.source ),
+                    tr( "There is no checksum for it in %1." ).arg( item.checksumFile ) );
+            }
+            engine->setHashAlgorithm( QCryptographicHash::Sha256 );
+        }
+        if ( engine->destinationSize() < engine->sourceSize() )
+        {
+            return Calamares::JobResult::error(
+                tr( "Not enough free space" ),
+                tr( "%1 partition is too small to copy %2 on it" ).arg( item.destination, item.source ) );
+        }
+        cDebug() << "Copy of" << item.source << "has" << engine->dataSize() << "bytes of data out of"
+                 << engine->sourceSize();
+        total += engine->dataSize();
+        engines.push_back( std::move( engine ) );
+    }
+
+    qint64 done = 0;
+    for ( int i = 0; i < copies.count(); ++i )
+    {
+        const Item& item = copies.at( i );
+        BlockCopy& engine = *engines.at( static_cast< size_t >( i ) );
+        {
+            CalamaresUtils::Trace::Span span( "rawfs", item.destination );
+            int r = engine.copy( [this, done, total]( qint64 written ) {
+                emit progress( total > 0 ? qreal( done + written ) / qreal( total ) : 0.0 );
+            } );
+            if ( r )
+            {
+                return Calamares::JobResult::error(
+                    tr( "Could not copy %1 to %2." ).arg( item.source, item.destination ), errorString( r ) );
+            }
+        }
+        done += engine.dataSize();
+
+        if ( !item.checksumFile.isEmpty() )
+        {
+            const QByteArray expected = expectedChecksum( item.checksumFile, item.source );
+            const QByteArray actual = engine.hash().toHex();
+            storeIntegrity( gs, item.source, expected, actual );
+            if ( actual != expected )
+            {
+                cError() << "Checksum of" << item.source << "is" << actual << "expected" << expected;
+                return Calamares::JobResult::error(
+                    tr( "The image %1 is damaged." ).arg( item.source ),
+                    tr( "Its SHA-256 checksum is %1, but %2 was expected. "
+                        "The installation medium may be corrupt." )
+                        .arg( QString::fromLatin1( actual ), QString::fromLatin1( expected ) ) );
+            }
+            cDebug() << "Checksum of" << item.source << "matches" << item.checksumFile;
+        }
+
+        if ( item.resize && item.fs.contains( QStringLiteral( "ext" ) ) )
+        {
+            cDebug() << "Resizing filesystem on" << item.destination;
+            CalamaresUtils::System::runCommand( { "e2fsck", "-f", "-y", item.destination },
+                                                std::chrono::seconds( 0 ) );
+            CalamaresUtils::System::runCommand( { "resize2fs", item.destination }, std::chrono::seconds( 0 ) );
+        }
+
+        // The copy brings the UUID of the source filesystem along
+        auto blkid = CalamaresUtils::System::runCommand( { "blkid", "-s", "UUID", "-o", "value", item.destination },
+                                                          std::chrono::seconds( 10 ) );
+        if ( blkid.getExitCode() == 0 )
+        {
+            const QString uuid = blkid.getOutput().trimmed();
+            cDebug() << "Setting" << item.destination << "UUID to" << uuid;
+            for ( QVariant& p : partitions )
+            {
+                QVariantMap partition = p.toMap();
+                if ( partition.value( "device" ).toString() == item.destination )
+                {
+                    partition.insert( "uuid", uuid );
+                    partition.insert( "source", item.source );
+                    p = partition;
+                }
+            }
+        }
+    }
+
+    gs->insert( "partitions", partitions );
+    return Calamares::JobResult::ok();
+}
+
+void
+RawFsJob::setConfigurationMap( const QVariantMap& configurationMap )
+{
+    m_targets = configurationMap.value( "targets" ).toList();
+    m_directIO = CalamaresUtils::getBool( configurationMap, "directIO", false );
+    m_zeroHoles = CalamaresUtils::getBool( configurationMap, "zeroHoles", true );
+    if ( m_targets.isEmpty() )
+    {
+        cWarning() << "No targets defined. Does rawfs.conf exist?";
+    }
+}
+
+CALAMARES_PLUGIN_FACTORY_DEFINITION( RawFsJobFactory, registerPlugin< RawFsJob >(); )
@@ -0,0 +1,94 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RAWFSJOB_H
+#define RAWFSJOB_H
+
+#include "CppJob.h"
+#include "DllMacro.h"
+#include "utils/PluginFactory.h"
+
+#include <QObject>
+#include <QVariantList>
+#include <QVariantMap>
+
+/** @brief Copies filesystems, block by block, onto target partitions
+ *
+ * Each configured target names a mount point in the target system and
+ * a source (an image, a block device, or a mounted filesystem). The
+ * source is copied onto the partition that the *partition* module
+ * gave that mount point. Only the data in the source is copied;
+ * see BlockCopy for how.
+ *
+ * An image with a checksum file (like sha256sum writes) is checked
+ * while it is copied. The outcome is stored in GlobalStorage as
+ * *imageIntegrity*, keyed by the image's path, and the job fails
+ * if the checksum does not match.
+ */
+class PLUGINDLLEXPORT RawFsJob : public Calamares::CppJob
+{
+    Q_OBJECT
+
+public:
+    /// @brief One copy to do
+    struct Item
+    {
+        QString source;
+        QString destination;
+        QString fs;
+        QString checksumFile;  ///< SHA-256 checksums, as written by sha256sum; empty if none
+        bool resize = false;
+    };
+
+    explicit RawFsJob( QObject* parent = nullptr );
+    ~RawFsJob() override;
+
+    QString prettyName() const override;
+
+    Calamares::JobResult exec() override;
+
+    void setConfigurationMap( const QVariantMap& configurationMap ) override;
+
+    /// @brief The copies to do onto @p partitions (from GlobalStorage)
+    QList< Item > items( const QVariantList& partitions, const QString& mountsFile = QString() ) const;
+
+    /** @brief The file or device to read for @p source
+     *
+     * Symlinks are resolved. If @p source is a mount point (according
+     * to @p mountsFile, /proc/self/mounts by default), the device
+     * mounted there is returned instead.
+     */
+    static QString sourceDevice( const QString& source, const QString& mountsFile = QString() );
+
+    /** @brief The checksum for @p source listed in @p checksumFile
+     *
+     * The file has lines of a hex checksum and a file name, as
+     * written by sha256sum. The line for the file name of @p source
+     * is used; if there is only one line, its name does not matter.
+     *
+     * @returns the checksum in lower-case hex, or empty if not found.
+     */
+    static QByteArray expectedChecksum( const QString& checksumFile, const QString& source );
+
+private:
+    QVariantList m_targets;
+    bool m_directIO = false;
+    bool m_zeroHoles = true;
+};
+
+CALAMARES_PLUGIN_FACTORY_DECLARATION( RawFsJobFactory )
+
+#endif  // RAWFSJOB_H
@@ -0,0 +1,226 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BlockCopy.h"
+#include "RawFsJob.h"
+
+#include "utils/Logger.h"
+
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QtTest/QtTest>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+class RawFsTests : public QObject
+{
+    Q_OBJECT
+public:
+    RawFsTests() {}
+    ~RawFsTests() override {}
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testSourceDevice();
+    void testItems();
+    void testExtents();
+    void testCopy();
+    void testChecksumFile();
+    void testMissing();
+
+private:
+    /// @brief Writes a 20MiB file with data at the start, at 10MiB and in the last few bytes
+    static void writeSparse( const QString& path )
+    {
+        QFile f( path );
+        QVERIFY( f.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+        f.write( QByteArray( 5000, 'a' ) );
+        QVERIFY( f.seek( 10 * 1024 * 1024 ) );
+        f.write( QByteArray( 100, 'b' ) );
+        QVERIFY( f.seek( 20 * 1024 * 1024 - 3 ) );
+        f.write( "end" );
+        f.close();
+    }
+
+    static QByteArray contents( const QString& path )
+    {
+        QFile f( path );
+        return f.open( QIODevice::ReadOnly ) ? f.readAll() : QByteArray();
+    }
+};
+
+void
+RawFsTests::initTestCase()
+{
+    Logger::setupLogLevel( Logger::LOGDEBUG );
+}
+
+void
+RawFsTests::testSourceDevice()
+{
+    QTemporaryFile mounts;
+    QVERIFY( mounts.open() );
+    mounts.write( "/dev/sda1 /run/media/data ext4 rw 0 0\n"
+                  "/dev/sdb1 /run/media/My\\040Image ext4 ro 0 0\n"
+                  "/dev/sdc1 /run/media/data ext4 rw 0 0\n" );
+    mounts.close();
+
+    QCOMPARE( RawFsJob::sourceDevice( "/run/media/data", mounts.fileName() ), QStringLiteral( "/dev/sdc1" ) );
+    QCOMPARE( RawFsJob::sourceDevice( "/run/media/My Image", mounts.fileName() ), QStringLiteral( "/dev/sdb1" ) );
+    QCOMPARE( RawFsJob::sourceDevice( "/images/home.img", mounts.fileName() ), QStringLiteral( "/images/home.img" ) );
+}
+
+void
+RawFsTests::testItems()
+{
+    QTemporaryFile mounts;
+    QVERIFY( mounts.open() );
+    mounts.write( "/dev/mmcblk0p2 /run/rootfs ext4 ro 0 0\n" );
+    mounts.close();
+
+    RawFsJob job;
+    job.setConfigurationMap( QVariantMap {
+        { "targets",
+          QVariantList { QVariantMap { { "mountPoint", "/" }, { "source", "/run/rootfs" } },
+                         QVariantMap { { "mountPoint", "/home" }, { "source", "/images/home.img" }, { "resize", true } },
+                         QVariantMap { { "mountPoint", "/data" }, { "source", "/dev/mmcblk0p3" } } } } } );
+
+    const QVariantList partitions {
+        QVariantMap { { "device", "/dev/sda1" }, { "mountPoint", "/" }, { "fs", "ext4" } },
+        QVariantMap { { "device", "/dev/sda2" }, { "mountPoint", "" }, { "fs", "linuxswap" } },
+        QVariantMap { { "device", "/dev/sda3" }, { "mountPoint", "/home" }, { "fs", "ext4" } },
+    };
+    const auto items = job.items( partitions, mounts.fileName() );
+    QCOMPARE( items.count(), 2 );
+    QCOMPARE( items.at( 0 ).source, QStringLiteral( "/dev/mmcblk0p2" ) );
+    QCOMPARE( items.at( 0 ).destination, QStringLiteral( "/dev/sda1" ) );
+    QVERIFY( !items.at( 0 ).resize );
+    QCOMPARE( items.at( 1 ).source, QStringLiteral( "/images/home.img" ) );
+    QCOMPARE( items.at( 1 ).destination, QStringLiteral( "/dev/sda3" ) );
+    QCOMPARE( items.at( 1 ).fs, QStringLiteral( "ext4" ) );
+    QVERIFY( items.at( 1 ).resize );
+}
+
+void
+RawFsTests::testExtents()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath( "sparse.img" );
+    writeSparse( path );
+    const qint64 size = 20 * 1024 * 1024;
+
+    int fd = ::open( QFile::encodeName( path ).constData(), O_RDONLY );
+    QVERIFY( fd >= 0 );
+    const auto extents = BlockCopy::dataExtents( fd, size );
+    ::close( fd );
+
+    // Whatever the filesystem can tell, all the data is covered, in order
+    QVERIFY( !extents.isEmpty() );
+    QCOMPARE( extents.first().offset, qint64( 0 ) );
+    QCOMPARE( extents.last().offset + extents.last().length, size );
+    qint64 end = 0;
+    for ( const auto& e : extents )
+    {
+        QVERIFY( e.offset >= end );
+        QCOMPARE( e.offset % BlockCopy::alignment, qint64( 0 ) );
+        QVERIFY( e.length > 0 );
+        end = e.offset + e.length;
+    }
+    if ( extents.count() == 1 )
+    {
+        QSKIP( "The filesystem for temporary files does not report holes" );
+    }
+    QCOMPARE( extents.count(), 3 );
+    QVERIFY( extents.at( 1 ).offset <= 10 * 1024 * 1024 );
+    QVERIFY( extents.at( 1 ).offset + extents.at( 1 ).length >= 10 * 1024 * 1024 + 100 );
+}
+
+void
+RawFsTests::testCopy()
+{
+    QTemporaryDir dir;
+    const QString source = dir.filePath( "sparse.img" );
+    const QString destination = dir.filePath( "copy.img" );
+    writeSparse( source );
+    {
+        // Old contents must not show through the holes
+        QFile f( destination );
+        QVERIFY( f.open( QIODevice::WriteOnly ) );
+        f.write( QByteArray( 12 * 1024 * 1024, 'x' ) );
+    }
+
+    BlockCopy copy( source, destination );
+    copy.setHashAlgorithm( QCryptographicHash::Sha256 );
+    QCOMPARE( copy.open(), 0 );
+    QCOMPARE( copy.sourceSize(), qint64( 20 * 1024 * 1024 ) );
+    QVERIFY( copy.dataSize() <= copy.sourceSize() );
+
+    qint64 last = 0;
+    int calls = 0;
+    QCOMPARE( copy.copy( [&]( qint64 written ) {
+        QVERIFY( written > last );
+        last = written;
+        ++calls;
+    } ),
+              0 );
+    QVERIFY( calls > 0 );
+    QCOMPARE( last, copy.dataSize() );
+    QCOMPARE( contents( destination ), contents( source ) );
+    // The holes are hashed too
+    QCOMPARE( copy.hash(), QCryptographicHash::hash( contents( source ), QCryptographicHash::Sha256 ) );
+}
+
+void
+RawFsTests::testChecksumFile()
+{
+    const QByteArray sumA( 64, 'a' );
+    const QByteArray sumB( 64, 'b' );
+
+    QTemporaryFile one;
+    QVERIFY( one.open() );
+    one.write( sumA.toUpper() + "  whatever.img\n" );
+    one.close();
+    // A single checksum is used whatever its name
+    QCOMPARE( RawFsJob::expectedChecksum( one.fileName(), "/images/home.img" ), sumA );
+
+    QTemporaryFile several;
+    QVERIFY( several.open() );
+    several.write( "# Images\n" + sumA + "  root.img\n" + sumB + " *images/home.img\n" );
+    several.close();
+    QCOMPARE( RawFsJob::expectedChecksum( several.fileName(), "/images/root.img" ), sumA );
+    QCOMPARE( RawFsJob::expectedChecksum( several.fileName(), "/images/home.img" ), sumB );
+    QVERIFY( RawFsJob::expectedChecksum( several.fileName(), "/images/data.img" ).isEmpty() );
+    QVERIFY( RawFsJob::expectedChecksum( "/nonexistent.sha256", "/images/root.img" ).isEmpty() );
+}
+
+void
+RawFsTests::testMissing()
+{
+    QTemporaryDir dir;
+    const QString source = dir.filePath( "sparse.img" );
+    writeSparse( source );
+    BlockCopy copy( source, QStringLiteral( "/nonexistent/copy.img" ) );
+    QCOMPARE( copy.open(), ENOENT );
+    QCOMPARE( copy.copy(), EBADF );
+}
+
+QTEST_GUILESS_MAIN( RawFsTests )
+
+#include "utils/moc-warnings.h"
+
+#include "Tests.moc"
@@ -0,0 +1,156 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ServicesJob.h"
+
+#include "utils/CalamaresUtilsSystem.h"
+#include "utils/Logger.h"
+#include "utils/Variant.h"
+
+ServicesJob::ServicesJob( QObject* parent )
+    : Calamares::CppJob( parent )
+{
+}
+
+ServicesJob::~ServicesJob() {}
+
+QString
+ServicesJob::prettyName() const
+{
+    return tr( "Configure systemd services" );
+}
+
+static QString
+describeFailure( const ServicesJob::Batch& batch, const QString& name )
+{
+    if ( batch.command == QStringLiteral( "enable" ) && batch.suffix == QStringLiteral( ".service" ) )
+    {
+        return ServicesJob::tr( "Cannot enable systemd service <code>%1</code>." ).arg( name );
+    }
+    if ( batch.command == QStringLiteral( "enable" ) && batch.suffix == QStringLiteral( ".target" ) )
+    {
+        return ServicesJob::tr( "Cannot enable systemd target <code>%1</code>." ).arg( name );
+    }
+    if ( batch.command == QStringLiteral( "disable" ) && batch.suffix == QStringLiteral( ".service" ) )
+    {
+        return ServicesJob::tr( "Cannot disable systemd service <code>%1</code>." ).arg( name );
+    }
+    if ( batch.command == QStringLiteral( "disable" ) && batch.suffix == QStringLiteral( ".target" ) )
+    {
+        return ServicesJob::tr( "Cannot disable systemd target <code>%1</code>." ).arg( name );
+    }
+    if ( batch.command == QStringLiteral( "mask" ) )
+    {
+        return ServicesJob::tr( "Cannot mask systemd unit <code>%1</code>." ).arg( name );
+    }
+    return ServicesJob::tr( "Unknown systemd commands <code>%1</code> and <code>%2</code> for unit %3." )
+        .arg( batch.command, batch.suffix, name );
+}
+
+Calamares::JobResult
+ServicesJob::exec()
+{
+    // Note that "systemctl enable", "disable" and "mask" are the only systemctl
+    // commands that work in a chroot, see
+    // http://0pointer.de/blog/projects/changing-roots.html
+    auto* system = CalamaresUtils::System::instance();
+    for ( const auto& batch : m_batches )
+    {
+        QStringList names;
+        for ( const auto& unit : batch.units )
+        {
+            names.append( unit.name );
+        }
+
+        auto r = system->targetEnvCommand( QStringList { "systemctl", batch.command } + names );
+        if ( r.getExitCode() == 0 )
+        {
+            cDebug() << "systemctl" << batch.command << "done for" << names.count() << "units.";
+            continue;
+        }
+        cWarning() << "systemctl" << batch.command << "failed for" << names << "with error code" << r.getExitCode()
+                   << r.getOutput();
+
+        // Find out which ones failed, and change the rest anyway
+        for ( const auto& unit : batch.units )
+        {
+            int ec = system->targetEnvCall( QStringList { "systemctl", batch.command, unit.name } );
+            if ( ec == 0 )
+            {
+                continue;
+            }
+            cWarning() << "Cannot" << batch.command << "systemd unit" << unit.name << "error code" << ec;
+            if ( unit.mandatory )
+            {
+                return Calamares::JobResult::error(
+                    tr( "Cannot modify service" ),
+                    describeFailure( batch, unit.name ) + ' '
+                        + tr( "<code>systemctl %1</code> call in chroot returned error code %2." )
+                              .arg( batch.command )
+                              .arg( ec ) );
+            }
+        }
+    }
+    return Calamares::JobResult::ok();
+}
+
+void
+ServicesJob::setConfigurationMap( const QVariantMap& configurationMap )
+{
+    static const struct
+    {
+        const char* key;
+        const char* command;
+        const char* suffix;
+    } kinds[] = { { "services", "enable", ".service" },
+                  { "targets", "enable", ".target" },
+                  { "disable", "disable", ".service" },
+                  { "disable-targets", "disable", ".target" },
+                  { "mask", "mask", "" } };
+
+    m_batches.clear();
+    for ( const auto& kind : kinds )
+    {
+        Batch batch { QString::fromLatin1( kind.command ), QString::fromLatin1( kind.suffix ), {} };
+        for ( const QVariant& v : configurationMap.value( kind.key ).toList() )
+        {
+            Unit unit;
+            if ( v.type() == QVariant::String )
+            {
+                unit.name = v.toString();
+            }
+            else
+            {
+                const QVariantMap m = v.toMap();
+                unit.name = CalamaresUtils::getString( m, "name" );
+                unit.mandatory = CalamaresUtils::getBool( m, "mandatory", false );
+            }
+            if ( unit.name.isEmpty() )
+            {
+                cWarning() << "Unnamed entry in" << kind.key << "is ignored.";
+                continue;
+            }
+            unit.name.append( batch.suffix );
+            batch.units.append( unit );
+        }
+        if ( !batch.units.isEmpty() )
+        {
+            m_batches.append( batch );
+        }
+    }
+}
+
+CALAMARES_PLUGIN_FACTORY_DEFINITION( ServicesJobFactory, registerPlugin< ServicesJob >(); )
@@ -0,0 +1,77 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SERVICESJOB_H
+#define SERVICESJOB_H
+
+#include "CppJob.h"
+#include "DllMacro.h"
+#include "utils/PluginFactory.h"
+
+#include <QObject>
+#include <QVariantMap>
+
+/** @brief Enables, disables and masks systemd units in the target system
+ *
+ * Every systemctl start-up loads all the unit files of the target,
+ * so each kind of change (e.g. enabling services) is done with a
+ * single systemctl call for all the units of that kind. Only if that
+ * call fails are the units tried one by one, to find out which unit
+ * failed and to still change the others.
+ */
+class PLUGINDLLEXPORT ServicesJob : public Calamares::CppJob
+{
+    Q_OBJECT
+
+public:
+    /// @brief A unit to change, with the suffix (e.g. .service) added
+    struct Unit
+    {
+        QString name;
+        bool mandatory = false;
+    };
+
+    /// @brief Units changed by the same systemctl command
+    struct Batch
+    {
+        QString command;  ///< e.g. "enable"
+        QString suffix;  ///< e.g. ".service"; empty for mask
+        QList< Unit > units;
+    };
+
+    explicit ServicesJob( QObject* parent = nullptr );
+    ~ServicesJob() override;
+
+    QString prettyName() const override;
+
+    Calamares::JobResult exec() override;
+
+    void setConfigurationMap( const QVariantMap& configurationMap ) override;
+
+    /** @brief The batches for the configuration, in the order they are done
+     *
+     * Services and targets are enabled, then services and targets are
+     * disabled, then units are masked. Empty batches are left out.
+     */
+    QList< Batch > batches() const { return m_batches; }
+
+private:
+    QList< Batch > m_batches;
+};
+
+CALAMARES_PLUGIN_FACTORY_DECLARATION( ServicesJobFactory )
+
+#endif  // SERVICESJOB_H
@@ -0,0 +1,92 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ServicesJob.h"
+
+#include "utils/Logger.h"
+
+#include <QtTest/QtTest>
+
+class ServicesTests : public QObject
+{
+    Q_OBJECT
+public:
+    ServicesTests() {}
+    ~ServicesTests() override {}
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testBatches();
+    void testEmpty();
+};
+
+void
+ServicesTests::initTestCase()
+{
+    Logger::setupLogLevel( Logger::LOGDEBUG );
+}
+
+void
+ServicesTests::testBatches()
+{
+    ServicesJob job;
+    job.setConfigurationMap( QVariantMap {
+        { "services",
+          QVariantList { QVariantMap { { "name", "NetworkManager" }, { "mandatory", true } },
+                         "cups",
+                         QVariantMap { { "name", "" } },
+                         QVariantMap { { "name", "sshd" }, { "mandatory", false } } } },
+        { "targets", QVariantList { QVariantMap { { "name", "graphical" }, { "mandatory", true } } } },
+        { "disable", QVariantList { "pacman-init" } },
+        { "mask", QVariantList { "suspend.target", "hibernate.target" } } } );
+
+    const auto batches = job.batches();
+    QCOMPARE( batches.count(), 4 );
+
+    QCOMPARE( batches.at( 0 ).command, QStringLiteral( "enable" ) );
+    QCOMPARE( batches.at( 0 ).units.count(), 3 );
+    QCOMPARE( batches.at( 0 ).units.at( 0 ).name, QStringLiteral( "NetworkManager.service" ) );
+    QVERIFY( batches.at( 0 ).units.at( 0 ).mandatory );
+    QCOMPARE( batches.at( 0 ).units.at( 1 ).name, QStringLiteral( "cups.service" ) );
+    QVERIFY( !batches.at( 0 ).units.at( 1 ).mandatory );
+    QCOMPARE( batches.at( 0 ).units.at( 2 ).name, QStringLiteral( "sshd.service" ) );
+
+    QCOMPARE( batches.at( 1 ).command, QStringLiteral( "enable" ) );
+    QCOMPARE( batches.at( 1 ).units.at( 0 ).name, QStringLiteral( "graphical.target" ) );
+
+    QCOMPARE( batches.at( 2 ).command, QStringLiteral( "disable" ) );
+    QCOMPARE( batches.at( 2 ).units.at( 0 ).name, QStringLiteral( "pacman-init.service" ) );
+
+    // Masked units have no suffix added
+    QCOMPARE( batches.at( 3 ).command, QStringLiteral( "mask" ) );
+    QCOMPARE( batches.at( 3 ).units.count(), 2 );
+    QCOMPARE( batches.at( 3 ).units.at( 1 ).name, QStringLiteral( "hibernate.target" ) );
+}
+
+void
+ServicesTests::testEmpty()
+{
+    ServicesJob job;
+    job.setConfigurationMap( QVariantMap { { "services", QVariantList() }, { "targets", QVariantList() } } );
+    QVERIFY( job.batches().isEmpty() );
+}
+
+QTEST_GUILESS_MAIN( ServicesTests )
+
+#include "utils/moc-warnings.h"
+
+#include "Tests.moc"
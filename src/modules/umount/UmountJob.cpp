@@ -0,0 +1,103 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UmountJob.h"
+
+#include "GlobalStorage.h"
+#include "JobQueue.h"
+#include "partition/Mount.h"
+#include "utils/Files.h"
+#include "utils/Logger.h"
+#include "utils/Variant.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+UmountJob::UmountJob( QObject* parent )
+    : Calamares::CppJob( parent )
+{
+}
+
+UmountJob::~UmountJob() {}
+
+QString
+UmountJob::prettyName() const
+{
+    return tr( "Unmount file systems." );
+}
+
+/// @brief Copy @p source to @p destination, replacing it; only warns on failure
+static void
+preserveLog( const QString& source, const QString& destination )
+{
+    if ( !QFile::exists( source ) )
+    {
+        return;
+    }
+    QDir().mkpath( QFileInfo( destination ).path() );
+    if ( CalamaresUtils::copyFile( source, destination ) == CalamaresUtils::CopyMethod::Failed )
+    {
+        cWarning() << "Could not preserve file" << source;
+    }
+}
+
+Calamares::JobResult
+UmountJob::exec()
+{
+    Calamares::GlobalStorage* gs = Calamares::JobQueue::instance()->globalStorage();
+    const QString root = gs->value( "rootMountPoint" ).toString();
+
+    if ( root.isEmpty() )
+    {
+        return Calamares::JobResult::error(
+            tr( "No mount point for root partition in globalstorage" ),
+            tr( "globalstorage does not contain a \"rootMountPoint\" key, doing nothing" ) );
+    }
+    if ( !QDir( root ).exists() )
+    {
+        return Calamares::JobResult::error(
+            tr( "Bad mount point for root partition in globalstorage" ),
+            tr( "globalstorage[\"rootMountPoint\"] is \"%1\", which does not exist, doing nothing" ).arg( root ) );
+    }
+
+    // Copy the installation log before unmounting
+    if ( !m_srcLog.isEmpty() && !m_destLog.isEmpty() )
+    {
+        preserveLog( m_srcLog, root + '/' + m_destLog );
+    }
+
+    const QStringList failures = CalamaresUtils::Partition::unmountTree( root );
+    if ( !failures.isEmpty() )
+    {
+        return Calamares::JobResult::error( tr( "Could not unmount the target system." ), failures.join( '\n' ) );
+    }
+
+    if ( !QDir().rmdir( root ) )
+    {
+        cWarning() << "Could not remove root mount point" << root;
+    }
+    return Calamares::JobResult::ok();
+}
+
+void
+UmountJob::setConfigurationMap( const QVariantMap& configurationMap )
+{
+    m_srcLog = CalamaresUtils::getString( configurationMap, "srcLog" );
+    m_destLog = CalamaresUtils::getString( configurationMap, "destLog" );
+}
+
+CALAMARES_PLUGIN_FACTORY_DEFINITION( UmountJobFactory, registerPlugin< UmountJob >(); )
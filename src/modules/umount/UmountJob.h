@@ -0,0 +1,55 @@
+/* === This file is part of Calamares - <https://github.com/calamares> ===
+ *
+ *   Calamares is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Calamares is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UMOUNTJOB_H
+#define UMOUNTJOB_H
+
+#include "CppJob.h"
+#include "DllMacro.h"
+#include "utils/PluginFactory.h"
+
+#include <QObject>
+#include <QVariantMap>
+
+/** @brief Unmounts the target system
+ *
+ * Copies the installation log into the target, then unmounts everything
+ * below *rootMountPoint* with the umount2(2) system call (see
+ * CalamaresUtils::Partition::unmountTree()) and removes the root
+ * mount point.
+ */
+class PLUGINDLLEXPORT UmountJob : public Calamares::CppJob
+{
+    Q_OBJECT
+
+public:
+    explicit UmountJob( QObject* parent = nullptr );
+    ~UmountJob() override;
+
+    QString prettyName() const override;
+
+    Calamares::JobResult exec() override;
+
+    void setConfigurationMap( const QVariantMap& configurationMap ) override;
+
+private:
+    QString m_srcLog;  ///< Log file in the live system
+    QString m_destLog;  ///< Where to copy it to, in the target system
+};
+
+CALAMARES_PLUGIN_FACTORY_DECLARATION( UmountJobFactory )
+
+#endif  // UMOUNTJOB_H
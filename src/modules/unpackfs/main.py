@@ -24,12 +24,16 @@
 #   You should have received a copy of the GNU General Public License
 #   along with Calamares. If not, see <http://www.gnu.org/licenses/>.
 
+import concurrent.futures
+import hashlib
+import json
 import os
 import re
 import shutil
 import subprocess
 import sys
 import tempfile
+import threading
 
 from libcalamares import *
 from libcalamares.utils import mount
@@ -52,14 +56,15 @@ class UnpackEntry:
     :param sourcefs:
     :param destination:
     """
-    __slots__ = ['source', 'sourcefs', 'destination', 'copied', 'total', 'exclude', 'excludeFile']
+    __slots__ = ['source', 'sourcefs', 'destination', 'copied', 'total', 'exclude', 'excludeFile', 'checksumFile',
+                 'manifestFile']
 
     def __init__(self, source, sourcefs, destination):
         """
         @p source is the source file name (might be an image file, or
             a directory, too)
-        @p sourcefs is a type indication; "file" is special, as is
-            "squashfs".
+        @p sourcefs is a type indication; "file" is special, as are
+            "squashfs" and "tar" (an archive that is extracted as it is read).
         @p destination is where the files from the source go. This is
             **already** prefixed by rootMountPoint, so should be a
             valid absolute path within the host system.
@@ -71,16 +76,232 @@ class UnpackEntry:
         self.destination = destination
         self.exclude = None
         self.excludeFile = None
+        self.checksumFile = None
+        self.manifestFile = None
         self.copied = 0
         self.total = 0
 
     def is_file(self):
         return self.sourcefs == "file"
 
+    def is_tar(self):
+        return self.sourcefs == "tar"
+
 
 ON_POSIX = 'posix' in sys.builtin_module_names
 
 
+def expected_checksum(checksum_file, source):
+    """
+    Returns the checksum for @p source listed in @p checksum_file
+    (lines of a hex checksum and a file name, as written by sha256sum),
+    in lower-case hex. The line for the file name of @p source is used;
+    if there is only one line, its name does not matter.
+
+    Returns None if there is no such checksum.
+    """
+    try:
+        with open(checksum_file, "r") as f:
+            lines = f.readlines()
+    except OSError:
+        return None
+
+    sums = []
+    for line in lines:
+        line = line.strip()
+        if not line or line.startswith("#") or " " not in line:
+            continue
+        checksum, name = line.split(" ", 1)
+        # The name is preceded by '*' for binary mode, or by a second space for text mode
+        if name.startswith("*") or name.startswith(" "):
+            name = name[1:]
+        sums.append((checksum.lower(), os.path.basename(name)))
+
+    if len(sums) == 1:
+        return sums[0][0]
+    for checksum, name in sums:
+        if name == os.path.basename(source):
+            return checksum
+    return None
+
+
+class ImageChecksum(threading.Thread):
+    """
+    Computes the SHA-256 checksum of an image file in the background.
+
+    This runs while the image is unpacked from its loop mount, so both
+    read the same pages of the image (the second read comes from the
+    page cache) instead of the image being read again afterwards.
+    hashlib does not hold the GIL while hashing large buffers, so this
+    does not slow down the progress reporting either.
+    """
+    def __init__(self, path):
+        super().__init__(daemon=True)
+        self.path = path
+        self.checksum = None
+        self.error = None
+        self.stopped = threading.Event()
+
+    def run(self):
+        h = hashlib.sha256()
+        buffer = bytearray(4 * 1024 * 1024)
+        view = memoryview(buffer)
+        try:
+            with open(self.path, "rb", buffering=0) as f:
+                while not self.stopped.is_set():
+                    n = f.readinto(buffer)
+                    if not n:
+                        self.checksum = h.hexdigest()
+                        break
+                    h.update(view[:n])
+        except OSError as e:
+            self.error = str(e)
+
+    def stop(self):
+        """
+        Stops reading the image (leaving no checksum), and waits
+        for the thread to finish.
+        """
+        self.stopped.set()
+        self.join()
+
+
+def read_manifest(path):
+    """
+    Reads the manifest of an image, written when the image is built.
+    This is a JSON object like
+
+        { "files": 123456, "bytes": 4567890123,
+          "directories": { "/usr": 3456789012, "/var": 123456789 } }
+
+    where *files* is the number of regular files in the image (as
+    counted by `find -type f`), *bytes* is their total size and
+    *directories* (optional) gives the total size below some
+    directories.
+
+    Returns the manifest as a dict, or None if it can't be read.
+    """
+    try:
+        with open(path, "r") as f:
+            manifest = json.load(f)
+    except (OSError, ValueError) as e:
+        utils.warning("Could not read manifest {}: {}".format(path, e))
+        return None
+    if not isinstance(manifest, dict) or not isinstance(manifest.get("files", None), int):
+        utils.warning("Manifest {} has no file count".format(path))
+        return None
+    return manifest
+
+
+def scan_directory(path):
+    """
+    Returns the number of regular files directly in @p path,
+    and a list of its subdirectories.
+    """
+    files = 0
+    subdirectories = []
+    try:
+        with os.scandir(path) as it:
+            for e in it:
+                if e.is_dir(follow_symlinks=False):
+                    subdirectories.append(e.path)
+                elif e.is_file(follow_symlinks=False):
+                    files += 1
+    except OSError:
+        pass
+    return files, subdirectories
+
+
+def count_files(path, workers=8):
+    """
+    Counts the regular files below @p path, like `find -type f`.
+
+    Directories are read by several threads at once; os.scandir()
+    does not hold the GIL while it waits for the filesystem, and
+    reading many directories at once keeps a slow device busy.
+    """
+    if not os.path.isdir(path):
+        return 1 if os.path.isfile(path) else 0
+
+    total = 0
+    with concurrent.futures.ThreadPoolExecutor(max_workers=workers) as pool:
+        pending = {pool.submit(scan_directory, path)}
+        while pending:
+            done, pending = concurrent.futures.wait(pending, return_when=concurrent.futures.FIRST_COMPLETED)
+            for f in done:
+                files, subdirectories = f.result()
+                total += files
+                pending.update(pool.submit(scan_directory, d) for d in subdirectories)
+    return total
+
+
+class FileCounter(threading.Thread):
+    """
+    Counts the files of an entry that has no manifest, while it is
+    being unpacked. Until the count is done, progress uses the
+    totals that rsync reports; the count may raise the total in
+    one jump, so report_progress() holds the progress until the
+    files copied catch up.
+    """
+    def __init__(self, entry, path):
+        super().__init__(daemon=True)
+        self.entry = entry
+        self.path = path
+
+    def run(self):
+        total = count_files(self.path)
+        utils.debug("Counted {} files in {}".format(total, self.entry.source))
+        if total > self.entry.total:
+            self.entry.total = total
+
+
+def check_space(entry, manifest):
+    """
+    Warns if the target filesystems look too small for the sizes
+    in the @p manifest of @p entry. This is only a hint: compression
+    and excludes make the real sizes differ.
+    """
+    sizes = { "": manifest.get("bytes", 0) }
+    sizes.update(manifest.get("directories", {}))
+    for directory, size in sizes.items():
+        path = os.path.join(entry.destination, directory.strip("/"))
+        if not os.path.isdir(path) or not isinstance(size, int):
+            continue
+        if directory and not os.path.ismount(path):
+            continue
+        st = os.statvfs(path)
+        if st.f_bavail * st.f_frsize < size:
+            utils.warning("{} needs {} bytes in {}, but only {} are free".format(
+                entry.source, size, path, st.f_bavail * st.f_frsize))
+
+
+def destinations_overlap(a, b):
+    """
+    Returns True if one of the paths @p a and @p b is inside the
+    other (or they are the same), so that unpacking into one of them
+    can change the other.
+    """
+    a = os.path.normpath(a)
+    b = os.path.normpath(b)
+    return a == b or a.startswith(b.rstrip("/") + "/") or b.startswith(a.rstrip("/") + "/")
+
+
+def store_integrity(source, expected, actual):
+    """
+    Remembers in GlobalStorage whether @p source matched its checksum.
+    """
+    integrity = globalstorage.value("imageIntegrity")
+    if not integrity:
+        integrity = dict()
+    integrity[source] = {
+        "algorithm": "sha256",
+        "expected": expected,
+        "actual": actual if actual else "",
+        "verified": expected == actual
+        }
+    globalstorage.insert("imageIntegrity", integrity)
+
+
 def global_excludes():
     """
     List excludes for rsync.
@@ -112,7 +333,8 @@ def file_copy(source, entry, progress_cb):
 
     # Environment used for executing rsync properly
     # Setting locale to C (fix issue with tr_TR locale)
-    at_env = os.environ
+    # A copy, since entries may be copied by several threads at once
+    at_env = dict(os.environ)
     at_env["LC_ALL"] = "C"
 
     # `source` *must* end with '/' otherwise a directory named after the source
@@ -190,6 +412,92 @@ def file_copy(source, entry, progress_cb):
     return None
 
 
+# Decompressors for tar archives, by file name suffix. These run as
+# a separate process, so decompression overlaps with tar creating files.
+TAR_DECOMPRESSORS = [
+    ((".tar.zst", ".tzst"), ["zstd", "-d", "-c"]),
+    ((".tar.xz", ".txz"), ["xz", "-d", "-c", "-T0"]),
+    ((".tar.gz", ".tgz"), ["gzip", "-d", "-c"]),
+    ]
+
+
+def tar_decompressor(source):
+    """
+    Returns the command that decompresses @p source to stdout,
+    or None for an uncompressed tar archive.
+    """
+    for suffixes, command in TAR_DECOMPRESSORS:
+        if source.endswith(suffixes):
+            return command
+    return None
+
+
+def tar_extract(entry, progress_cb):
+    """
+    Extract the tar archive of the given @p entry, as it is read.
+
+    The archive may be a file or a pipe (FIFO). For a file, progress
+    is the position in the (compressed) archive: the decompressor
+    reads it through a file descriptor shared with this process.
+
+    :param entry: The UnpackEntry being extracted.
+    :param progress_cb: A callback function for progress reporting.
+        Takes a number and a total-number.
+    """
+    args = ['tar', '-x', '-f', '-', '-C', entry.destination,
+            '--preserve-permissions', '--numeric-owner',
+            '--xattrs', '--xattrs-include=*', '--acls']
+    if entry.excludeFile:
+        args.extend(["--exclude-from=" + entry.excludeFile])
+    if entry.exclude:
+        for f in entry.exclude:
+            args.extend(["--exclude", f])
+    # The rsync excludes are anchored at the root of the source;
+    # archive members may or may not start with ./
+    args.append("--anchored")
+    for f in global_excludes()[1::2]:
+        f = f.strip("/")
+        args.extend(["--exclude", f + "/*", "--exclude", "./" + f + "/*"])
+
+    source = open(entry.source, "rb")
+    is_regular = os.path.isfile(entry.source)
+    size = os.fstat(source.fileno()).st_size if is_regular else 0
+    decompressor = None
+    try:
+        decompress = tar_decompressor(entry.source)
+        if decompress:
+            if shutil.which(decompress[0]) is None:
+                return _("Failed to find {}, which is needed to unpack {}").format(decompress[0], entry.source)
+            decompressor = subprocess.Popen(decompress, stdin=source, stdout=subprocess.PIPE, close_fds=ON_POSIX)
+            process = subprocess.Popen(args, stdin=decompressor.stdout, close_fds=ON_POSIX)
+            # tar owns the pipe now, so the decompressor sees it when tar exits early
+            decompressor.stdout.close()
+        else:
+            process = subprocess.Popen(args, stdin=source, close_fds=ON_POSIX)
+
+        while True:
+            try:
+                process.wait(timeout=0.5)
+                break
+            except subprocess.TimeoutExpired:
+                if is_regular:
+                    progress_cb(os.lseek(source.fileno(), 0, os.SEEK_CUR), size)
+        if decompressor:
+            decompressor.wait()
+    finally:
+        source.close()
+
+    progress_cb(size, size)  # Push towards 100%
+    if decompressor and decompressor.returncode != 0:
+        utils.warning("{} failed with error code {}.".format(decompress[0], decompressor.returncode))
+        return _("{} failed with error code {}.").format(decompress[0], decompressor.returncode)
+    if process.returncode != 0:
+        utils.warning("tar failed with error code {}.".format(process.returncode))
+        return _("tar failed with error code {}.").format(process.returncode)
+
+    return None
+
+
 class UnpackOperation:
     """
     Extraction routine using unsquashfs.
@@ -197,9 +505,11 @@ class UnpackOperation:
     :param entries:
     """
 
-    def __init__(self, entries):
+    def __init__(self, entries, concurrent=False):
         self.entries = entries
         self.entry_for_source = dict((x.source, x) for x in self.entries)
+        self.concurrent = concurrent
+        self.progress = float(0)
 
     def report_progress(self):
         """
@@ -207,21 +517,24 @@ class UnpackOperation:
         """
         progress = float(0)
 
-        done = 0
-        total = 0
+        # Entries count in different units (files, or bytes of an
+        # archive), so each entry counts as the fraction it has done.
+        done = float(0)
         complete = 0
         for entry in self.entries:
             if entry.total == 0:
                 continue
-            total += entry.total
-            done += entry.copied
+            done += min(1.0, entry.copied / entry.total)
             if entry.total == entry.copied:
                 complete += 1
 
-        if done > 0 and total > 0:
-            progress = 0.05 + (0.90 * done / total) + (0.05 * complete / len(self.entries))
+        if done > 0:
+            progress = 0.05 + (0.90 * done / len(self.entries)) + (0.05 * complete / len(self.entries))
 
-        job.setprogress(progress)
+        # An entry's total may still grow (rsync's partial totals, then
+        # the FileCounter's count), so never report less than before.
+        self.progress = max(self.progress, progress)
+        job.setprogress(self.progress)
 
     def run(self):
         """
@@ -232,6 +545,9 @@ class UnpackOperation:
         source_mount_path = tempfile.mkdtemp()
 
         try:
+            if self.concurrent:
+                return self.run_concurrently(source_mount_path)
+
             for entry in self.entries:
                 imgbasename = os.path.splitext(
                     os.path.basename(entry.source))[0]
@@ -240,41 +556,112 @@ class UnpackOperation:
 
                 self.mount_image(entry, imgmountdir)
 
-                fslist = ""
+                error = self.unpack_entry(entry, imgmountdir)
+                if error:
+                    return error
 
-                if entry.sourcefs == "squashfs":
-                    if shutil.which("unsquashfs") is None:
-                        utils.warning("Failed to find unsquashfs")
-
-                        return (_("Failed to unpack image \"{}\"").format(entry.source),
-                                _("Failed to find unsquashfs, make sure you have the squashfs-tools package installed"))
-
-                    fslist = subprocess.check_output(
-                        ["unsquashfs", "-l", entry.source]
-                        )
-
-                elif entry.sourcefs == "ext4":
-                    fslist = subprocess.check_output(
-                        ["find", imgmountdir, "-type", "f"]
-                        )
-
-                elif entry.is_file():
-                    # Hasn't been mounted, copy directly; find handles both
-                    # files and directories.
-                    fslist = subprocess.check_output(["find", entry.source, "-type", "f"])
+            return None
+        finally:
+            shutil.rmtree(source_mount_path, ignore_errors=True, onerror=None)
 
-                entry.total = len(fslist.splitlines())
+    def run_concurrently(self, source_mount_path):
+        """
+        Mounts all the entries, then unpacks entries whose destinations
+        do not overlap at the same time. An entry still waits for all
+        the entries before it (in the configuration) that unpack into
+        the same tree, so the result is the same as unpacking them in
+        order. Progress is reported from this thread, for all entries.
 
+        :return: the error of the first entry that failed, or None
+        """
+        mountdirs = []
+        try:
+            for index, entry in enumerate(self.entries):
+                # Several entries may have images with the same name
+                imgmountdir = os.path.join(source_mount_path, str(index))
+                os.makedirs(imgmountdir, exist_ok=True)
+                self.mount_image(entry, imgmountdir)
+                mountdirs.append(imgmountdir)
+        except Exception:
+            for entry, imgmountdir in zip(self.entries, mountdirs):
+                self.unmount_image(entry, imgmountdir)
+            raise
+
+        def unpack_after(earlier, entry, imgmountdir):
+            for f in earlier:
+                if f.result():
+                    # Don't unpack on top of a failed unpack
+                    self.unmount_image(entry, imgmountdir)
+                    return None
+            return self.unpack_entry(entry, imgmountdir)
+
+        with concurrent.futures.ThreadPoolExecutor(max_workers=len(self.entries)) as pool:
+            futures = []
+            for index, entry in enumerate(self.entries):
+                earlier = [futures[i] for i in range(index)
+                           if destinations_overlap(self.entries[i].destination, entry.destination)]
+                futures.append(pool.submit(unpack_after, earlier, entry, mountdirs[index]))
+
+            while concurrent.futures.wait(futures, timeout=0.5).not_done:
                 self.report_progress()
-                error_msg = self.unpack_image(entry, imgmountdir)
+            self.report_progress()
 
-                if error_msg:
-                    return (_("Failed to unpack image \"{}\"").format(entry.source),
-                            error_msg)
+        for f in futures:
+            if f.result():
+                return f.result()
+        return None
 
-            return None
-        finally:
-            shutil.rmtree(source_mount_path, ignore_errors=True, onerror=None)
+    def unpack_entry(self, entry, imgmountdir):
+        """
+        Unpacks the already-mounted @p entry from @p imgmountdir,
+        checking its checksum if it has one.
+
+        :return: None, or an error tuple for the job
+        """
+        manifest = read_manifest(entry.manifestFile) if entry.manifestFile else None
+        if entry.is_tar():
+            # Progress is in bytes of the archive; a pipe has no size
+            entry.total = os.path.getsize(entry.source) if os.path.isfile(entry.source) else 0
+        elif manifest:
+            entry.total = manifest["files"]
+            check_space(entry, manifest)
+        else:
+            # Count the files while they are being copied, rather than beforehand
+            FileCounter(entry, entry.source if entry.is_file() else imgmountdir).start()
+
+        if not self.concurrent:
+            self.report_progress()
+        checksum = None
+        if entry.checksumFile:
+            checksum = ImageChecksum(entry.source)
+            checksum.start()
+        try:
+            error_msg = self.unpack_image(entry, imgmountdir)
+        except Exception:
+            if checksum:
+                checksum.stop()
+            raise
+
+        if error_msg:
+            if checksum:
+                # No need to read the rest of the image
+                checksum.stop()
+            return (_("Failed to unpack image \"{}\"").format(entry.source),
+                    error_msg)
+
+        if checksum:
+            checksum.join()
+            expected = expected_checksum(entry.checksumFile, entry.source)
+            store_integrity(entry.source, expected, checksum.checksum)
+            if checksum.checksum != expected:
+                utils.warning("Checksum of {} is {}, expected {} ({})".format(
+                    entry.source, checksum.checksum, expected, checksum.error))
+                return (_("The image \"{}\" is damaged.").format(entry.source),
+                        _("Its SHA-256 checksum does not match \"{}\". "
+                          "The installation medium may be corrupt.").format(entry.checksumFile))
+            utils.debug("Checksum of {} matches {}".format(entry.source, entry.checksumFile))
+
+        return None
 
     def mount_image(self, entry, imgmountdir):
         """
@@ -288,7 +675,7 @@ class UnpackOperation:
 
         :returns: None, but throws if the mount failed
         """
-        if entry.is_file():
+        if entry.is_file() or entry.is_tar():
             return
 
         if os.path.isdir(entry.source):
@@ -318,7 +705,12 @@ class UnpackOperation:
             entry.copied = copied
             if total > entry.total:
                 entry.total = total
-            self.report_progress()
+            # When unpacking concurrently, run_concurrently() reports for all entries
+            if not self.concurrent:
+                self.report_progress()
+
+        if entry.is_tar():
+            return tar_extract(entry, progress_cb)
 
         try:
             if entry.is_file():
@@ -328,8 +720,14 @@ class UnpackOperation:
 
             return file_copy(source, entry, progress_cb)
         finally:
-            if not entry.is_file():
-                subprocess.check_call(["umount", "-l", imgmountdir])
+            self.unmount_image(entry, imgmountdir)
+
+    def unmount_image(self, entry, imgmountdir):
+        """
+        Unmount what mount_image() mounted for @p entry.
+        """
+        if not entry.is_file() and not entry.is_tar():
+            subprocess.check_call(["umount", "-l", imgmountdir])
 
 
 def get_supported_filesystems_kernel():
@@ -355,7 +753,7 @@ def get_supported_filesystems():
     Returns a list of all the supported filesystems
     (valid values for the *sourcefs* key in an item.
     """
-    return ["file"] + get_supported_filesystems_kernel()
+    return ["file", "tar"] + get_supported_filesystems_kernel()
 
 
 def run():
@@ -415,9 +813,25 @@ def run():
             unpack[-1].exclude = entry["exclude"]
         if entry.get("excludeFile", None):
             unpack[-1].excludeFile = entry["excludeFile"]
+        if entry.get("manifest", None):
+            unpack[-1].manifestFile = entry["manifest"]
+        elif os.path.isfile(source + ".manifest.json"):
+            unpack[-1].manifestFile = source + ".manifest.json"
+        if entry.get("checksum", None):
+            unpack[-1].checksumFile = entry["checksum"]
+        elif os.path.isfile(source) and os.path.isfile(source + ".sha256"):
+            unpack[-1].checksumFile = source + ".sha256"
+        if unpack[-1].checksumFile and not os.path.isfile(source):
+            utils.warning("Only image files can be checked, not \"{}\"".format(source))
+            return (_("Bad unsquash configuration"),
+                    _("Only image files can be checked, not \"{}\"").format(source))
+        if unpack[-1].checksumFile and expected_checksum(unpack[-1].checksumFile, source) is None:
+            utils.warning("There is no checksum for \"{}\" in \"{}\"".format(source, unpack[-1].checksumFile))
+            return (_("Bad unsquash configuration"),
+                    _("There is no checksum for \"{}\" in \"{}\"").format(source, unpack[-1].checksumFile))
 
         is_first = False
 
-    unpackop = UnpackOperation(unpack)
+    unpackop = UnpackOperation(unpack, job.configuration.get("concurrent", False))
 
     return unpackop.run()
@@ -46,12 +46,14 @@
 #include <QLineEdit>
 #include <QRegExp>
 #include <QRegExpValidator>
+#include <QtConcurrent/QtConcurrentRun>
 
 static const QRegExp USERNAME_RX( "^[a-z_][a-z0-9_-]*[$]?$" );
 static const QRegExp HOSTNAME_RX( "^[a-zA-Z0-9][-a-zA-Z0-9_]*$" );
 static constexpr const int USERNAME_MAX_LENGTH = 31;
 static constexpr const int HOSTNAME_MIN_LENGTH = 2;
 static constexpr const int HOSTNAME_MAX_LENGTH = 63;
+static constexpr const int PASSWORD_CHECK_DELAY_MS = 250;
 
 /** @brief How bad is the error for labelError() ? */
 enum class Badness
@@ -91,6 +93,16 @@ UsersPage::UsersPage( QWidget* parent )
 {
     ui->setupUi( this );
 
+    // Password checks (libpwquality in particular) can be slow, so they
+    // run in a thread once typing pauses.
+    m_passwordCheckTimer.setSingleShot( true );
+    m_passwordCheckTimer.setInterval( PASSWORD_CHECK_DELAY_MS );
+    connect( &m_passwordCheckTimer, &QTimer::timeout, this, &UsersPage::startPasswordCheck );
+    connect( &m_passwordCheckWatcher,
+             &QFutureWatcher< QStringList >::finished,
+             this,
+             &UsersPage::passwordCheckFinished );
+
     // Connect signals and slots
     connect( ui->textBoxFullName, &QLineEdit::textEdited, this, &UsersPage::onFullNameTextEdited );
     connect( ui->textBoxUsername, &QLineEdit::textEdited, this, &UsersPage::onUsernameTextEdited );
@@ -137,6 +149,7 @@ UsersPage::UsersPage( QWidget* parent )
 
 UsersPage::~UsersPage()
 {
+    m_passwordCheckWatcher.waitForFinished();
     delete ui;
 }
 
@@ -466,70 +479,174 @@ UsersPage::validateHostnameText( const QString& textRef )
     emit checkReady( isReady() );
 }
 
-bool
-UsersPage::checkPasswordAcceptance( const QString& pw1, const QString& pw2, QLabel* badge, QLabel* message )
+QLineEdit*
+UsersPage::passwordBox( PasswordField field ) const
+{
+    return field == PasswordField::User ? ui->textBoxUserPassword : ui->textBoxRootPassword;
+}
+
+QLineEdit*
+UsersPage::verifiedPasswordBox( PasswordField field ) const
+{
+    return field == PasswordField::User ? ui->textBoxUserVerifiedPassword : ui->textBoxVerifiedRootPassword;
+}
+
+QLabel*
+UsersPage::passwordBadge( PasswordField field ) const
+{
+    return field == PasswordField::User ? ui->labelUserPassword : ui->labelRootPassword;
+}
+
+QLabel*
+UsersPage::passwordMessage( PasswordField field ) const
+{
+    return field == PasswordField::User ? ui->labelUserPasswordError : ui->labelRootPasswordError;
+}
+
+bool&
+UsersPage::passwordReady( PasswordField field )
+{
+    return field == PasswordField::User ? m_readyPassword : m_readyRootPassword;
+}
+
+bool&
+UsersPage::passwordDirty( PasswordField field )
+{
+    return field == PasswordField::User ? m_userPasswordDirty : m_rootPasswordDirty;
+}
+
+/** @brief Apply the @p checks to @p password
+ *
+ * Returns the messages from the checks that fail; with @p stopAtFirst,
+ * only the first failure is returned. This runs in a worker thread.
+ */
+static QStringList
+failedPasswordChecks( const PasswordCheckList& checks, const QString& password, bool stopAtFirst )
+{
+    QStringList failures;
+    for ( const auto& pc : checks )
+    {
+        QString s = pc.filter( password );
+        if ( !s.isEmpty() )
+        {
+            failures.append( s );
+            if ( stopAtFirst )
+            {
+                break;
+            }
+        }
+    }
+    return failures;
+}
+
+void
+UsersPage::schedulePasswordCheck( PasswordField field )
 {
-    if ( pw1 != pw2 )
+    if ( passwordBox( field )->text() != verifiedPasswordBox( field )->text() )
     {
-        labelError( badge, message, tr( "Your passwords do not match!" ) );
-        return false;
+        labelError( passwordBadge( field ), passwordMessage( field ), tr( "Your passwords do not match!" ) );
+        passwordReady( field ) = false;
+        passwordDirty( field ) = false;
     }
     else
     {
-        bool failureIsFatal = ui->checkBoxValidatePassword->isChecked();
-        bool failureFound = false;
+        // With validation off, failed checks are only warnings,
+        // so matching passwords are good enough.
+        passwordReady( field ) = !ui->checkBoxValidatePassword->isChecked();
+        passwordDirty( field ) = true;
+        m_passwordCheckTimer.start();
+    }
+    emit checkReady( isReady() );
+}
 
-        if ( m_passwordChecksChanged )
+void
+UsersPage::startPasswordCheck()
+{
+    if ( m_passwordCheckWatcher.isRunning() )
+    {
+        return;  // passwordCheckFinished() starts the next one
+    }
+
+    if ( m_userPasswordDirty )
+    {
+        m_checkingField = PasswordField::User;
+    }
+    else if ( m_rootPasswordDirty )
+    {
+        m_checkingField = PasswordField::Root;
+    }
+    else
+    {
+        return;
+    }
+    passwordDirty( m_checkingField ) = false;
+
+    if ( m_passwordChecksChanged )
+    {
+        std::sort( m_passwordChecks.begin(), m_passwordChecks.end() );
+        m_passwordChecksChanged = false;
+    }
+
+    // Checks are run one at a time: the libpwquality check keeps
+    // state between accepting a password and explaining why not.
+    m_checkingPassword = passwordBox( m_checkingField )->text();
+    m_passwordCheckWatcher.setFuture( QtConcurrent::run( failedPasswordChecks,
+                                                         m_passwordChecks,
+                                                         m_checkingPassword,
+                                                         ui->checkBoxValidatePassword->isChecked() ) );
+}
+
+void
+UsersPage::passwordCheckFinished()
+{
+    const PasswordField field = m_checkingField;
+    const QString password = passwordBox( field )->text();
+
+    // Superseded results are dropped: either the passwords no longer
+    // match (and say so already), or the field is dirty again.
+    if ( !passwordDirty( field ) && password == m_checkingPassword
+         && password == verifiedPasswordBox( field )->text() )
+    {
+        const QStringList failures = m_passwordCheckWatcher.result();
+        const bool failureIsFatal = ui->checkBoxValidatePassword->isChecked();
+
+        if ( failures.isEmpty() )
         {
-            std::sort( m_passwordChecks.begin(), m_passwordChecks.end() );
-            m_passwordChecksChanged = false;
+            labelOk( passwordBadge( field ), passwordMessage( field ) );
+            passwordReady( field ) = true;
         }
-
-        for ( auto pc : m_passwordChecks )
+        else if ( failureIsFatal )
         {
-            QString s = pc.filter( pw1 );
-
-            if ( !s.isEmpty() )
-            {
-                labelError( badge, message, s, failureIsFatal ? Badness::Fatal : Badness::Warning );
-                failureFound = true;
-                if ( failureIsFatal )
-                {
-                    return false;
-                }
-            }
+            labelError( passwordBadge( field ), passwordMessage( field ), failures.first(), Badness::Fatal );
+            passwordReady( field ) = false;
         }
-
-        if ( !failureFound )
+        else
         {
-            labelOk( badge, message );
+            // Only warnings, which is ok to continue but the user should know.
+            labelError( passwordBadge( field ), passwordMessage( field ), failures.last(), Badness::Warning );
+            passwordReady( field ) = true;
         }
+        emit checkReady( isReady() );
+    }
+    m_checkingPassword.clear();
 
-        // Here, if failureFound is true then we've found **warnings**,
-        // which is ok to continue but the user should know.
-        return true;
+    // If typing continues, the timer will start the next check.
+    if ( !m_passwordCheckTimer.isActive() )
+    {
+        startPasswordCheck();
     }
 }
 
 void
 UsersPage::onPasswordTextChanged( const QString& )
 {
-    m_readyPassword = checkPasswordAcceptance( ui->textBoxUserPassword->text(),
-                                               ui->textBoxUserVerifiedPassword->text(),
-                                               ui->labelUserPassword,
-                                               ui->labelUserPasswordError );
-
-    emit checkReady( isReady() );
+    schedulePasswordCheck( PasswordField::User );
 }
 
 void
 UsersPage::onRootPasswordTextChanged( const QString& )
 {
-    m_readyRootPassword = checkPasswordAcceptance( ui->textBoxRootPassword->text(),
-                                                   ui->textBoxVerifiedRootPassword->text(),
-                                                   ui->labelRootPassword,
-                                                   ui->labelRootPasswordError );
-    emit checkReady( isReady() );
+    schedulePasswordCheck( PasswordField::Root );
 }
 
 
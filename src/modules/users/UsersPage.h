@@ -27,9 +27,12 @@
 #include "CheckPWQuality.h"
 #include "Job.h"
 
+#include <QFutureWatcher>
+#include <QTimer>
 #include <QWidget>
 
 class QLabel;
+class QLineEdit;
 
 namespace Ui
 {
@@ -84,13 +87,31 @@ signals:
     void checkReady( bool );
 
 private:
-    /** @brief Is the password acceptable?
+    /// @brief Which of the two password / verification pairs
+    enum class PasswordField
+    {
+        User,
+        Root
+    };
+
+    /** @brief Start checking a password (after a short delay)
      *
-     * Checks the two copies of the password and places error messages in the
-     * given QLabels. Returns true (and clears the error messages) if the
-     * password is acceptable.
+     * The two copies of the password are compared right away. If they
+     * match, the configured checks are run in a background thread once
+     * typing pauses; the field is not ready until they are done.
      */
-    bool checkPasswordAcceptance( const QString& pw1, const QString& pw2, QLabel* badge, QLabel* message );
+    void schedulePasswordCheck( PasswordField field );
+    /// @brief Run the checks for the next field that needs it, if idle
+    void startPasswordCheck();
+    /// @brief Show the outcome of a background check, if still relevant
+    void passwordCheckFinished();
+
+    QLineEdit* passwordBox( PasswordField field ) const;
+    QLineEdit* verifiedPasswordBox( PasswordField field ) const;
+    QLabel* passwordBadge( PasswordField field ) const;
+    QLabel* passwordMessage( PasswordField field ) const;
+    bool& passwordReady( PasswordField field );
+    bool& passwordDirty( PasswordField field );
 
     void retranslate();
 
@@ -99,6 +120,13 @@ private:
     PasswordCheckList m_passwordChecks;
     bool m_passwordChecksChanged = false;
 
+    QTimer m_passwordCheckTimer;
+    QFutureWatcher< QStringList > m_passwordCheckWatcher;
+    PasswordField m_checkingField = PasswordField::User;
+    QString m_checkingPassword;  ///< Password being checked in the background
+    bool m_userPasswordDirty = false;  ///< User password needs (re)checking
+    bool m_rootPasswordDirty = false;
+
     bool m_readyFullName;
     bool m_readyUsername;
     bool m_customUsername;
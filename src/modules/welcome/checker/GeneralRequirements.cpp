@@ -27,6 +27,7 @@
 #include "Settings.h"
 #include "modulesystem/Requirement.h"
 #include "network/Manager.h"
+#include "partition/DeviceInventory.h"
 #include "utils/CalamaresUtilsGui.h"
 #include "utils/CalamaresUtilsSystem.h"
 #include "utils/Logger.h"
@@ -215,11 +216,12 @@ GeneralRequirements::setConfigurationMap( const QVariantMap& configurationMap )
     }
 
 #ifdef WITHOUT_LIBPARTED
-    if ( m_entriesToCheck.contains( "storage" ) || m_entriesToRequire.contains( "storage" ) )
+    if ( !CalamaresUtils::Partition::DeviceInventory::isSupported()
+         && ( m_entriesToCheck.contains( "storage" ) || m_entriesToRequire.contains( "storage" ) ) )
     {
         // Warn, but also drop the required bit because otherwise installation
         // will be impossible (because the check always returns false).
-        cWarning() << "GeneralRequirements checks 'storage' but libparted is disabled.";
+        cWarning() << "GeneralRequirements checks 'storage' but there is no sysfs and libparted is disabled.";
         m_entriesToCheck.removeAll( "storage" );
         m_entriesToRequire.removeAll( "storage" );
     }
@@ -308,9 +310,21 @@ GeneralRequirements::setConfigurationMap( const QVariantMap& configurationMap )
 bool
 GeneralRequirements::checkEnoughStorage( qint64 requiredSpace )
 {
+    // The device inventory is shared with the partition module, and
+    // has (usually) been filled in the background already.
+    if ( CalamaresUtils::Partition::DeviceInventory::isSupported() )
+    {
+        const auto devices = CalamaresUtils::Partition::DeviceInventory::instance()->installableDevices( requiredSpace );
+        for ( const auto& d : devices )
+        {
+            cDebug() << Logger::SubEntry << "Big enough:" << d.devicePath() << d.size;
+        }
+        return !devices.isEmpty();
+    }
+
 #ifdef WITHOUT_LIBPARTED
     Q_UNUSED( requiredSpace )
-    cWarning() << "GeneralRequirements is configured without libparted.";
+    cWarning() << "GeneralRequirements is configured without libparted, and there is no sysfs.";
     return false;
 #else
     return check_big_enough( requiredSpace );